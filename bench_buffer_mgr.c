@@ -0,0 +1,1394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "trace.h"
+
+/*
+ * Micro benchmarks for the storage and buffer managers.
+ * The managers log every call to stdout, so results are reported on stderr
+ * and `make bench` discards stdout.
+ */
+
+#define BENCH_FILE "bench_io.bin"
+#define BENCH_FILE_PAGES 4096
+#define BENCH_MISS_ROUNDS 20000
+#define BENCH_PIN_ROUNDS 1000000
+#define BENCH_EVICT_ROUNDS 200000
+#define BENCH_MIXED_FILE_PAGES 20000
+#define BENCH_MIXED_POOL_PAGES 1000
+#define BENCH_MIXED_HOT_PAGES 500
+#define BENCH_MIXED_CYCLES 50
+#define BENCH_MIXED_POINTS 4000
+#define BENCH_MIXED_SCAN_PAGES 3000
+#define BENCH_WRITER_FILE_PAGES 4000
+#define BENCH_WRITER_POOL_PAGES 1000
+#define BENCH_WRITER_ROUNDS 200000
+#define BENCH_TRACE_POOL_PAGES 100
+#define BENCH_TRACE_ROUNDS 1000000
+#define BENCH_LATCH_ROUNDS 10000000
+#define BENCH_LATCH_THREADS 4
+#define BENCH_LATCH_THREAD_ROUNDS 1000000
+#define BENCH_CONCURRENT_ROUNDS 1000000
+#define BENCH_CONCURRENT_HIT_PAGES 1024
+#define BENCH_CONCURRENT_MISS_FRAMES 256
+#define BENCH_CONCURRENT_MISS_PAGES 4096
+#define BENCH_CONCURRENT_MAX_THREADS 32
+#define BENCH_ARENA_PAGES 262144
+#define BENCH_ARENA_ROUNDS 2000000
+#define BENCH_WAIT_THREADS 8
+#define BENCH_WAIT_FRAMES 9
+#define BENCH_WAIT_PAGES 256
+#define BENCH_WAIT_ROUNDS 2000
+#define BENCH_SCAN_PAGES 20000
+#define BENCH_SCAN_FRAMES 256
+#define BENCH_SCAN_WORK 2000
+#define BENCH_RING_FRAMES 16
+#define BENCH_FLUSH_PAGES 8192
+#define BENCH_FLUSH_ROUNDS 20
+#define BENCH_WARM_LOOKUPS 5000
+#define BENCH_TABLE "bench_table"
+#define BENCH_TABLE_RECORDS 20000
+#define BENCH_MAP_ROUNDS 1000000
+#define BENCH_MAP_POOL_PAGES 256
+#define BENCH_DIRECT_PAGE_SIZE 4096
+#define BENCH_DIRECT_FILE_PAGES 8192
+#define BENCH_DIRECT_POOL_PAGES 1024
+#define BENCH_DIRECT_ROUNDS 50000
+#define BENCH_VECTOR_PAGE_SIZE 4096
+#define BENCH_VECTOR_FILE_PAGES 8192
+#define BENCH_VECTOR_MAX_RUN 256
+#define BENCH_ASYNC_FILE_PAGES 16384
+#define BENCH_ASYNC_ROUNDS 20000
+#define BENCH_ASYNC_DEPTH 32
+
+// benchmark methods
+static void benchMissLatency (void);
+static void benchPinThroughput (void);
+static void benchEvictionCost (void);
+static void benchMixedHitRatio (void);
+static void benchBackgroundWriter (void);
+static void benchTracing (void);
+static void benchFrameLatch (void);
+static void benchConcurrentPins (void);
+static void benchPinWait (void);
+static void benchFrameArena (void);
+static void benchSequentialScan (void);
+static void benchScanRing (void);
+static void benchFlushPool (void);
+static void benchWarmRestart (void);
+static void benchPageSize (void);
+static void benchMappedFile (void);
+static void benchDirectIO (void);
+static void benchVectoredIO (void);
+static void benchAsyncIO (void);
+
+// helper methods
+static double nowNanos (void);
+static void createBenchFile (char *fileName, int numPages);
+static void legacyMissRead (char *fileName, int pageNum, SM_PageHandle memPage);
+static size_t cachedBytes (char *fileName);
+static void *latchWorker (void *arg);
+static void *pinWorker (void *arg);
+static void *pinPairWorker (void *arg);
+
+static Latch benchLatch;
+
+// work of one thread of the concurrent pin benchmark
+typedef struct PinWork {
+    BM_BufferPool *bm;
+    int numPages;
+    int rounds;
+    unsigned int seed;
+    int failures; // pins that returned an error
+} PinWork;
+
+// main method; "bench_buffer_mgr tracing" runs only the tracing benchmark,
+// which `make bench-trace` builds with each tracing setting
+int
+main (int argc, char *argv[])
+{
+    initStorageManager();
+
+    if (argc > 1 && strcmp(argv[1], "tracing") == 0)
+    {
+        benchTracing();
+        return 0;
+    }
+
+    benchMissLatency();
+    benchPinThroughput();
+    benchEvictionCost();
+    benchMixedHitRatio();
+    benchBackgroundWriter();
+    benchFrameLatch();
+    benchConcurrentPins();
+    benchPinWait();
+    benchFrameArena();
+    benchSequentialScan();
+    benchScanRing();
+    benchFlushPool();
+    benchWarmRestart();
+    benchPageSize();
+    benchMappedFile();
+    benchDirectIO();
+    benchVectoredIO();
+    benchAsyncIO();
+
+    return 0;
+}
+
+// ************************************************************
+/*
+ * Compares the cost of a single page miss before and after the file handle
+ * was kept open: the legacy open/seek/read/close sequence, a positional read
+ * on a persistent handle, and a full pinPage miss through the buffer pool.
+ */
+void
+benchMissLatency (void)
+{
+    SM_FileHandle fHandle;
+    SM_PageHandle memPage = (SM_PageHandle) malloc(PAGE_SIZE);
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, legacy, persistent, pinned;
+    int i;
+
+    createBenchFile(BENCH_FILE, BENCH_FILE_PAGES);
+
+    // before: every miss opened, sized, read and closed the file
+    start = nowNanos();
+    for (i = 0; i < BENCH_MISS_ROUNDS; i++)
+        legacyMissRead(BENCH_FILE, (i * 7) % BENCH_FILE_PAGES, memPage);
+    legacy = (nowNanos() - start) / BENCH_MISS_ROUNDS;
+
+    // after: one pread on a handle opened once
+    openPageFile(BENCH_FILE, &fHandle);
+    start = nowNanos();
+    for (i = 0; i < BENCH_MISS_ROUNDS; i++)
+        readBlock((i * 7) % BENCH_FILE_PAGES, &fHandle, memPage);
+    persistent = (nowNanos() - start) / BENCH_MISS_ROUNDS;
+    closePageFile(&fHandle);
+
+    // after, end to end: a small pool cycling over the file misses on every pin
+    initBufferPool(bm, BENCH_FILE, 16, RS_FIFO, NULL);
+    start = nowNanos();
+    for (i = 0; i < BENCH_MISS_ROUNDS; i++)
+    {
+        pinPage(bm, h, (i * 7) % BENCH_FILE_PAGES);
+        unpinPage(bm, h);
+    }
+    pinned = (nowNanos() - start) / BENCH_MISS_ROUNDS;
+    shutdownBufferPool(bm);
+
+    fprintf(stderr, "miss latency (%d misses, %d byte pages)\n", BENCH_MISS_ROUNDS, PAGE_SIZE);
+    fprintf(stderr, "  before: open/seek/read/close per miss  %10.0f ns\n", legacy);
+    fprintf(stderr, "  after:  pread on persistent handle     %10.0f ns\n", persistent);
+    fprintf(stderr, "  after:  pinPage miss through the pool  %10.0f ns\n", pinned);
+
+    destroyPageFile(BENCH_FILE);
+    free(memPage);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Measures pin/unpin throughput on resident pages for growing pool sizes.
+ * Page lookups go through the page table, so the rate should stay flat.
+ */
+void
+benchPinThroughput (void)
+{
+    int poolSizes[] = {100, 1000, 10000, 100000, 200000};
+    int numSizes = sizeof(poolSizes) / sizeof(poolSizes[0]);
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, elapsed;
+    unsigned int seed = 42;
+    int s, i;
+
+    fprintf(stderr, "pin throughput on resident pages (%d pins)\n", BENCH_PIN_ROUNDS);
+    for (s = 0; s < numSizes; s++)
+    {
+        int numPages = poolSizes[s];
+
+        createBenchFile(BENCH_FILE, numPages);
+        initBufferPool(bm, BENCH_FILE, numPages, RS_LRU, NULL);
+
+        // warm up: every page gets a frame of its own
+        for (i = 0; i < numPages; i++)
+        {
+            pinPage(bm, h, i);
+            unpinPage(bm, h);
+        }
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_PIN_ROUNDS; i++)
+        {
+            pinPage(bm, h, rand_r(&seed) % numPages);
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  numPages %7d  %10.0f pins/s  %6.0f ns/pin\n",
+                numPages, BENCH_PIN_ROUNDS / (elapsed / 1e9), elapsed / BENCH_PIN_ROUNDS);
+
+        shutdownBufferPool(bm);
+        destroyPageFile(BENCH_FILE);
+    }
+
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Measures the cost of an LRU miss that has to evict, for growing pool
+ * sizes. The pool cycles over a file twice its size, so every pin misses.
+ * The victim comes off the tail of the recency list, so the cost should
+ * not grow with the pool.
+ */
+void
+benchEvictionCost (void)
+{
+    int poolSizes[] = {100, 1000, 10000, 100000};
+    int numSizes = sizeof(poolSizes) / sizeof(poolSizes[0]);
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, elapsed;
+    int s, i;
+
+    fprintf(stderr, "LRU eviction cost (%d misses)\n", BENCH_EVICT_ROUNDS);
+    for (s = 0; s < numSizes; s++)
+    {
+        int numPages = poolSizes[s];
+        int filePages = 2 * numPages;
+
+        createBenchFile(BENCH_FILE, filePages);
+        initBufferPool(bm, BENCH_FILE, numPages, RS_LRU, NULL);
+
+        // warm up: fill the pool so every timed pin evicts
+        for (i = 0; i < numPages; i++)
+        {
+            pinPage(bm, h, i);
+            unpinPage(bm, h);
+        }
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_EVICT_ROUNDS; i++)
+        {
+            pinPage(bm, h, (numPages + i) % filePages);
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  numPages %7d  %6.0f ns/miss\n", numPages, elapsed / BENCH_EVICT_ROUNDS);
+
+        shutdownBufferPool(bm);
+        destroyPageFile(BENCH_FILE);
+    }
+
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Compares hit ratios on a mix of point lookups and full scans. Point
+ * lookups mostly go to a hot set that fits in the pool; every so often a
+ * scan reads more pages than the pool holds. LRU lets each scan flush the
+ * hot set, a scan resistant strategy should keep it.
+ */
+void
+benchMixedHitRatio (void)
+{
+    ReplacementStrategy strategies[] = {RS_LRU, RS_ARC};
+    char *names[] = {"LRU", "ARC"};
+    int numStrategies = sizeof(strategies) / sizeof(strategies[0]);
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int s, c, i;
+
+    createBenchFile(BENCH_FILE, BENCH_MIXED_FILE_PAGES);
+
+    fprintf(stderr, "hit ratio on point lookups mixed with scans (%d frames, %d hot pages, %d page scans)\n",
+            BENCH_MIXED_POOL_PAGES, BENCH_MIXED_HOT_PAGES, BENCH_MIXED_SCAN_PAGES);
+    for (s = 0; s < numStrategies; s++)
+    {
+        unsigned int seed = 42;
+        int pointPins = 0, pointMisses = 0, allPins = 0;
+
+        initBufferPool(bm, BENCH_FILE, BENCH_MIXED_POOL_PAGES, strategies[s], NULL);
+
+        for (c = 0; c < BENCH_MIXED_CYCLES; c++)
+        {
+            // point lookups: nine in ten go to the hot set, spread over the file
+            for (i = 0; i < BENCH_MIXED_POINTS; i++)
+            {
+                int before = getNumReadIO(bm);
+                int pageNum = (rand_r(&seed) % 10 != 0)
+                        ? (rand_r(&seed) % BENCH_MIXED_HOT_PAGES) * (BENCH_MIXED_FILE_PAGES / BENCH_MIXED_HOT_PAGES)
+                        : rand_r(&seed) % BENCH_MIXED_FILE_PAGES;
+
+                pinPage(bm, h, pageNum);
+                unpinPage(bm, h);
+                pointMisses += getNumReadIO(bm) - before;
+                pointPins++;
+            }
+
+            // a scan over a run of pages larger than the pool
+            int first = rand_r(&seed) % (BENCH_MIXED_FILE_PAGES - BENCH_MIXED_SCAN_PAGES);
+            for (i = 0; i < BENCH_MIXED_SCAN_PAGES; i++)
+            {
+                pinPage(bm, h, first + i);
+                unpinPage(bm, h);
+            }
+        }
+        allPins = pointPins + BENCH_MIXED_CYCLES * BENCH_MIXED_SCAN_PAGES;
+
+        fprintf(stderr, "  %-4s  point lookups %5.1f%%  all pins %5.1f%%\n", names[s],
+                100.0 * (pointPins - pointMisses) / pointPins,
+                100.0 * (allPins - (getNumReadIO(bm) - 1)) / allPins);
+
+        shutdownBufferPool(bm);
+    }
+
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Compares an update heavy workload with and without the background writer.
+ * Without it every eviction of a dirty page writes the page before the read;
+ * with it most victims are already clean when a pin needs them.
+ */
+void
+benchBackgroundWriter (void)
+{
+    BM_PoolOptions options[] = {{ 0 }, { .writerCleanRatio = 0.25 },
+                                  { .writerCleanRatio = 0.25, .writerPagesPerSecond = 20000 }};
+    char *names[] = {"writer off", "writer on", "writer 20000 pages/s"};
+    int numOptions = sizeof(options) / sizeof(options[0]);
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, elapsed;
+    int o, i;
+
+    createBenchFile(BENCH_FILE, BENCH_WRITER_FILE_PAGES);
+
+    fprintf(stderr, "random updates with background writes (%d frames, %d pages, %d updates)\n",
+            BENCH_WRITER_POOL_PAGES, BENCH_WRITER_FILE_PAGES, BENCH_WRITER_ROUNDS);
+    for (o = 0; o < numOptions; o++)
+    {
+        unsigned int seed = 42;
+
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_WRITER_POOL_PAGES, RS_LRU, NULL, &options[o]);
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_WRITER_ROUNDS; i++)
+        {
+            pinPage(bm, h, rand_r(&seed) % BENCH_WRITER_FILE_PAGES);
+            h->data[0]++;
+            markDirty(bm, h);
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-22s %6.0f ns/update  %7d dirty evictions  %7d writes\n", names[o],
+                elapsed / BENCH_WRITER_ROUNDS, getNumDirtyEvictions(bm), getNumWriteIO(bm));
+
+        shutdownBufferPool(bm);
+    }
+
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Measures pin/unpin throughput on resident pages and positional reads for
+ * the tracing setting this binary was built with.
+ */
+void
+benchTracing (void)
+{
+    SM_FileHandle fHandle;
+    SM_PageHandle memPage = (SM_PageHandle) malloc(PAGE_SIZE);
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, pins, reads;
+    int i;
+#if defined(TRACE_RING) && LOG_LEVEL >= LOG_LEVEL_TRACE
+    char *setting = "ring + TRACE messages";
+#elif defined(TRACE_RING)
+    char *setting = "ring";
+#else
+    char *setting = "off";
+#endif
+
+    createBenchFile(BENCH_FILE, BENCH_TRACE_POOL_PAGES);
+    traceReset();
+
+    initBufferPool(bm, BENCH_FILE, BENCH_TRACE_POOL_PAGES, RS_LRU, NULL);
+    for (i = 0; i < BENCH_TRACE_POOL_PAGES; i++)
+    {
+        pinPage(bm, h, i);
+        unpinPage(bm, h);
+    }
+    start = nowNanos();
+    for (i = 0; i < BENCH_TRACE_ROUNDS; i++)
+    {
+        pinPage(bm, h, i % BENCH_TRACE_POOL_PAGES);
+        unpinPage(bm, h);
+    }
+    pins = (nowNanos() - start) / BENCH_TRACE_ROUNDS;
+    shutdownBufferPool(bm);
+
+    openPageFile(BENCH_FILE, &fHandle);
+    start = nowNanos();
+    for (i = 0; i < BENCH_TRACE_ROUNDS; i++)
+        readBlock(i % BENCH_TRACE_POOL_PAGES, &fHandle, memPage);
+    reads = (nowNanos() - start) / BENCH_TRACE_ROUNDS;
+    closePageFile(&fHandle);
+
+    fprintf(stderr, "tracing %-22s %6.0f ns/pin+unpin  %6.0f ns/readBlock\n", setting, pins, reads);
+
+    destroyPageFile(BENCH_FILE);
+    free(memPage);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Compares the frame latch with the pthread_rwlock it replaced: an
+ * uncontended exclusive acquire and release, an optimistic read, and
+ * exclusive acquires from several threads at once.
+ */
+void
+benchFrameLatch (void)
+{
+    pthread_rwlock_t rwlock;
+    pthread_t threads[BENCH_LATCH_THREADS];
+    double start, rwlockPair, latchPair, optimistic, contended;
+    uint32_t version;
+    int valid = 0;
+    int i;
+
+    pthread_rwlock_init(&rwlock, NULL);
+    start = nowNanos();
+    for (i = 0; i < BENCH_LATCH_ROUNDS; i++)
+    {
+        pthread_rwlock_wrlock(&rwlock);
+        pthread_rwlock_unlock(&rwlock);
+    }
+    rwlockPair = (nowNanos() - start) / BENCH_LATCH_ROUNDS;
+    pthread_rwlock_destroy(&rwlock);
+
+    createLatch(&benchLatch);
+    start = nowNanos();
+    for (i = 0; i < BENCH_LATCH_ROUNDS; i++)
+    {
+        lockLatchForWrite(&benchLatch);
+        releaseLatchAfterWrite(&benchLatch);
+    }
+    latchPair = (nowNanos() - start) / BENCH_LATCH_ROUNDS;
+
+    start = nowNanos();
+    for (i = 0; i < BENCH_LATCH_ROUNDS; i++)
+    {
+        version = beginOptimisticRead(&benchLatch);
+        valid += validateOptimisticRead(&benchLatch, version);
+    }
+    optimistic = (nowNanos() - start) / BENCH_LATCH_ROUNDS;
+
+    start = nowNanos();
+    for (i = 0; i < BENCH_LATCH_THREADS; i++)
+        pthread_create(&threads[i], NULL, latchWorker, NULL);
+    for (i = 0; i < BENCH_LATCH_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    contended = (nowNanos() - start) / (BENCH_LATCH_THREADS * BENCH_LATCH_THREAD_ROUNDS);
+    destroyLatch(&benchLatch);
+
+    fprintf(stderr, "frame latch (%d rounds, %d validated reads)\n", BENCH_LATCH_ROUNDS, valid);
+    fprintf(stderr, "  before: pthread_rwlock write lock/unlock  %6.1f ns\n", rwlockPair);
+    fprintf(stderr, "  after:  exclusive lock/unlock             %6.1f ns\n", latchPair);
+    fprintf(stderr, "  after:  optimistic read and validate      %6.1f ns\n", optimistic);
+    fprintf(stderr, "  after:  exclusive, %d threads              %6.1f ns/lock\n", BENCH_LATCH_THREADS, contended);
+}
+
+void *
+latchWorker (void *arg)
+{
+    int i;
+    for (i = 0; i < BENCH_LATCH_THREAD_ROUNDS; i++)
+    {
+        lockLatchForWrite(&benchLatch);
+        releaseLatchAfterWrite(&benchLatch);
+    }
+    return arg;
+}
+
+// ************************************************************
+/*
+ * Measures pin/unpin throughput with 1 to 32 threads sharing one pool,
+ * once on resident pages and once on a pool eight times smaller than the
+ * file, where most pins miss and evict. Hits only take the lock of their
+ * page table stripe, so they should scale with the cores available.
+ */
+void
+benchConcurrentPins (void)
+{
+    int threadCounts[] = {1, 2, 4, 8, 16, 32};
+    int numCounts = sizeof(threadCounts) / sizeof(threadCounts[0]);
+    int poolSizes[] = {BENCH_CONCURRENT_HIT_PAGES, BENCH_CONCURRENT_MISS_FRAMES};
+    int filePages[] = {BENCH_CONCURRENT_HIT_PAGES, BENCH_CONCURRENT_MISS_PAGES};
+    char *names[] = {"hits", "misses"};
+    pthread_t threads[BENCH_CONCURRENT_MAX_THREADS];
+    PinWork work[BENCH_CONCURRENT_MAX_THREADS];
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, elapsed;
+    int w, c, i;
+
+    fprintf(stderr, "concurrent pins (%d pins split over the threads)\n", BENCH_CONCURRENT_ROUNDS);
+    for (w = 0; w < 2; w++)
+    {
+        createBenchFile(BENCH_FILE, filePages[w]);
+        initBufferPool(bm, BENCH_FILE, poolSizes[w], RS_CLOCK, NULL);
+        for (i = 0; i < poolSizes[w]; i++)
+        {
+            pinPage(bm, h, i);
+            unpinPage(bm, h);
+        }
+
+        for (c = 0; c < numCounts; c++)
+        {
+            int numThreads = threadCounts[c];
+
+            start = nowNanos();
+            for (i = 0; i < numThreads; i++)
+            {
+                work[i] = (PinWork) {bm, filePages[w], BENCH_CONCURRENT_ROUNDS / numThreads, 42 + i, 0};
+                pthread_create(&threads[i], NULL, pinWorker, &work[i]);
+            }
+            for (i = 0; i < numThreads; i++)
+                pthread_join(threads[i], NULL);
+            elapsed = nowNanos() - start;
+
+            fprintf(stderr, "  %-6s %2d threads  %10.0f pins/s\n", names[w], numThreads,
+                    (BENCH_CONCURRENT_ROUNDS / numThreads) * numThreads / (elapsed / 1e9));
+        }
+
+        shutdownBufferPool(bm);
+        destroyPageFile(BENCH_FILE);
+    }
+
+    free(h);
+    free(bm);
+}
+
+void *
+pinWorker (void *arg)
+{
+    PinWork *work = arg;
+    BM_PageHandle h;
+    int i;
+
+    for (i = 0; i < work->rounds; i++)
+    {
+        pinPage(work->bm, &h, rand_r(&work->seed) % work->numPages);
+        unpinPage(work->bm, &h);
+    }
+    return NULL;
+}
+
+// ************************************************************
+/*
+ * Runs threads that each hold two pages at a time on a pool barely larger
+ * than the number of threads, so bursts of pins find every frame pinned.
+ * Without a wait timeout those pins fail; with one they stall briefly.
+ */
+void
+benchPinWait (void)
+{
+    BM_PoolOptions options[] = {{ 0 }, { .pinWaitMillis = 100 }};
+    char *names[] = {"fail at once", "wait up to 100 ms"};
+    pthread_t threads[BENCH_WAIT_THREADS];
+    PinWork work[BENCH_WAIT_THREADS];
+    BM_BufferPool *bm = MAKE_POOL();
+    double start, elapsed;
+    int o, i;
+
+    createBenchFile(BENCH_FILE, BENCH_WAIT_PAGES);
+
+    fprintf(stderr, "exhausted pool (%d threads holding two pages each, %d frames)\n",
+            BENCH_WAIT_THREADS, BENCH_WAIT_FRAMES);
+    for (o = 0; o < 2; o++)
+    {
+        int failures = 0;
+
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_WAIT_FRAMES, RS_CLOCK, NULL, &options[o]);
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_WAIT_THREADS; i++)
+        {
+            work[i] = (PinWork) {bm, BENCH_WAIT_PAGES, BENCH_WAIT_ROUNDS, 42 + i, 0};
+            pthread_create(&threads[i], NULL, pinPairWorker, &work[i]);
+        }
+        for (i = 0; i < BENCH_WAIT_THREADS; i++)
+        {
+            pthread_join(threads[i], NULL);
+            failures += work[i].failures;
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-18s %7d failed pins  %7d waits  %6.0f ns/pair\n", names[o], failures,
+                getNumPinWaits(bm), elapsed / (BENCH_WAIT_THREADS * BENCH_WAIT_ROUNDS));
+
+        shutdownBufferPool(bm);
+    }
+
+    destroyPageFile(BENCH_FILE);
+    free(bm);
+}
+
+void *
+pinPairWorker (void *arg)
+{
+    PinWork *work = arg;
+    BM_PageHandle first, second;
+    int i;
+
+    for (i = 0; i < work->rounds; i++)
+    {
+        if (pinPage(work->bm, &first, rand_r(&work->seed) % work->numPages) != RC_OK)
+        {
+            work->failures++;
+            continue;
+        }
+        // hold the first page for a moment, so the other threads pin in between
+        usleep(10);
+        if (pinPage(work->bm, &second, rand_r(&work->seed) % work->numPages) != RC_OK)
+            work->failures++;
+        else
+            unpinPage(work->bm, &second);
+        unpinPage(work->bm, &first);
+    }
+    return NULL;
+}
+
+// ************************************************************
+/*
+ * Measures pool setup and random pins that read from their page on a pool
+ * of BENCH_ARENA_PAGES frames, with the frame arena on ordinary pages and
+ * with the huge page hint.
+ */
+void
+benchFrameArena (void)
+{
+    BM_PoolOptions options[] = {{ 0 }, { .hugePages = true }};
+    char *names[] = {"4 KiB pages", "huge page hint"};
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, setup, elapsed;
+    long sum = 0;
+    int o, i;
+
+    createBenchFile(BENCH_FILE, BENCH_ARENA_PAGES);
+
+    fprintf(stderr, "frame arena (%d frames, %d pins reading their page)\n", BENCH_ARENA_PAGES, BENCH_ARENA_ROUNDS);
+    for (o = 0; o < 2; o++)
+    {
+        unsigned int seed = 42;
+
+        start = nowNanos();
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_ARENA_PAGES, RS_CLOCK, NULL, &options[o]);
+        setup = nowNanos() - start;
+        for (i = 0; i < BENCH_ARENA_PAGES; i++)
+        {
+            pinPage(bm, h, i);
+            unpinPage(bm, h);
+        }
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_ARENA_ROUNDS; i++)
+        {
+            pinPage(bm, h, rand_r(&seed) % BENCH_ARENA_PAGES);
+            sum += h->data[PAGE_SIZE / 2];
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-15s setup %6.1f ms  %6.0f ns/pin\n", names[o], setup / 1e6,
+                elapsed / BENCH_ARENA_ROUNDS);
+        shutdownBufferPool(bm);
+    }
+    fprintf(stderr, "  (checksum %ld)\n", sum);
+
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Scans a file much larger than the pool, doing some work on every page,
+ * with readahead off and on. With readahead the prefetcher reads the pages
+ * ahead of the scan while it works on the current one.
+ */
+void
+benchSequentialScan (void)
+{
+    BM_PoolOptions options[] = {{ 0 }, { .readaheadPages = 8 }, { .readaheadPages = 32 }};
+    char *names[] = {"readahead off", "readahead 8", "readahead 32"};
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    double start, elapsed;
+    long sum = 0;
+    int o, i, j;
+
+    createBenchFile(BENCH_FILE, BENCH_SCAN_PAGES);
+
+    fprintf(stderr, "sequential scan (%d frames, %d pages)\n", BENCH_SCAN_FRAMES, BENCH_SCAN_PAGES);
+    for (o = 0; o < 3; o++)
+    {
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_SCAN_FRAMES, RS_CLOCK, NULL, &options[o]);
+        int reads = getNumReadIO(bm);
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_SCAN_PAGES; i++)
+        {
+            pinPage(bm, h, i);
+            for (j = 0; j < BENCH_SCAN_WORK; j++)
+                sum += h->data[j % PAGE_SIZE] ^ j;
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-14s %6.0f ns/page  %7d reads\n", names[o], elapsed / BENCH_SCAN_PAGES,
+                getNumReadIO(bm) - reads);
+        shutdownBufferPool(bm);
+    }
+    fprintf(stderr, "  (checksum %ld)\n", sum);
+
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Repeats the point lookup and scan mix of benchMixedHitRatio on LRU, with
+ * the scans pinning through the pool as is and through an access ring of
+ * BENCH_RING_FRAMES frames. With the ring the hot set should survive them.
+ */
+void
+benchScanRing (void)
+{
+    char *names[] = {"no ring", "ring"};
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_AccessRing ring;
+    int r, c, i;
+
+    createBenchFile(BENCH_FILE, BENCH_MIXED_FILE_PAGES);
+
+    fprintf(stderr, "hit ratio of point lookups mixed with scans on LRU (%d frames, %d frame ring)\n",
+            BENCH_MIXED_POOL_PAGES, BENCH_RING_FRAMES);
+    for (r = 0; r < 2; r++)
+    {
+        unsigned int seed = 42;
+        int pointPins = 0, pointMisses = 0;
+        double start, elapsed;
+
+        initBufferPool(bm, BENCH_FILE, BENCH_MIXED_POOL_PAGES, RS_LRU, NULL);
+
+        start = nowNanos();
+        for (c = 0; c < BENCH_MIXED_CYCLES; c++)
+        {
+            for (i = 0; i < BENCH_MIXED_POINTS; i++)
+            {
+                int before = getNumReadIO(bm);
+                int pageNum = (rand_r(&seed) % 10 != 0)
+                        ? (rand_r(&seed) % BENCH_MIXED_HOT_PAGES) * (BENCH_MIXED_FILE_PAGES / BENCH_MIXED_HOT_PAGES)
+                        : rand_r(&seed) % BENCH_MIXED_FILE_PAGES;
+
+                pinPage(bm, h, pageNum);
+                unpinPage(bm, h);
+                pointMisses += getNumReadIO(bm) - before;
+                pointPins++;
+            }
+
+            int first = rand_r(&seed) % (BENCH_MIXED_FILE_PAGES - BENCH_MIXED_SCAN_PAGES);
+            if (r == 1)
+                initAccessRing(bm, &ring, BENCH_RING_FRAMES);
+            for (i = 0; i < BENCH_MIXED_SCAN_PAGES; i++)
+            {
+                if (r == 1)
+                    pinPageInRing(bm, &ring, h, first + i);
+                else
+                    pinPage(bm, h, first + i);
+                unpinPage(bm, h);
+            }
+            if (r == 1)
+                shutdownAccessRing(bm, &ring);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-8s point lookups %5.1f%%  %7d reads  %6.1f ms\n", names[r],
+                100.0 * (pointPins - pointMisses) / pointPins, getNumReadIO(bm) - 1, elapsed / 1e6);
+
+        shutdownBufferPool(bm);
+    }
+
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Compares writing back a pool full of dirty pages, cached in scattered
+ * order, one positional write per frame in frame order as forceFlushPool did
+ * before, against the sorted, coalesced flush.
+ */
+void
+benchFlushPool (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fHandle;
+    PageNumber *order = malloc(sizeof(PageNumber) * BENCH_FLUSH_PAGES);
+    double start, perFrame = 0, coalesced = 0;
+    int r, i;
+
+    createBenchFile(BENCH_FILE, BENCH_FLUSH_PAGES);
+    for (i = 0; i < BENCH_FLUSH_PAGES; i++)
+        order[i] = (int) (((long) i * 7919) % BENCH_FLUSH_PAGES);
+
+    initBufferPool(bm, BENCH_FILE, BENCH_FLUSH_PAGES, RS_LRU, NULL);
+    openPageFile(BENCH_FILE, &fHandle);
+    for (r = 0; r < BENCH_FLUSH_ROUNDS; r++)
+    {
+        for (i = 0; i < BENCH_FLUSH_PAGES; i++)
+        {
+            pinPage(bm, h, order[i]);
+            h->data[0]++;
+            markDirty(bm, h);
+            unpinPage(bm, h);
+        }
+
+        // before: the frames in array order, one write each
+        start = nowNanos();
+        for (i = 0; i < BENCH_FLUSH_PAGES; i++)
+        {
+            pinPage(bm, h, order[i]);
+            writeBlock(order[i], &fHandle, h->data);
+            unpinPage(bm, h);
+        }
+        perFrame += nowNanos() - start;
+
+        // after: sorted by page and written in runs
+        start = nowNanos();
+        forceFlushPool(bm);
+        coalesced += nowNanos() - start;
+    }
+    closePageFile(&fHandle);
+    shutdownBufferPool(bm);
+
+    fprintf(stderr, "flush of %d scattered dirty pages (%d byte pages)\n", BENCH_FLUSH_PAGES, PAGE_SIZE);
+    fprintf(stderr, "  before: one write per frame      %8.2f ms\n", perFrame / BENCH_FLUSH_ROUNDS / 1e6);
+    fprintf(stderr, "  after:  sorted, coalesced runs   %8.2f ms\n", coalesced / BENCH_FLUSH_ROUNDS / 1e6);
+
+    destroyPageFile(BENCH_FILE);
+    free(order);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Hit ratio of the first point lookups after a restart, with the pool
+ * starting empty and with the hot set reloaded from the manifest written at
+ * the previous shutdown.
+ */
+void
+benchWarmRestart (void)
+{
+    char *names[] = {"cold", "warm"};
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .warmRestart = true };
+    int r, i;
+
+    createBenchFile(BENCH_FILE, BENCH_MIXED_FILE_PAGES);
+
+    // a run before the restart leaves the hot pages in the manifest
+    initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_MIXED_POOL_PAGES, RS_LRU, NULL, &options);
+    for (i = 0; i < BENCH_MIXED_HOT_PAGES; i++)
+    {
+        pinPage(bm, h, i * (BENCH_MIXED_FILE_PAGES / BENCH_MIXED_HOT_PAGES));
+        unpinPage(bm, h);
+    }
+    shutdownBufferPool(bm);
+
+    fprintf(stderr, "first %d lookups after a restart (%d hot pages, %d frames)\n",
+            BENCH_WARM_LOOKUPS, BENCH_MIXED_HOT_PAGES, BENCH_MIXED_POOL_PAGES);
+    for (r = 0; r < 2; r++)
+    {
+        unsigned int seed = 42;
+        int misses = 0, waited;
+        double start, reload, lookups;
+
+        start = nowNanos();
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_MIXED_POOL_PAGES, RS_LRU, NULL, (r == 1) ? &options : NULL);
+        for (waited = 0; r == 1 && waited < 1000 && getNumReadIO(bm) - 1 < BENCH_MIXED_HOT_PAGES; waited++)
+            usleep(1000);
+        reload = nowNanos() - start;
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_WARM_LOOKUPS; i++)
+        {
+            int before = getNumReadIO(bm);
+            pinPage(bm, h, (rand_r(&seed) % BENCH_MIXED_HOT_PAGES) * (BENCH_MIXED_FILE_PAGES / BENCH_MIXED_HOT_PAGES));
+            unpinPage(bm, h);
+            misses += getNumReadIO(bm) - before;
+        }
+        lookups = nowNanos() - start;
+
+        fprintf(stderr, "  %s  hit ratio %5.1f%%  reload %6.2f ms  lookups %6.2f ms\n", names[r],
+                100.0 * (BENCH_WARM_LOOKUPS - misses) / BENCH_WARM_LOOKUPS, reload / 1e6, lookups / 1e6);
+
+        // the cold pool has no warm restart, so the manifest stays for the warm one
+        shutdownBufferPool(bm);
+    }
+
+    destroyPoolManifest(BENCH_FILE);
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Insert and scan throughput of a table through the record manager at each
+ * page size. Larger pages hold more records, so fewer pages are pinned and
+ * read per record, while an insert walks a longer slot directory to find a
+ * free slot.
+ */
+void
+benchPageSize (void)
+{
+    int pageSizes[] = {4096, 8192, 16384, 65536};
+    char *attrNames[] = {"a", "b", "c"};
+    DataType dataTypes[] = {DT_INT, DT_STRING, DT_INT};
+    int typeLength[] = {0, 16, 0};
+    int keys[] = {0};
+    Schema *schema = createSchema(3, attrNames, dataTypes, typeLength, 1, keys);
+    RM_TableData table;
+    RM_ScanHandle scan;
+    Record *record;
+    Value *value;
+    Expr *sel, *left, *right;
+    int p, i, found;
+    char limit[16];
+
+    snprintf(limit, sizeof(limit), "i%d", BENCH_TABLE_RECORDS);
+    MAKE_ATTRREF(left, 0);
+    MAKE_CONS(right, stringToValue(limit));
+    MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+
+    initRecordManager(NULL);
+    createRecord(&record, schema);
+    MAKE_STRING_VALUE(value, "page size bench");
+    setAttr(record, schema, 1, value);
+    freeVal(value);
+
+    fprintf(stderr, "table of %d records of %d bytes\n", BENCH_TABLE_RECORDS, getRecordSize(schema));
+    for (p = 0; p < (int) (sizeof(pageSizes) / sizeof(pageSizes[0])); p++)
+    {
+        double start, insert, scanned;
+
+        remove(BENCH_TABLE);
+        createTableWithPageSize(BENCH_TABLE, schema, pageSizes[p]);
+        openTable(&table, BENCH_TABLE);
+
+        start = nowNanos();
+        for (i = 0; i < BENCH_TABLE_RECORDS; i++)
+        {
+            MAKE_VALUE(value, DT_INT, i);
+            setAttr(record, schema, 0, value);
+            freeVal(value);
+            MAKE_VALUE(value, DT_INT, i % 100);
+            setAttr(record, schema, 2, value);
+            freeVal(value);
+            insertRecord(&table, record);
+        }
+        insert = nowNanos() - start;
+
+        start = nowNanos();
+        found = 0;
+        startScan(&table, &scan, sel);
+        while (next(&scan, record) == RC_OK)
+            found++;
+        closeScan(&scan);
+        scanned = nowNanos() - start;
+
+        fprintf(stderr, "  %5d byte pages  insert %8.0f records/s  scan %9.0f records/s  (%d found)\n",
+                pageSizes[p], BENCH_TABLE_RECORDS / (insert / 1e9), found / (scanned / 1e9), found);
+
+        closeTable(&table);
+        deleteTable(BENCH_TABLE);
+    }
+
+    freeRecord(record);
+    freeExpr(sel);
+    freeSchema(schema);
+    shutdownRecordManager();
+}
+
+// ************************************************************
+/*
+ * Random page reads of a cached file with pread, copied out of a mapping,
+ * and handed out as pointers into the mapping; then pool misses that copy
+ * the page into a frame against misses that point the frame into the mapping.
+ */
+void
+benchMappedFile (void)
+{
+    char *names[] = {"pread", "mmap copy", "mmap pointer"};
+    SM_AccessMode modes[] = {SM_ACCESS_PREAD, SM_ACCESS_MMAP, SM_ACCESS_MMAP};
+    SM_FileHandle fHandle;
+    SM_PageHandle memPage = (SM_PageHandle) malloc(PAGE_SIZE);
+    SM_PageHandle mapped;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = {0};
+    volatile char sink = 0;
+    double start, elapsed;
+    int m, i;
+
+    createBenchFile(BENCH_FILE, BENCH_FILE_PAGES);
+
+    fprintf(stderr, "%d random page reads of a cached %d page file\n", BENCH_MAP_ROUNDS, BENCH_FILE_PAGES);
+    for (m = 0; m < 3; m++)
+    {
+        unsigned int seed = 42;
+
+        openPageFileWithMode(BENCH_FILE, &fHandle, modes[m]);
+        start = nowNanos();
+        for (i = 0; i < BENCH_MAP_ROUNDS; i++)
+        {
+            int pageNum = rand_r(&seed) % BENCH_FILE_PAGES;
+            if (m == 2)
+            {
+                mapBlock(pageNum, &fHandle, &mapped);
+                sink += mapped[0];
+            }
+            else
+            {
+                readBlock(pageNum, &fHandle, memPage);
+                sink += memPage[0];
+            }
+        }
+        elapsed = nowNanos() - start;
+        closePageFile(&fHandle);
+
+        fprintf(stderr, "  %-12s  %7.1f ns per read\n", names[m], elapsed / BENCH_MAP_ROUNDS);
+    }
+
+    fprintf(stderr, "%d random pins, %d frames\n", BENCH_MAP_ROUNDS, BENCH_MAP_POOL_PAGES);
+    for (m = 0; m < 2; m++)
+    {
+        unsigned int seed = 42;
+
+        options.mapFiles = (m == 1);
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_MAP_POOL_PAGES, RS_LRU, NULL, &options);
+        start = nowNanos();
+        for (i = 0; i < BENCH_MAP_ROUNDS; i++)
+        {
+            pinPage(bm, h, rand_r(&seed) % BENCH_FILE_PAGES);
+            sink += h->data[0];
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-12s  %7.1f ns per pin  (%d misses)\n", (m == 1) ? "mapped" : "copying",
+                elapsed / BENCH_MAP_ROUNDS, getNumReadIO(bm) - 1);
+        shutdownBufferPool(bm);
+    }
+
+    destroyPageFile(BENCH_FILE);
+    free(memPage);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Random pins on a file eight times the size of the pool, starting with the
+ * file out of the page cache, with buffered and with direct I/O. Buffered
+ * reads leave a second copy of every page read in the page cache; direct
+ * reads leave the pool as the only cache.
+ */
+void
+benchDirectIO (void)
+{
+    char *names[] = {"buffered", "direct"};
+    SM_FileHandle fHandle;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = {0};
+    double start, elapsed;
+    int m, i, fd;
+
+    remove(BENCH_FILE);
+    createPageFileWithPageSize(BENCH_FILE, BENCH_DIRECT_PAGE_SIZE);
+    openPageFile(BENCH_FILE, &fHandle);
+    ensureCapacity(BENCH_DIRECT_FILE_PAGES, &fHandle);
+    closePageFile(&fHandle);
+
+    fprintf(stderr, "%d random pins of %d KiB pages, %d MiB file, %d MiB pool\n", BENCH_DIRECT_ROUNDS,
+            BENCH_DIRECT_PAGE_SIZE / 1024, BENCH_DIRECT_FILE_PAGES * (BENCH_DIRECT_PAGE_SIZE / 1024) / 1024,
+            BENCH_DIRECT_POOL_PAGES * (BENCH_DIRECT_PAGE_SIZE / 1024) / 1024);
+    for (m = 0; m < 2; m++)
+    {
+        unsigned int seed = 42;
+
+        // start each run with none of the file in the page cache
+        fd = open(BENCH_FILE, O_RDONLY);
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+
+        options.directIO = (m == 1);
+        initBufferPoolWithOptions(bm, BENCH_FILE, BENCH_DIRECT_POOL_PAGES, RS_LRU, NULL, &options);
+        start = nowNanos();
+        for (i = 0; i < BENCH_DIRECT_ROUNDS; i++)
+        {
+            pinPage(bm, h, rand_r(&seed) % BENCH_DIRECT_FILE_PAGES);
+            unpinPage(bm, h);
+        }
+        elapsed = nowNanos() - start;
+        shutdownBufferPool(bm);
+
+        fprintf(stderr, "  %-8s  %7.2f us per pin  page cache holds %5.1f MiB of the file\n", names[m],
+                elapsed / BENCH_DIRECT_ROUNDS / 1e3, cachedBytes(BENCH_FILE) / 1048576.0);
+    }
+
+    destroyPageFile(BENCH_FILE);
+    free(h);
+    free(bm);
+}
+
+// ************************************************************
+/*
+ * Grows a file by BENCH_VECTOR_FILE_PAGES pages, then reads it from start to
+ * end, out of the page cache and in it, one page per readBlock and in runs
+ * of several pages per readBlocks.
+ */
+void
+benchVectoredIO (void)
+{
+    int runs[] = {1, 8, 32, BENCH_VECTOR_MAX_RUN};
+    SM_FileHandle fHandle;
+    char *memPage = malloc((size_t) BENCH_VECTOR_MAX_RUN * BENCH_VECTOR_PAGE_SIZE);
+    double start, elapsed;
+    int r, c, i, fd;
+
+    remove(BENCH_FILE);
+    createPageFileWithPageSize(BENCH_FILE, BENCH_VECTOR_PAGE_SIZE);
+    openPageFile(BENCH_FILE, &fHandle);
+    start = nowNanos();
+    ensureCapacity(BENCH_VECTOR_FILE_PAGES, &fHandle);
+    elapsed = nowNanos() - start;
+
+    fprintf(stderr, "sequential reads of %d %d KiB pages\n", BENCH_VECTOR_FILE_PAGES, BENCH_VECTOR_PAGE_SIZE / 1024);
+    fprintf(stderr, "  file grown in %7.2f ms\n", elapsed / 1e6);
+    for (r = 0; r < 4; r++)
+    {
+        for (c = 0; c < 2; c++)
+        {
+            // the first pass starts with none of the file in the page cache
+            if (c == 0)
+            {
+                fd = open(BENCH_FILE, O_RDONLY);
+                fdatasync(fd);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+
+            start = nowNanos();
+            for (i = 0; i < BENCH_VECTOR_FILE_PAGES; i += runs[r])
+            {
+                if (runs[r] == 1)
+                    readBlock(i, &fHandle, memPage);
+                else
+                    readBlocks(i, runs[r], &fHandle, memPage);
+            }
+            elapsed = nowNanos() - start;
+
+            fprintf(stderr, "  run of %3d  %-6s %7.0f ns per page\n", runs[r], (c == 0) ? "cold" : "cached",
+                    elapsed / BENCH_VECTOR_FILE_PAGES);
+        }
+    }
+
+    closePageFile(&fHandle);
+    destroyPageFile(BENCH_FILE);
+    free(memPage);
+}
+
+// ************************************************************
+/*
+ * Random page reads from a file out of the page cache, one readBlock at a
+ * time and with BENCH_ASYNC_DEPTH reads in flight on an I/O queue, through
+ * io_uring and through the worker threads.
+ */
+void
+benchAsyncIO (void)
+{
+    char *names[] = {"readBlock", "io_uring", "threads"};
+    SM_FileHandle fHandle;
+    SM_IOQueue queue;
+    SM_IOCompletion completions[BENCH_ASYNC_DEPTH];
+    char *memPages = malloc((size_t) BENCH_ASYNC_DEPTH * BENCH_DIRECT_PAGE_SIZE);
+    double start, elapsed;
+    int m, i, n, fd, inFlight;
+
+    remove(BENCH_FILE);
+    createPageFileWithPageSize(BENCH_FILE, BENCH_DIRECT_PAGE_SIZE);
+    openPageFile(BENCH_FILE, &fHandle);
+    ensureCapacity(BENCH_ASYNC_FILE_PAGES, &fHandle);
+
+    fprintf(stderr, "%d random reads of %d KiB pages out of the page cache\n", BENCH_ASYNC_ROUNDS,
+            BENCH_DIRECT_PAGE_SIZE / 1024);
+    for (m = 0; m < 3; m++)
+    {
+        unsigned int seed = 42;
+
+        fd = open(BENCH_FILE, O_RDONLY);
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+
+        if (m > 0 && initIOQueue(&queue, BENCH_ASYNC_DEPTH, (m == 1) ? SM_IO_URING : SM_IO_THREADS) != RC_OK)
+            continue;
+        if (m == 1 && queue.backend != SM_IO_URING)
+        {
+            fprintf(stderr, "  %-9s  not available\n", names[m]);
+            shutdownIOQueue(&queue);
+            continue;
+        }
+
+        start = nowNanos();
+        if (m == 0)
+        {
+            for (i = 0; i < BENCH_ASYNC_ROUNDS; i++)
+                readBlock(rand_r(&seed) % BENCH_ASYNC_FILE_PAGES, &fHandle, memPages);
+        }
+        else
+        {
+            // keep the queue full, refilling each slot as its read finishes
+            for (inFlight = 0; inFlight < BENCH_ASYNC_DEPTH; inFlight++)
+                submitRead(&queue, rand_r(&seed) % BENCH_ASYNC_FILE_PAGES, 1, &fHandle,
+                           memPages + (size_t) inFlight * BENCH_DIRECT_PAGE_SIZE, memPages + (size_t) inFlight * BENCH_DIRECT_PAGE_SIZE);
+            for (i = BENCH_ASYNC_DEPTH; inFlight > 0; )
+            {
+                waitIOQueue(&queue, completions, 1, BENCH_ASYNC_DEPTH, &n);
+                inFlight -= n;
+                for (; n > 0 && i < BENCH_ASYNC_ROUNDS; n--, i++, inFlight++)
+                    submitRead(&queue, rand_r(&seed) % BENCH_ASYNC_FILE_PAGES, 1, &fHandle,
+                               completions[n - 1].userData, completions[n - 1].userData);
+            }
+            shutdownIOQueue(&queue);
+        }
+        elapsed = nowNanos() - start;
+
+        fprintf(stderr, "  %-9s  %7.2f us per read\n", names[m], elapsed / BENCH_ASYNC_ROUNDS / 1e3);
+    }
+
+    closePageFile(&fHandle);
+    destroyPageFile(BENCH_FILE);
+    free(memPages);
+}
+
+// ************************************************************
+double
+nowNanos (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void
+createBenchFile (char *fileName, int numPages)
+{
+    SM_FileHandle fHandle;
+
+    remove(fileName);
+    createPageFile(fileName);
+    openPageFile(fileName, &fHandle);
+    ensureCapacity(numPages, &fHandle);
+    closePageFile(&fHandle);
+}
+
+/*
+ * Bytes of a file resident in the page cache.
+ */
+size_t
+cachedBytes (char *fileName)
+{
+    int fd = open(fileName, O_RDONLY);
+    off_t size = lseek(fd, 0, SEEK_END);
+    long memoryPage = sysconf(_SC_PAGESIZE);
+    size_t numPages = (size + memoryPage - 1) / memoryPage, resident = 0, i;
+    unsigned char *vec = malloc(numPages);
+    void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (addr != MAP_FAILED && vec != NULL && mincore(addr, size, vec) == 0)
+    {
+        for (i = 0; i < numPages; i++)
+            resident += vec[i] & 1;
+    }
+    if (addr != MAP_FAILED)
+        munmap(addr, size);
+    free(vec);
+    close(fd);
+    return resident * memoryPage;
+}
+
+/*
+ * Replays the I/O sequence a page miss used to issue before the buffer pool
+ * kept its file open: an existence check, an fopen, a seek to the end to size
+ * the file, a seek to the page, an fread and an fclose.
+ */
+void
+legacyMissRead (char *fileName, int pageNum, SM_PageHandle memPage)
+{
+    FILE *fileExists = fopen(fileName, "r");
+    fclose(fileExists);
+
+    FILE *file = fopen(fileName, "r+");
+    fseek(file, 0, SEEK_END);
+    ftell(file);
+    rewind(file);
+
+    fseek(file, (long) pageNum * PAGE_SIZE, SEEK_SET);
+    fread(memPage, sizeof(char), PAGE_SIZE, file);
+    fclose(file);
+}
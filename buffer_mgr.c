@@ -1,558 +1,3629 @@
 #include "buffer_mgr.h"
 #include "stdlib.h"
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
-int writtenToDisk = 0;
-int readFromDisk = 0;
-int lruCounter = 0;
-bool isInitialized_bp = false;
+// One slot of the page table; an empty slot holds NO_PAGE
+typedef struct PageTableEntry {
+    int fileId;
+    PageNumber pageNumber;
+    int frameIndex;
+} PageTableEntry;
 
-int active_threads = 0;
-bool buffer_pool_shutting_down = false;
+// Open-addressing map from (file, page) to an int
+typedef struct PageTable {
+    PageTableEntry *entries;
+    int mask; // capacity - 1, the capacity is a power of two
+    int count;
+} PageTable;
 
-// Global mutex lock for buffer pool initialization
-pthread_mutex_t buffer_pool_init_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t bp_unique_init_mutex = PTHREAD_MUTEX_INITIALIZER;
-// Global condition variable
-pthread_cond_t buffer_pool_cond = PTHREAD_COND_INITIALIZER;
+/*
+ * One part of a pool's page table with its own lock, so pins of pages in
+ * different stripes do not wait for each other. Padded to a cache line.
+ */
+typedef struct PageTableStripe {
+    pthread_mutex_t lock;
+    pthread_cond_t ioDone; // broadcast when a frame mapped in this stripe finishes its I/O
+    PageTable table;
+} __attribute__((aligned(BM_CACHE_LINE_SIZE))) PageTableStripe;
+
+// What LRU-K remembers about a page after evicting it
+typedef struct LRUKRetained {
+    int fileId;
+    PageNumber pageNumber; // NO_PAGE if the slot is unused
+    int last;
+} LRUKRetained;
+
+// Binary min-heap of frames, each frame's heapIndex giving its position
+typedef struct FrameHeap {
+    int *frames;
+    int size;
+} FrameHeap;
+
+// The four ARC lists: resident pages seen once or more, and their ghosts
+enum { ARC_T1 = 0, ARC_T2 = 1, ARC_B1 = 2, ARC_B2 = 3, ARC_NUM_LISTS = 4 };
+
+typedef struct ARCList {
+    int head; // most recently used node, -1 if empty
+    int tail; // least recently used node, -1 if empty
+    int size;
+} ARCList;
+
+/*
+ * Bookkeeping of the ARC strategy. Nodes 0 .. numFrames-1 are the frames,
+ * the ghost entries of evicted pages follow them.
+ */
+typedef struct ARCState {
+    int target; // p, the size T1 is steered towards
+    ARCList lists[ARC_NUM_LISTS];
+    int *prev;
+    int *next;
+    int *listOf; // list a node is on, -1 if none
+    int *ghostFileId; // page remembered by each ghost entry
+    PageNumber *ghostPageNum;
+    int *freeGhosts; // stack of unused ghost entries
+    int numFreeGhosts;
+    PageTable ghostTable; // from (file, page) to ghost node
+} ARCState;
+
+// Frames of an access ring, behind BM_AccessRing.mgmtData; guarded by the pool mutex
+typedef struct BM_RingData {
+    int id; // Frames.ringId of the ring's frames, unique within the pool
+    int numFrames;
+    int *frames; // frames in the order they are recycled; entries whose ringId changed are stale
+    int count; // entries in use, numFrames once the ring is full
+    int next; // entry recycled next
+} BM_RingData;
+
+// A page queued for the prefetcher
+typedef struct BM_PrefetchRequest {
+    int fileId;
+    PageNumber pageNum;
+    BM_RingData *ring; // access ring to load the page into, NULL for none
+} BM_PrefetchRequest;
+
+// Consecutive pages the prefetcher read with one request
+typedef struct BM_ReadRun {
+    PageNumber firstPage;
+    int numPages; // 0 until the read finished
+    SM_PageHandle data; // the pages back to back
+} BM_ReadRun;
+
+// Runs of one file the prefetcher read ahead of loading their pages, for
+// the loads to copy instead of reading each page again
+typedef struct BM_ReadBatch {
+    int fileId;
+    uint64_t writeSeq; // the pool's writeSeq before the reads; any write since may have outdated them
+    int numRuns;
+    BM_ReadRun runs[BM_IO_DEPTH];
+} BM_ReadBatch;
+
+// Counters behind getPoolStats, on cache lines of their own. They are bumped
+// with relaxed atomics wherever the event happens, whatever locks are held
+typedef struct BM_PoolCounters {
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t evictions;
+    _Atomic uint64_t dirtyEvictions; // victims a pin had to write back itself
+    _Atomic uint64_t pinWaits; // pins that found every frame pinned and waited for an unpin
+    _Atomic uint64_t readLatency[BM_LATENCY_BUCKETS];
+    _Atomic uint64_t writeLatency[BM_LATENCY_BUCKETS];
+} __attribute__((aligned(BM_CACHE_LINE_SIZE))) BM_PoolCounters;
+
+#define COUNT_EVENT(counter) atomic_fetch_add_explicit(&(counter), 1, memory_order_relaxed)
+
+// A page file whose pages are cached by a pool
+typedef struct BM_PoolFile {
+    char *fileName; // NULL while the slot is unused
+    SM_FileHandle fHandle; // opened once on attach and reused for every page I/O
+    int refCount; // number of BM_BufferPools attached to the file
+
+    // Counters, kept per file so every table sees its own I/O
+    int readFromDisk;
+    int writtenToDisk;
+
+    // Pages of the manifest a warm restart still has to load, in page order; NULL once done
+    PageNumber *warmPages;
+    int numWarmPages;
+    int warmNext;
+} BM_PoolFile;
+
+/*
+ * Frames and bookkeeping of a pool; private to one BM_BufferPool or shared by all of them.
+ *
+ * Locking: a stripe lock guards its part of the page table and the fix counts
+ * of the frames mapped there; poolMutex guards everything else. A thread may
+ * take poolMutex while holding a stripe lock, never the other way round, and
+ * holds at most one stripe lock except through trylock.
+ */
+typedef struct BM_PoolData {
+    Frames *frames;
+    int numFrames;
+    int pageSize; // bytes per frame, no file with larger pages can attach
+    char *arena; // memory of all frames, numFrames pages in a row
+    size_t arenaSize;
+    bool arenaMapped; // mmapped rather than allocated
+    bool mapFiles; // frames point into mappings of the page files, there is no arena
+    bool directIO; // page files are opened with O_DIRECT where possible
+
+    bool shared;
+    ReplacementStrategy strategy;
+    int stratParam;
+
+    BM_PoolFile *files; // indexed by Frames.fileId
+    int numFiles;
+
+    PageTableStripe *stripes; // BM_PAGE_TABLE_STRIPES parts of the map from (file, page) to frame index
+    int *freeFrames; // stack of frames that hold no page
+    int numFreeFrames;
+
+    // Counters over all files of the pool
+    int readFromDisk;
+    int writtenToDisk;
+    int lruCounter;
+
+    int clockHand; // next frame the CLOCK strategy looks at
+
+    int lruHead; // most recently used frame, -1 if none, LRU only
+    int lruTail; // least recently used frame, -1 if none
+
+    FrameHeap victimHeap; // unpinned frames in eviction order, LFU and LRU-K only
+
+    int lfuDecayPeriod; // pins between two halvings of all use counts, 0 disables aging
+    int lfuPinsSinceDecay;
+
+    int lrukK; // reference times kept per page
+    int lrukClock; // logical time, advanced by every pin
+    int *lrukHistory; // per frame, the K latest uncorrelated reference times, newest first
+    int *lrukLast; // per frame, time of the latest reference
+    FrameHeap lrukPeriodHeap; // unpinned frames still inside their correlated reference period, oldest latest reference first
+    int *skippedFrames; // scratch space for frames passed over during victim selection, heap strategies only
+    bool victimBusy; // a victim candidate was passed over because another thread held its stripe
+    PageTable retainedTable; // from (file, page) to its slot in retained
+    LRUKRetained *retained; // ring of evicted pages whose history is kept
+    int *retainedHistory; // reference times of each retained slot
+    int numRetained;
+    int retainedNext; // slot the next eviction overwrites
+
+    ARCState *arc; // ARC only
+
+    BM_PoolCounters *counters;
+    int ioInFlight; // pins reading or writing a page with the locks released
+    _Atomic uint64_t writeSeq; // bumped as soon as a write-back returns, before its frame is clean
+
+    // Guards the pool; shutdown also waits on it until no thread is working in the pool
+    pthread_mutex_t poolMutex;
+    pthread_cond_t poolCond; // signalled when a background write finishes
+    pthread_cond_t frameFreed; // signalled when a frame can be evicted again while pins wait for one
+    _Atomic int pinWaiters; // pins waiting on frameFreed
+    int pinWaitMillis;
+    bool claimCleanOnly; // set while a prefetch chooses a victim, it must not write one back
+    int claimRingId; // ringId of the frames claimFrame may take, 0 outside of an access ring
+    int lastRingId;
+
+    // Prefetcher, started by the first prefetch request or warm restart
+    int readaheadPages;
+    bool warmRestart; // files keep a manifest of their hottest pages while detached
+    BM_PrefetchRequest prefetchQueue[BM_PREFETCH_QUEUE_SIZE]; // ring of pages to load
+    int prefetchHead;
+    int prefetchCount;
+    int prefetchFileId; // file the prefetcher is loading pages of, -1 if none
+    BM_RingData *prefetchRing; // access ring it is loading them into
+    bool prefetcherRunning;
+    bool prefetcherStop;
+    pthread_t prefetcherThread;
+    pthread_cond_t prefetchCond; // wakes the prefetcher when requests are queued
+    int activeThreads;
+    bool shuttingDown;
+
+    // Background writer, only started if the pool was given a clean ratio
+    bool writerRunning;
+    bool writerStop;
+    pthread_t writerThread;
+    pthread_cond_t writerCond; // wakes the writer before its interval is up
+    int writerWindow; // frames nearest eviction the writer keeps clean
+    int writerBatch; // writes allowed per interval
+    int writesInFlight;
+    int *writerCandidates; // scratch space, numFrames entries
+    SM_PageHandle writerPages; // copies of the BM_IO_DEPTH pages being written
+} BM_PoolData;
+
+// Bookkeeping kept behind BM_BufferPool.mgmtData: the pool and the file it serves
+typedef struct BM_PoolView {
+    BM_PoolData *pool;
+    int fileId;
+
+    // Readahead state; pins through one view race only in their guesses
+    _Atomic int lastPinned; // page of the latest pin, NO_PAGE before the first
+    _Atomic int sequentialPins; // pins in a row that followed the page before
+    _Atomic int readaheadNext; // first page the current run has not queued yet
+
+    const BM_ReadBatch *readBatch; // pages the prefetcher already read, NULL in any other view
+} BM_PoolView;
+
+#define POOL_VIEW(bm) ((BM_PoolView *) (bm)->mgmtData)
+#define POOL_DATA(bm) (POOL_VIEW(bm)->pool)
+#define POOL_FILE_ID(bm) (POOL_VIEW(bm)->fileId)
+#define POOL_FRAMES(bm) (POOL_DATA(bm)->frames)
+
+// Strategies that keep their unpinned frames in a FrameHeap
+#define USES_VICTIM_HEAP(poolData) ((poolData)->strategy == RS_LFU || (poolData)->strategy == RS_LRU_K)
+
+// Reference times of the page in a frame, newest first
+#define LRUK_HISTORY(poolData, index) (&(poolData)->lrukHistory[(index) * (poolData)->lrukK])
+
+// Memory charged against the shared pool's budget for each frame
+#define FRAME_FOOTPRINT(pageSize) ((pageSize) + sizeof(Frames) + 2 * sizeof(PageTableEntry) + sizeof(int))
+
+// The process-wide pool, NULL unless initSharedBufferPool was called
+static BM_PoolData *sharedPool = NULL;
+static pthread_mutex_t sharedPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Page table helpers
+
+static inline unsigned int hashPage (int fileId, PageNumber pageNum) {
+    // Fibonacci hashing spreads consecutive page numbers across the table
+    return ((unsigned int) pageNum ^ ((unsigned int) fileId * 0x9E3779B9u)) * 2654435761u;
+}
+
+/*
+ * Allocates an empty table with room for at least minEntries pages.
+ *
+ * @return RC_OK on success, or RC_BP_INIT_ERROR if memory allocation fails
+ */
+static RC pageTableInit (PageTable *table, int minEntries) {
+    // Size the table to at least twice the entry count to keep probe runs short
+    int size = 8;
+    while (size < 2 * minEntries) {
+        size <<= 1;
+    }
+
+    table->entries = malloc(sizeof(PageTableEntry) * size);
+    if (table->entries == NULL) {
+        return RC_BP_INIT_ERROR;
+    }
+    table->mask = size - 1;
+    table->count = 0;
+    for (int i = 0; i < size; i++) {
+        table->entries[i].pageNumber = NO_PAGE;
+    }
+    return RC_OK;
+}
+
+/*
+ * Finds the value stored for a page, the frame holding it for the page table.
+ *
+ * @param table   Table to search
+ * @param fileId  File the page belongs to
+ * @param pageNum Page number to look up
+ * @return        The value, or -1 if the page is not in the table
+ */
+static int pageTableLookup (PageTable *table, int fileId, PageNumber pageNum) {
+    unsigned int slot = hashPage(fileId, pageNum) & table->mask;
+
+    // Linear probing; the table is never more than half full so the walk is short
+    while (table->entries[slot].pageNumber != NO_PAGE) {
+        if (table->entries[slot].pageNumber == pageNum &&
+            table->entries[slot].fileId == fileId) {
+            return table->entries[slot].frameIndex;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+    return -1;
+}
+
+static void pageTableInsert (PageTable *table, int fileId, PageNumber pageNum, int frameIndex) {
+    unsigned int slot = hashPage(fileId, pageNum) & table->mask;
+
+    while (table->entries[slot].pageNumber != NO_PAGE &&
+           (table->entries[slot].pageNumber != pageNum ||
+            table->entries[slot].fileId != fileId)) {
+        slot = (slot + 1) & table->mask;
+    }
+    if (table->entries[slot].pageNumber == NO_PAGE) {
+        table->count++;
+    }
+    table->entries[slot].fileId = fileId;
+    table->entries[slot].pageNumber = pageNum;
+    table->entries[slot].frameIndex = frameIndex;
+}
+
+/*
+ * Removes a page from a table. Entries after it in the same probe run
+ * are shifted back so lookups never need tombstones.
+ */
+static void pageTableRemove (PageTable *table, int fileId, PageNumber pageNum) {
+    PageTableEntry *entries = table->entries;
+    unsigned int mask = table->mask;
+    unsigned int hole = hashPage(fileId, pageNum) & mask;
+
+    while (entries[hole].pageNumber != pageNum || entries[hole].fileId != fileId) {
+        if (entries[hole].pageNumber == NO_PAGE) {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+
+    unsigned int next = hole;
+    while (true) {
+        next = (next + 1) & mask;
+        if (entries[next].pageNumber == NO_PAGE) {
+            break;
+        }
+        // Move the entry back only if its home slot is not between the hole and it
+        unsigned int home = hashPage(entries[next].fileId, entries[next].pageNumber) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            entries[hole] = entries[next];
+            hole = next;
+        }
+    }
+    entries[hole].pageNumber = NO_PAGE;
+    table->count--;
+}
+
+/*
+ * Doubles a table once it is half full. Only tables whose number of entries
+ * is not bounded by their initial size need this.
+ *
+ * @return RC_OK on success, or RC_BP_PIN_ERROR if memory allocation fails
+ */
+static RC pageTableReserve (PageTable *table) {
+    if (2 * (table->count + 1) <= table->mask + 1) {
+        return RC_OK;
+    }
+
+    PageTable grown;
+    if (pageTableInit(&grown, table->mask + 1) != RC_OK) {
+        return RC_BP_PIN_ERROR;
+    }
+    for (int i = 0; i <= table->mask; i++) {
+        if (table->entries[i].pageNumber != NO_PAGE) {
+            pageTableInsert(&grown, table->entries[i].fileId, table->entries[i].pageNumber,
+                            table->entries[i].frameIndex);
+        }
+    }
+    free(table->entries);
+    *table = grown;
+    return RC_OK;
+}
+
+/*
+ * Finds the page table stripe a page belongs to. The slot within the stripe
+ * comes from the low bits of the hash, so the stripe uses high ones.
+ */
+static inline PageTableStripe *pageStripe (BM_PoolData *poolData, int fileId, PageNumber pageNum) {
+    return &poolData->stripes[(hashPage(fileId, pageNum) >> 20) & (BM_PAGE_TABLE_STRIPES - 1)];
+}
+
+static void lockAllStripes (BM_PoolData *poolData) {
+    for (int i = 0; i < BM_PAGE_TABLE_STRIPES; i++) {
+        pthread_mutex_lock(&poolData->stripes[i].lock);
+    }
+}
+
+static void unlockAllStripes (BM_PoolData *poolData) {
+    for (int i = BM_PAGE_TABLE_STRIPES - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&poolData->stripes[i].lock);
+    }
+}
+
+/*
+ * Locks the whole pool, every stripe and the pool mutex, once no pin has page
+ * I/O in flight. For the operations that walk all frames.
+ */
+static void lockWholePool (BM_PoolData *poolData) {
+    while (true) {
+        lockAllStripes(poolData);
+        pthread_mutex_lock(&poolData->poolMutex);
+        if (poolData->ioInFlight == 0) {
+            return;
+        }
+
+        // The pins finishing their I/O need the stripes back
+        unlockAllStripes(poolData);
+        while (poolData->ioInFlight > 0) {
+            pthread_cond_wait(&poolData->poolCond, &poolData->poolMutex);
+        }
+        pthread_mutex_unlock(&poolData->poolMutex);
+    }
+}
+
+static void unlockWholePool (BM_PoolData *poolData) {
+    pthread_mutex_unlock(&poolData->poolMutex);
+    unlockAllStripes(poolData);
+}
+
+/*
+ * Claims an unpinned frame for a pin that is about to load a new page into
+ * it: pins it and marks its I/O in progress. A fix count can only go up under
+ * the lock of the page's stripe, so the check is made under it; the stripe is
+ * only tried, since the caller already holds the new page's stripe and the
+ * pool mutex. Called with both held.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param held     Stripe lock the caller holds
+ * @param index    Index of the candidate frame
+ * @return         true if the frame was claimed, false if it is pinned or busy,
+ *                 dirty while a prefetch is choosing, or not managed by
+ *                 whoever is choosing: the strategy or one access ring
+ */
+static bool claimFrame (BM_PoolData *poolData, PageTableStripe *held, int index) {
+    Frames *frame = &poolData->frames[index];
+    PageTableStripe *stripe = NULL;
+
+    if (frame->fix_cnt > 0 || frame->ringId != poolData->claimRingId) {
+        return false;
+    }
+    if (frame->pageNumber != NO_PAGE) {
+        stripe = pageStripe(poolData, frame->fileId, frame->pageNumber);
+        if (stripe == held) {
+            stripe = NULL;
+        } else if (pthread_mutex_trylock(&stripe->lock) != 0) {
+            poolData->victimBusy = true;
+            return false;
+        }
+    }
+
+    bool claimed = (frame->fix_cnt == 0 && !(poolData->claimCleanOnly && frame->dirty));
+    if (claimed) {
+        frame->fix_cnt = 1;
+        frame->ioInProgress = true;
+    }
+    if (stripe != NULL) {
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    return claimed;
+}
+
+/*
+ * Empties a frame and drops its page from the page table. The caller holds
+ * the page's stripe lock.
+ */
+static void unmapFrame (BM_PoolData *poolData, int index) {
+    Frames *frames = poolData->frames;
+
+    if (frames[index].pageNumber != NO_PAGE) {
+        PageTableStripe *stripe = pageStripe(poolData, frames[index].fileId, frames[index].pageNumber);
+        pageTableRemove(&stripe->table, frames[index].fileId, frames[index].pageNumber);
+    }
+    frames[index].fileId = 0;
+    frames[index].pageNumber = NO_PAGE;
+}
+
+// Victim heap helpers, shared by LFU and LRU-K
+
+// True if frame a should be evicted before frame b
+static inline bool heapBefore (BM_PoolData *poolData, const FrameHeap *heap, int a, int b) {
+    Frames *frames = poolData->frames;
+
+    if (heap == &poolData->lrukPeriodHeap) {
+        // Leaves its correlated reference period first
+        return poolData->lrukLast[a] < poolData->lrukLast[b];
+    }
+    if (poolData->strategy == RS_LRU_K) {
+        // Largest backward K-distance first; pages with fewer than K references have an infinite one
+        int *historyA = LRUK_HISTORY(poolData, a);
+        int *historyB = LRUK_HISTORY(poolData, b);
+        int k = poolData->lrukK;
+        if (historyA[k - 1] != historyB[k - 1]) {
+            return historyA[k - 1] < historyB[k - 1];
+        }
+        return poolData->lrukLast[a] < poolData->lrukLast[b];
+    }
+
+    // LFU: fewer uses, then less recently used
+    if (frames[a].frequency != frames[b].frequency) {
+        return frames[a].frequency < frames[b].frequency;
+    }
+    return frames[a].lruOrder < frames[b].lruOrder;
+}
+
+static void heapSet (BM_PoolData *poolData, FrameHeap *heap, int pos, int index) {
+    heap->frames[pos] = index;
+    poolData->frames[index].heapIndex = pos;
+}
+
+static void heapSiftUp (BM_PoolData *poolData, FrameHeap *heap, int pos) {
+    int index = heap->frames[pos];
+
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!heapBefore(poolData, heap, index, heap->frames[parent])) {
+            break;
+        }
+        heapSet(poolData, heap, pos, heap->frames[parent]);
+        pos = parent;
+    }
+    heapSet(poolData, heap, pos, index);
+}
+
+static void heapSiftDown (BM_PoolData *poolData, FrameHeap *heap, int pos) {
+    int index = heap->frames[pos];
+
+    while (true) {
+        int child = 2 * pos + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if (child + 1 < heap->size &&
+            heapBefore(poolData, heap, heap->frames[child + 1], heap->frames[child])) {
+            child++;
+        }
+        if (!heapBefore(poolData, heap, heap->frames[child], index)) {
+            break;
+        }
+        heapSet(poolData, heap, pos, heap->frames[child]);
+        pos = child;
+    }
+    heapSet(poolData, heap, pos, index);
+}
+
+/*
+ * Makes an unpinned frame an eviction candidate.
+ */
+static void heapPush (BM_PoolData *poolData, FrameHeap *heap, int index) {
+    poolData->frames[index].inPeriodHeap = heap == &poolData->lrukPeriodHeap;
+    heapSet(poolData, heap, heap->size++, index);
+    heapSiftUp(poolData, heap, heap->size - 1);
+}
+
+/*
+ * Withdraws a frame from the eviction candidates, if it is one.
+ */
+static void heapRemove (BM_PoolData *poolData, int index) {
+    int pos = poolData->frames[index].heapIndex;
+    if (pos == -1) {
+        return;
+    }
+
+    FrameHeap *heap = poolData->frames[index].inPeriodHeap ? &poolData->lrukPeriodHeap : &poolData->victimHeap;
+    poolData->frames[index].heapIndex = -1;
+    int last = heap->frames[--heap->size];
+    if (pos < heap->size) {
+        heapSet(poolData, heap, pos, last);
+        heapSiftUp(poolData, heap, pos);
+        heapSiftDown(poolData, heap, poolData->frames[last].heapIndex);
+    }
+}
+
+/*
+ * Brings a frame's place in the heap up to date after its fix count or use
+ * counts changed: an unpinned frame holding a page is in the heap at the
+ * position its counts give it, any other frame or one of an access ring is not. Pins change fix counts
+ * without the pool mutex, so the fix count is read here rather than assumed.
+ */
+static void heapUpdate (BM_PoolData *poolData, int index) {
+    Frames *frame = &poolData->frames[index];
+
+    heapRemove(poolData, index);
+    if (frame->fix_cnt == 0 && frame->pageNumber != NO_PAGE && !frame->ioInProgress && frame->ringId == 0) {
+        bool inPeriod = poolData->strategy == RS_LRU_K &&
+            poolData->lrukClock + 1 - poolData->lrukLast[index] <= LRU_K_CORRELATED_PERIOD;
+        heapPush(poolData, inPeriod ? &poolData->lrukPeriodHeap : &poolData->victimHeap, index);
+    }
+}
+
+/*
+ * Ages all use counts by halving them, so pages that were hot long ago
+ * can be evicted once they cool down. Halving can reorder pages with
+ * equal counts, so the heap is rebuilt afterwards.
+ */
+static void lfuDecay (BM_PoolData *poolData) {
+    for (int i = 0; i < poolData->numFrames; i++) {
+        poolData->frames[i].frequency /= 2;
+    }
+    for (int pos = poolData->victimHeap.size / 2 - 1; pos >= 0; pos--) {
+        heapSiftDown(poolData, &poolData->victimHeap, pos);
+    }
+    poolData->lfuPinsSinceDecay = 0;
+}
+
+// LRU helpers
+
+/*
+ * Takes a frame out of the recency list threaded through the frames.
+ */
+static void lruUnlink (BM_PoolData *poolData, int index) {
+    Frames *frames = poolData->frames;
+    int prev = frames[index].lruPrev;
+    int next = frames[index].lruNext;
+
+    if (prev != -1) {
+        frames[prev].lruNext = next;
+    } else if (poolData->lruHead == index) {
+        poolData->lruHead = next;
+    } else {
+        return; // not on the list
+    }
+    if (next != -1) {
+        frames[next].lruPrev = prev;
+    } else {
+        poolData->lruTail = prev;
+    }
+    frames[index].lruPrev = -1;
+    frames[index].lruNext = -1;
+}
+
+/*
+ * Makes a frame the most recently used one.
+ */
+static void lruPushFront (BM_PoolData *poolData, int index) {
+    Frames *frames = poolData->frames;
+
+    lruUnlink(poolData, index);
+    frames[index].lruNext = poolData->lruHead;
+    if (poolData->lruHead != -1) {
+        frames[poolData->lruHead].lruPrev = index;
+    } else {
+        poolData->lruTail = index;
+    }
+    poolData->lruHead = index;
+}
+
+// LRU-K helpers
+
+/*
+ * Records a pin of a resident page. Pins within the correlated reference
+ * period of the previous one belong to the same burst and only move the
+ * last reference time; a later pin starts a new reference and shifts the
+ * older ones by the length of the burst that ended.
+ */
+static void lrukReference (BM_PoolData *poolData, int index) {
+    int *history = LRUK_HISTORY(poolData, index);
+    int now = ++poolData->lrukClock;
+
+    if (now - poolData->lrukLast[index] > LRU_K_CORRELATED_PERIOD) {
+        int correlatedPeriod = poolData->lrukLast[index] - history[0];
+        for (int i = poolData->lrukK - 1; i > 0; i--) {
+            history[i] = (history[i - 1] == 0) ? 0 : history[i - 1] + correlatedPeriod;
+        }
+        history[0] = now;
+    }
+    poolData->lrukLast[index] = now;
+}
+
+/*
+ * Starts the history of a page just read into a frame, picking up what was
+ * retained about it if it was evicted recently.
+ */
+static void lrukLoad (BM_PoolData *poolData, int index, int fileId, PageNumber pageNum) {
+    int *history = LRUK_HISTORY(poolData, index);
+    int k = poolData->lrukK;
+    int now = ++poolData->lrukClock;
+    int slot = pageTableLookup(&poolData->retainedTable, fileId, pageNum);
+
+    if (slot != -1) {
+        pageTableRemove(&poolData->retainedTable, fileId, pageNum);
+        poolData->retained[slot].pageNumber = NO_PAGE;
+    }
+
+    if (slot != -1 && now - poolData->retained[slot].last <= LRU_K_RETAINED_PERIOD) {
+        int *retainedHistory = &poolData->retainedHistory[slot * k];
+        for (int i = k - 1; i > 0; i--) {
+            history[i] = retainedHistory[i - 1];
+        }
+    } else {
+        for (int i = k - 1; i > 0; i--) {
+            history[i] = 0;
+        }
+    }
+    history[0] = now;
+    poolData->lrukLast[index] = now;
+}
+
+/*
+ * Keeps the history of an evicted page, overwriting the oldest retained one.
+ */
+static void lrukRetain (BM_PoolData *poolData, int index, int fileId, PageNumber pageNum) {
+    int k = poolData->lrukK;
+    int slot = poolData->retainedNext;
+    LRUKRetained *retained = &poolData->retained[slot];
+
+    poolData->retainedNext = (slot + 1) % poolData->numRetained;
+    if (retained->pageNumber != NO_PAGE) {
+        pageTableRemove(&poolData->retainedTable, retained->fileId, retained->pageNumber);
+    }
+
+    retained->fileId = fileId;
+    retained->pageNumber = pageNum;
+    retained->last = poolData->lrukLast[index];
+    memcpy(&poolData->retainedHistory[slot * k], LRUK_HISTORY(poolData, index), sizeof(int) * k);
+    pageTableInsert(&poolData->retainedTable, fileId, pageNum, slot);
+}
+
+// ARC helpers
+
+static void arcUnlink (ARCState *arc, int node) {
+    int list = arc->listOf[node];
+    if (list == -1) {
+        return;
+    }
+
+    if (arc->prev[node] != -1) {
+        arc->next[arc->prev[node]] = arc->next[node];
+    } else {
+        arc->lists[list].head = arc->next[node];
+    }
+    if (arc->next[node] != -1) {
+        arc->prev[arc->next[node]] = arc->prev[node];
+    } else {
+        arc->lists[list].tail = arc->prev[node];
+    }
+    arc->lists[list].size--;
+    arc->listOf[node] = -1;
+}
+
+static void arcPushFront (ARCState *arc, int list, int node) {
+    arcUnlink(arc, node);
+    arc->prev[node] = -1;
+    arc->next[node] = arc->lists[list].head;
+    if (arc->lists[list].head != -1) {
+        arc->prev[arc->lists[list].head] = node;
+    } else {
+        arc->lists[list].tail = node;
+    }
+    arc->lists[list].head = node;
+    arc->lists[list].size++;
+    arc->listOf[node] = list;
+}
+
+/*
+ * Forgets a ghost entry.
+ */
+static void arcDropGhost (BM_PoolData *poolData, int node) {
+    ARCState *arc = poolData->arc;
+    int ghost = node - poolData->numFrames;
+
+    arcUnlink(arc, node);
+    pageTableRemove(&arc->ghostTable, arc->ghostFileId[ghost], arc->ghostPageNum[ghost]);
+    arc->freeGhosts[arc->numFreeGhosts++] = node;
+}
+
+/*
+ * Moves the page of a frame that is being evicted to the ghost list
+ * matching the resident list it was on.
+ *
+ * @return The ghost node now remembering the page
+ */
+static int arcEvict (BM_PoolData *poolData, int index) {
+    ARCState *arc = poolData->arc;
+    int list = (arc->listOf[index] == ARC_T1) ? ARC_B1 : ARC_B2;
+
+    arcUnlink(arc, index);
+
+    // Make room the way ARC does: from B1 once T1 and B1 fill the pool, otherwise from B2
+    if (arc->numFreeGhosts == 0) {
+        bool fromB1 = arc->lists[ARC_B2].size == 0 ||
+                      (arc->lists[ARC_B1].size > 0 &&
+                       arc->lists[ARC_T1].size + arc->lists[ARC_B1].size >= poolData->numFrames);
+        arcDropGhost(poolData, fromB1 ? arc->lists[ARC_B1].tail : arc->lists[ARC_B2].tail);
+    }
+
+    int node = arc->freeGhosts[--arc->numFreeGhosts];
+    int ghost = node - poolData->numFrames;
+    arc->ghostFileId[ghost] = poolData->frames[index].fileId;
+    arc->ghostPageNum[ghost] = poolData->frames[index].pageNumber;
+    pageTableInsert(&arc->ghostTable, arc->ghostFileId[ghost], arc->ghostPageNum[ghost], node);
+    arcPushFront(arc, list, node);
+    return node;
+}
+
+/*
+ * Looks up the ghost entry of a page about to be loaded and adapts the
+ * target size of T1: a ghost hit in B1 means T1 was too small, one in B2
+ * means T2 was.
+ *
+ * @return The ghost node, or -1 if the page is not remembered
+ */
+static int arcAdapt (BM_PoolData *poolData, int fileId, PageNumber pageNum) {
+    ARCState *arc = poolData->arc;
+    int node = pageTableLookup(&arc->ghostTable, fileId, pageNum);
+    int sizeB1 = arc->lists[ARC_B1].size;
+    int sizeB2 = arc->lists[ARC_B2].size;
+
+    if (node == -1) {
+        return -1;
+    }
+
+    if (arc->listOf[node] == ARC_B1) {
+        int delta = (sizeB2 > sizeB1) ? sizeB2 / sizeB1 : 1;
+        arc->target = (arc->target + delta < poolData->numFrames) ? arc->target + delta : poolData->numFrames;
+    } else {
+        int delta = (sizeB1 > sizeB2) ? sizeB1 / sizeB2 : 1;
+        arc->target = (arc->target - delta > 0) ? arc->target - delta : 0;
+    }
+    return node;
+}
+
+/*
+ * Puts a page just read into a frame on T1, or on T2 if it had a ghost
+ * entry, and trims the ghost lists back to their bounds.
+ */
+static void arcAdmit (BM_PoolData *poolData, int index, int ghostNode) {
+    ARCState *arc = poolData->arc;
+    int numFrames = poolData->numFrames;
+
+    if (ghostNode != -1) {
+        arcDropGhost(poolData, ghostNode);
+        arcPushFront(arc, ARC_T2, index);
+    } else {
+        arcPushFront(arc, ARC_T1, index);
+    }
+
+    // |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+    while (arc->lists[ARC_B1].size > 0 &&
+           arc->lists[ARC_T1].size + arc->lists[ARC_B1].size > numFrames) {
+        arcDropGhost(poolData, arc->lists[ARC_B1].tail);
+    }
+    while (arc->lists[ARC_B2].size > 0 &&
+           arc->lists[ARC_T1].size + arc->lists[ARC_T2].size +
+           arc->lists[ARC_B1].size + arc->lists[ARC_B2].size > 2 * numFrames) {
+        arcDropGhost(poolData, arc->lists[ARC_B2].tail);
+    }
+}
+
+/*
+ * Claims the least recently used unpinned frame of a resident list.
+ */
+static int arcClaimTail (BM_PoolData *poolData, PageTableStripe *held, int list) {
+    ARCState *arc = poolData->arc;
+    int node = arc->lists[list].tail;
+
+    while (node != -1 && !claimFrame(poolData, held, node)) {
+        node = arc->prev[node];
+    }
+    return node;
+}
+
+static void freeARCState (ARCState *arc) {
+    if (arc == NULL) {
+        return;
+    }
+    free(arc->prev);
+    free(arc->next);
+    free(arc->listOf);
+    free(arc->ghostFileId);
+    free(arc->ghostPageNum);
+    free(arc->freeGhosts);
+    free(arc->ghostTable.entries);
+    free(arc);
+}
+
+static ARCState *createARCState (int numFrames) {
+    // As many ghost entries as frames; B1 and B2 together never need more once the pool is full
+    int numNodes = 2 * numFrames;
+    ARCState *arc = calloc(1, sizeof(ARCState));
+    if (arc == NULL) {
+        return NULL;
+    }
+
+    arc->prev = malloc(sizeof(int) * numNodes);
+    arc->next = malloc(sizeof(int) * numNodes);
+    arc->listOf = malloc(sizeof(int) * numNodes);
+    arc->ghostFileId = malloc(sizeof(int) * numFrames);
+    arc->ghostPageNum = malloc(sizeof(PageNumber) * numFrames);
+    arc->freeGhosts = malloc(sizeof(int) * numFrames);
+    if (arc->prev == NULL || arc->next == NULL || arc->listOf == NULL || arc->ghostFileId == NULL ||
+        arc->ghostPageNum == NULL || arc->freeGhosts == NULL ||
+        pageTableInit(&arc->ghostTable, numFrames) != RC_OK) {
+        freeARCState(arc);
+        return NULL;
+    }
+
+    for (int i = 0; i < ARC_NUM_LISTS; i++) {
+        arc->lists[i].head = -1;
+        arc->lists[i].tail = -1;
+        arc->lists[i].size = 0;
+    }
+    for (int i = 0; i < numNodes; i++) {
+        arc->prev[i] = -1;
+        arc->next[i] = -1;
+        arc->listOf[i] = -1;
+    }
+    arc->numFreeGhosts = numFrames;
+    for (int i = 0; i < numFrames; i++) {
+        arc->freeGhosts[i] = numNodes - 1 - i;
+    }
+    return arc;
+}
+
+// Access ring helpers
+
+/*
+ * Hands a frame of an access ring over to the strategy, as if its page had
+ * just been read the usual way. Called with the pool mutex held.
+ */
+static void ringAdopt (BM_PoolData *poolData, int index) {
+    Frames *frame = &poolData->frames[index];
+
+    frame->ringId = 0;
+    if (frame->pageNumber == NO_PAGE) {
+        return;
+    }
+    if (poolData->strategy == RS_LRU) {
+        lruPushFront(poolData, index);
+    } else if (poolData->strategy == RS_LRU_K) {
+        lrukLoad(poolData, index, frame->fileId, frame->pageNumber);
+    } else if (poolData->strategy == RS_ARC) {
+        arcAdmit(poolData, index, -1);
+    }
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapUpdate(poolData, index);
+    }
+}
+
+/*
+ * Takes a frame a page was just read into off the strategy's lists and adds
+ * it to an access ring. A full ring gives the frame it would have recycled
+ * next back to the strategy instead. Called with the pool mutex held.
+ */
+static void ringAttach (BM_PoolData *poolData, BM_RingData *ring, int index) {
+    Frames *frames = poolData->frames;
+
+    if (poolData->strategy == RS_LRU) {
+        lruUnlink(poolData, index);
+    } else if (poolData->strategy == RS_ARC) {
+        arcUnlink(poolData->arc, index);
+    }
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapRemove(poolData, index);
+    }
+    frames[index].ringId = ring->id;
+
+    if (ring->count < ring->numFrames) {
+        ring->frames[ring->count++] = index;
+        return;
+    }
+    int displaced = ring->frames[ring->next];
+    if (frames[displaced].ringId == ring->id) {
+        ringAdopt(poolData, displaced);
+    }
+    ring->frames[ring->next] = index;
+    ring->next = (ring->next + 1) % ring->numFrames;
+}
+
+/*
+ * Claims the oldest unpinned frame of an access ring, looking at no more
+ * than tries of them. Called with the pool mutex held.
+ *
+ * @return Index of the claimed frame, or -1 if none could be claimed
+ */
+static int ringClaim (BM_PoolData *poolData, PageTableStripe *held, BM_RingData *ring, int tries) {
+    int claimed = -1;
+
+    poolData->claimRingId = ring->id;
+    for (int i = 0; i < tries && i < ring->count && claimed == -1; i++) {
+        int slot = (ring->next + i) % ring->count;
+        if (claimFrame(poolData, held, ring->frames[slot])) {
+            claimed = ring->frames[slot];
+            ring->next = (slot + 1) % ring->numFrames;
+        }
+    }
+    poolData->claimRingId = 0;
+    return claimed;
+}
+
+/*
+ * Claims an unpinned frame of any access ring and takes it out of that
+ * ring, for a pin that found every other frame pinned. Called with the
+ * pool mutex held.
+ *
+ * @return Index of the claimed frame, or -1 if none could be claimed
+ */
+static int ringSteal (BM_PoolData *poolData, PageTableStripe *held) {
+    int claimed = -1;
+
+    for (int i = 0; i < poolData->numFrames && claimed == -1; i++) {
+        poolData->claimRingId = poolData->frames[i].ringId;
+        if (poolData->claimRingId != 0 && claimFrame(poolData, held, i)) {
+            poolData->frames[i].ringId = 0;
+            claimed = i;
+        }
+    }
+    poolData->claimRingId = 0;
+    return claimed;
+}
+
+/*
+ * Puts a frame a page was just read into on the strategy's lists.
+ * Called with the pool mutex held.
+ */
+static void admitFrame (BM_PoolData *poolData, int index, int fileId, PageNumber pageNum) {
+    if (poolData->strategy == RS_LRU_K) {
+        lrukLoad(poolData, index, fileId, pageNum);
+    } else if (poolData->strategy == RS_LRU) {
+        lruPushFront(poolData, index);
+    } else if (poolData->strategy == RS_ARC) {
+        arcAdmit(poolData, index, arcAdapt(poolData, fileId, pageNum));
+    }
+}
+
+static uint64_t monotonicNanos (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/*
+ * Adds the time since an I/O started to a latency histogram.
+ *
+ * @param histogram  BM_LATENCY_BUCKETS counters, bucket i for 2^i up to 2^(i+1) nanoseconds
+ * @param startNanos monotonicNanos when the I/O started
+ */
+static void countLatency (_Atomic uint64_t *histogram, uint64_t startNanos) {
+    uint64_t elapsed = monotonicNanos() - startNanos;
+    int bucket = (elapsed == 0) ? 0 : 63 - __builtin_clzll(elapsed);
+    if (bucket >= BM_LATENCY_BUCKETS) {
+        bucket = BM_LATENCY_BUCKETS - 1;
+    }
+    COUNT_EVENT(histogram[bucket]);
+}
+
+/*
+ * Writes the page held in a frame back to its page file under the frame's
+ * latch, leaving the dirty flag and the counters to the caller.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param index    Index of the frame to write
+ * @param fHandle  Handle of the page's file
+ * @return         RC_OK on success, or an error code otherwise
+ */
+static RC writeFrame (BM_PoolData *poolData, int index, SM_FileHandle *fHandle) {
+    Frames *frames = poolData->frames;
+    RC rc;
+
+    lockLatchForWrite(&frames[index].latch);
+    uint64_t start = monotonicNanos();
+    if (poolData->mapFiles) {
+        // The frame is the page in the mapping, so only the sync is left
+        rc = syncBlocks(frames[index].pageNumber, 1, fHandle);
+    } else {
+        rc = writeBlock(frames[index].pageNumber, fHandle, frames[index].memPage);
+    }
+    countLatency(poolData->counters->writeLatency, start);
+    if (rc == RC_OK) {
+        atomic_fetch_add(&poolData->writeSeq, 1);
+    }
+    releaseLatchAfterWrite(&frames[index].latch);
+
+    return rc;
+}
+
+/*
+ * Writes the page held in a frame back to its page file and clears its dirty
+ * flag. Called with the whole pool locked.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param index    Index of the frame to write
+ * @return         RC_OK on success, or an error code otherwise
+ */
+static RC writeFrameToDisk (BM_PoolData *poolData, int index) {
+    Frames *frames = poolData->frames;
+    BM_PoolFile *file = &poolData->files[frames[index].fileId];
+
+    RC rc = writeFrame(poolData, index, &file->fHandle);
+    if (rc == RC_OK) {
+        frames[index].dirty = false;
+        file->writtenToDisk++;
+        poolData->writtenToDisk++;
+    }
+    return rc;
+}
+
+/*
+ * Reads a page from a page file into a frame, growing the file first if needed.
+ * A pool with mapped files points the frame at the page in the mapping
+ * instead, which needs the page to exist in the file.
+ * The caller holds the frame's latch.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param frame    Frame to fill
+ * @param fHandle  Handle of the file to read from
+ * @param pageNum  Page number to read
+ * @return         RC_OK on success, or an error code otherwise
+ */
+static RC readPageIntoFrame (BM_PoolData *poolData, Frames *frame, SM_FileHandle *fHandle,
+                             const PageNumber pageNum) {
+    RC rc = RC_OK;
+
+    if (poolData->mapFiles) {
+        if (pageNum >= fHandle->totalNumPages) {
+            rc = ensureCapacity(pageNum + 1, fHandle);
+        }
+        if (rc == RC_OK) {
+            rc = mapBlock(pageNum, fHandle, &frame->memPage);
+        }
+        return rc;
+    }
+
+    // Only pages beyond the known end of the file need the capacity check
+    if (pageNum > fHandle->totalNumPages) {
+        rc = ensureCapacity(pageNum, fHandle);
+    }
+    if (rc == RC_OK) {
+        rc = readBlock(pageNum, fHandle, frame->memPage);
+    }
+    return rc;
+}
+
+/*
+ * Carries the page count a handle copy learned during unlocked I/O back to
+ * the file's own handle.
+ */
+static void updatePageCount (BM_PoolData *poolData, int fileId, SM_FileHandle *copy) {
+    SM_FileHandle *fHandle = &poolData->files[fileId].fHandle;
+    if (copy->totalNumPages > fHandle->totalNumPages) {
+        fHandle->totalNumPages = copy->totalNumPages;
+    }
+}
+
+/*
+ * Wakes the pins waiting for a frame once one can be evicted again.
+ * Called with the pool mutex held.
+ */
+static void signalFrameFreed (BM_PoolData *poolData) {
+    if (poolData->pinWaiters > 0) {
+        pthread_cond_broadcast(&poolData->frameFreed);
+    }
+}
+
+/*
+ * Loads a page into a frame claimed by claimFrame, writing back the frame's
+ * old page first if it is dirty. Called with the new page's stripe lock and
+ * the pool mutex held; both are released for the I/O and held again on
+ * return. Meanwhile the frame stays marked as in progress, so pins of the
+ * old or the new page wait for it rather than reading the page again.
+ * If the write fails the frame keeps its old page, if the read fails it is
+ * returned to the free list; either way it is unpinned again.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param page     Page handle to point at the new page
+ * @param stripe   Stripe of the new page, with room reserved for it
+ * @param index    Index of the claimed frame
+ * @param fileId   File of the new page
+ * @param pageNum  Page number of the new page
+ * @param batch    Pages already read that the new page is copied from if
+ *                 it is among them and no write-back since can have
+ *                 outdated them, NULL to read it
+ * @return         RC_OK on success, or an error code otherwise
+ */
+static RC replaceFrame (BM_PoolData *poolData, BM_PageHandle *const page, PageTableStripe *stripe,
+                        int index, int fileId, const PageNumber pageNum, const BM_ReadBatch *batch) {
+    Frames *frames = poolData->frames;
+    int oldFileId = frames[index].fileId;
+    PageNumber oldPageNum = frames[index].pageNumber;
+    PageTableStripe *oldStripe = NULL;
+    bool wasDirty = false;
+    RC rc = RC_OK;
+
+    // The files array may move while the locks are released, so work on copies of the handles
+    SM_FileHandle oldHandle;
+    SM_FileHandle newHandle = poolData->files[fileId].fHandle;
+
+    // A write-back of the page after the run was read has to land in the page
+    // table before the page can miss again, so writeSeq tells it apart here
+    SM_PageHandle readCopy = NULL;
+    if (batch != NULL && batch->fileId == fileId && atomic_load(&poolData->writeSeq) == batch->writeSeq) {
+        for (int i = 0; i < batch->numRuns && readCopy == NULL; i++) {
+            const BM_ReadRun *run = &batch->runs[i];
+            if (pageNum >= run->firstPage && pageNum < run->firstPage + run->numPages) {
+                readCopy = run->data + (size_t) (pageNum - run->firstPage) * newHandle.pageSize;
+            }
+        }
+    }
+
+    if (oldPageNum != NO_PAGE) {
+        TRACE_EVENT(TRACE_EVICT, oldFileId, oldPageNum);
+        oldStripe = pageStripe(poolData, oldFileId, oldPageNum);
+        oldHandle = poolData->files[oldFileId].fHandle;
+        wasDirty = frames[index].dirty;
+    }
+    if (wasDirty) {
+        // The background writer is falling behind
+        COUNT_EVENT(poolData->counters->dirtyEvictions);
+        if (poolData->writerRunning) {
+            pthread_cond_signal(&poolData->writerCond);
+        }
+    }
+
+    // From here on pins of the new page find the frame and wait for it
+    pageTableInsert(&stripe->table, fileId, pageNum, index);
+    poolData->ioInFlight++;
+    pthread_mutex_unlock(&poolData->poolMutex);
+    pthread_mutex_unlock(&stripe->lock);
+
+    lockLatchForWrite(&frames[index].latch);
+    if (wasDirty) {
+        uint64_t start = monotonicNanos();
+        rc = writeBlock(oldPageNum, &oldHandle, frames[index].memPage);
+        countLatency(poolData->counters->writeLatency, start);
+        if (rc == RC_OK) {
+            atomic_fetch_add(&poolData->writeSeq, 1);
+        }
+    }
+    bool written = (wasDirty && rc == RC_OK);
+    if (rc == RC_OK && readCopy != NULL) {
+        memcpy(frames[index].memPage, readCopy, newHandle.pageSize);
+    } else if (rc == RC_OK) {
+        uint64_t start = monotonicNanos();
+        rc = readPageIntoFrame(poolData, &frames[index], &newHandle, pageNum);
+        countLatency(poolData->counters->readLatency, start);
+    }
+    releaseLatchAfterWrite(&frames[index].latch);
+
+    if (wasDirty && !written) {
+        // The old page could not be written back and stays; pins of the new page look again
+        pthread_mutex_lock(&stripe->lock);
+        pageTableRemove(&stripe->table, fileId, pageNum);
+        pthread_cond_broadcast(&stripe->ioDone);
+        pthread_mutex_unlock(&stripe->lock);
+
+        pthread_mutex_lock(&oldStripe->lock);
+        frames[index].ioInProgress = false;
+        frames[index].fix_cnt = 0;
+        pthread_cond_broadcast(&oldStripe->ioDone);
+        pthread_mutex_unlock(&oldStripe->lock);
+
+        pthread_mutex_lock(&stripe->lock);
+        pthread_mutex_lock(&poolData->poolMutex);
+        poolData->ioInFlight--;
+        pthread_cond_broadcast(&poolData->poolCond);
+        signalFrameFreed(poolData);
+        return rc;
+    }
+
+    // The old page is on disk, pins of it look again and read it back
+    if (oldStripe != NULL) {
+        COUNT_EVENT(poolData->counters->evictions);
+        pthread_mutex_lock(&oldStripe->lock);
+        pageTableRemove(&oldStripe->table, oldFileId, oldPageNum);
+        pthread_cond_broadcast(&oldStripe->ioDone);
+        pthread_mutex_unlock(&oldStripe->lock);
+    }
+
+    pthread_mutex_lock(&stripe->lock);
+    pthread_mutex_lock(&poolData->poolMutex);
+    poolData->ioInFlight--;
+    pthread_cond_broadcast(&poolData->poolCond);
+    if (written) {
+        poolData->files[oldFileId].writtenToDisk++;
+        poolData->writtenToDisk++;
+        updatePageCount(poolData, oldFileId, &oldHandle);
+    }
+
+    if (rc != RC_OK) {
+        pageTableRemove(&stripe->table, fileId, pageNum);
+        frames[index].fileId = 0;
+        frames[index].pageNumber = NO_PAGE;
+        frames[index].fix_cnt = 0;
+        frames[index].lruOrder = 0;
+        frames[index].referenced = false;
+        frames[index].ioInProgress = false;
+        frames[index].ringId = 0;
+        poolData->freeFrames[poolData->numFreeFrames++] = index;
+        pthread_cond_broadcast(&stripe->ioDone);
+        signalFrameFreed(poolData);
+        return rc;
+    }
+
+    poolData->files[fileId].readFromDisk++;
+    poolData->readFromDisk++;
+    updatePageCount(poolData, fileId, &newHandle);
+
+    frames[index].fileId = fileId;
+    frames[index].pageNumber = pageNum;
+    frames[index].dirty = false;
+    frames[index].lruOrder = ++poolData->lruCounter;
+    frames[index].referenced = true;
+    frames[index].frequency = 1;
+    frames[index].ioInProgress = false;
+    pthread_cond_broadcast(&stripe->ioDone);
+    page->pageNum = pageNum;
+    page->data = frames[index].memPage;
+
+    return RC_OK;
+}
+
+/*
+ * Pins a frame for a write-back made with the locks released and marks it
+ * clean, so a markDirty during the write leaves it dirty. Called with the
+ * stripe lock of its page and the pool mutex held.
+ */
+static void startFrameWrite (BM_PoolData *poolData, int index) {
+    poolData->frames[index].fix_cnt++;
+    poolData->frames[index].dirty = false;
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapRemove(poolData, index);
+    }
+    poolData->ioInFlight++;
+}
+
+/*
+ * Unpins a frame after a write-back started by startFrameWrite, leaving it
+ * dirty if the write failed. Called without locks.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param index    Index of the written frame
+ * @param rc       Result of the write
+ * @param fHandle  Copy of the file's handle the page was written through
+ */
+static void endFrameWrite (BM_PoolData *poolData, int index, RC rc, SM_FileHandle *fHandle) {
+    Frames *frames = poolData->frames;
+    int fileId = frames[index].fileId;
+    PageTableStripe *stripe = pageStripe(poolData, fileId, frames[index].pageNumber);
+
+    pthread_mutex_lock(&stripe->lock);
+    if (rc != RC_OK) {
+        frames[index].dirty = true;
+    }
+    frames[index].fix_cnt--;
+    pthread_mutex_unlock(&stripe->lock);
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    if (rc == RC_OK) {
+        poolData->files[fileId].writtenToDisk++;
+        poolData->writtenToDisk++;
+        updatePageCount(poolData, fileId, fHandle);
+    }
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapUpdate(poolData, index);
+    }
+    poolData->ioInFlight--;
+    pthread_cond_broadcast(&poolData->poolCond);
+    signalFrameFreed(poolData);
+    pthread_mutex_unlock(&poolData->poolMutex);
+}
+
+/*
+ * Lists the frames the pool's strategy will evict next, nearest first.
+ * Heap based strategies are listed in heap order, which is close enough.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param out      Receives up to max frame indexes
+ * @param max      Number of frames wanted
+ * @return         Number of frames listed
+ */
+static int collectEvictionCandidates (BM_PoolData *poolData, int *out, int max) {
+    int numFrames = poolData->numFrames;
+    int n = 0;
+
+    switch (poolData->strategy) {
+        case RS_LRU:
+            for (int i = poolData->lruTail; i != -1 && n < max; i = poolData->frames[i].lruPrev) {
+                out[n++] = i;
+            }
+            break;
+        case RS_ARC:
+            for (int list = ARC_T1; list <= ARC_T2; list++) {
+                for (int i = poolData->arc->lists[list].tail; i != -1 && n < max; i = poolData->arc->prev[i]) {
+                    out[n++] = i;
+                }
+            }
+            break;
+        case RS_LFU:
+        case RS_LRU_K:
+            for (int i = 0; i < poolData->victimHeap.size && n < max; i++) {
+                out[n++] = poolData->victimHeap.frames[i];
+            }
+            for (int i = 0; i < poolData->lrukPeriodHeap.size && n < max; i++) {
+                out[n++] = poolData->lrukPeriodHeap.frames[i];
+            }
+            break;
+        case RS_CLOCK:
+            for (int i = 0; i < numFrames && n < max; i++) {
+                out[n++] = (poolData->clockHand + i) % numFrames;
+            }
+            break;
+        default:
+            for (int i = 0; i < numFrames && n < max; i++) {
+                out[n++] = (poolData->readFromDisk + i) % numFrames;
+            }
+            break;
+    }
+    return n;
+}
+
+/*
+ * Prepares a dirty, unpinned frame for the background writer to clean: pins
+ * it, so it cannot be evicted and read back before the write lands, and
+ * unless its file is mapped copies its page, so pins may change the page
+ * meanwhile. Called with the pool mutex held.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param index    Frame to clean
+ * @param copy     Receives the copy of the page
+ * @param fHandle  Receives a copy of the handle of the page's file
+ */
+static void startBackgroundWrite (BM_PoolData *poolData, int index, SM_PageHandle copy, SM_FileHandle *fHandle) {
+    Frames *frames = poolData->frames;
+
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapRemove(poolData, index);
+    }
+    frames[index].fix_cnt++;
+    frames[index].dirty = false;
+    if (!poolData->mapFiles) {
+        memcpy(copy, frames[index].memPage, poolData->pageSize);
+    }
+    *fHandle = poolData->files[frames[index].fileId].fHandle;
+    poolData->writesInFlight++;
+}
+
+/*
+ * Unpins a frame the background writer is done with, leaving it dirty if
+ * its write failed. Called with the pool mutex held.
+ */
+static void endBackgroundWrite (BM_PoolData *poolData, int index, RC rc) {
+    Frames *frames = poolData->frames;
+
+    poolData->writesInFlight--;
+    if (rc == RC_OK) {
+        poolData->files[frames[index].fileId].writtenToDisk++;
+        poolData->writtenToDisk++;
+    } else {
+        frames[index].dirty = true;
+    }
+    frames[index].fix_cnt--;
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapUpdate(poolData, index);
+    }
+    pthread_cond_broadcast(&poolData->poolCond);
+}
+
+/*
+ * Background writer. Every BM_WRITER_INTERVAL_MS, or sooner when a pin had
+ * to write a victim itself, it writes back dirty unpinned frames among the
+ * writerWindow frames nearest eviction, at most writerBatch per round. The
+ * frames are cleaned BM_IO_DEPTH at a time: their pages are copied while the
+ * pool mutex is held, then written with the mutex released. Writes to files
+ * opened for direct I/O are all in flight at once on an I/O queue of the
+ * writer's own; other writes only copy into the page cache, where a queue
+ * costs more than it saves, and go one at a time. Pages of mapped files are
+ * synced where they are instead; copying them back could undo newer changes.
+ */
+static void *backgroundWriter (void *arg) {
+    BM_PoolData *poolData = arg;
+    int indexes[BM_IO_DEPTH];
+    PageNumber pageNums[BM_IO_DEPTH];
+    SM_FileHandle handles[BM_IO_DEPTH];
+    RC results[BM_IO_DEPTH];
+    SM_IOCompletion completions[BM_IO_DEPTH];
+    SM_IOQueue ioQueue;
+    bool haveQueue = (poolData->directIO && initIOQueue(&ioQueue, BM_IO_DEPTH, SM_IO_URING) == RC_OK);
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    while (!poolData->writerStop) {
+        int n = collectEvictionCandidates(poolData, poolData->writerCandidates, poolData->writerWindow);
+        int written = 0;
+
+        for (int i = 0; i < n && written < poolData->writerBatch && !poolData->writerStop; ) {
+            int numWrites = 0;
+            for (; i < n && written + numWrites < poolData->writerBatch && numWrites < BM_IO_DEPTH; i++) {
+                int index = poolData->writerCandidates[i];
+                // Frames may have changed while earlier writes were in progress
+                if (poolData->frames[index].pageNumber != NO_PAGE && poolData->frames[index].dirty &&
+                    poolData->frames[index].fix_cnt == 0) {
+                    startBackgroundWrite(poolData, index, poolData->writerPages + (size_t) numWrites * poolData->pageSize,
+                                         &handles[numWrites]);
+                    indexes[numWrites] = index;
+                    pageNums[numWrites] = poolData->frames[index].pageNumber;
+                    numWrites++;
+                }
+            }
+            if (numWrites == 0) {
+                continue;
+            }
+            pthread_mutex_unlock(&poolData->poolMutex);
+
+            uint64_t start = monotonicNanos();
+            int inFlight = 0;
+            for (int k = 0; k < numWrites; k++) {
+                SM_PageHandle copy = poolData->writerPages + (size_t) k * poolData->pageSize;
+                if (poolData->mapFiles) {
+                    results[k] = syncBlocks(pageNums[k], 1, &handles[k]);
+                } else if (!haveQueue || getAccessMode(&handles[k]) != SM_ACCESS_DIRECT ||
+                           submitWrite(&ioQueue, pageNums[k], 1, &handles[k], copy, (void *) (intptr_t) k) != RC_OK) {
+                    results[k] = writeBlock(pageNums[k], &handles[k], copy);
+                } else {
+                    results[k] = RC_WRITE_FAILED;
+                    inFlight++;
+                    continue;
+                }
+                countLatency(poolData->counters->writeLatency, start);
+                if (results[k] == RC_OK) {
+                    atomic_fetch_add(&poolData->writeSeq, 1);
+                }
+            }
+            while (inFlight > 0) {
+                int done = 0;
+                if (waitIOQueue(&ioQueue, completions, 1, BM_IO_DEPTH, &done) != RC_OK || done == 0) {
+                    // Once the queue is shut down nothing writes from the copies anymore; the
+                    // writes left count as failed and their frames stay dirty
+                    shutdownIOQueue(&ioQueue);
+                    haveQueue = false;
+                    break;
+                }
+                for (int c = 0; c < done; c++) {
+                    int k = (int) (intptr_t) completions[c].userData;
+                    results[k] = completions[c].rc;
+                    countLatency(poolData->counters->writeLatency, start);
+                    if (results[k] == RC_OK) {
+                        atomic_fetch_add(&poolData->writeSeq, 1);
+                    }
+                    inFlight--;
+                }
+            }
+
+            pthread_mutex_lock(&poolData->poolMutex);
+            for (int k = 0; k < numWrites; k++) {
+                TRACE_EVENT(TRACE_BACKGROUND_WRITE, poolData->frames[indexes[k]].fileId, pageNums[k]);
+                endBackgroundWrite(poolData, indexes[k], results[k]);
+            }
+            written += numWrites;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += BM_WRITER_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        if (!poolData->writerStop) {
+            pthread_cond_timedwait(&poolData->writerCond, &poolData->poolMutex, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&poolData->poolMutex);
+
+    if (haveQueue) {
+        shutdownIOQueue(&ioQueue);
+    }
+    return NULL;
+}
+
+/*
+ * Starts the background writer if the options ask for one.
+ *
+ * @return RC_OK on success, or RC_BP_INIT_ERROR if the thread cannot be started
+ */
+static RC startBackgroundWriter (BM_PoolData *poolData, const BM_PoolOptions *options) {
+    if (options == NULL || options->writerCleanRatio <= 0) {
+        return RC_OK;
+    }
+
+    double ratio = (options->writerCleanRatio < 1) ? options->writerCleanRatio : 1;
+    poolData->writerWindow = (int) (ratio * poolData->numFrames);
+    if (poolData->writerWindow < 1) {
+        poolData->writerWindow = 1;
+    }
+    poolData->writerBatch = poolData->writerWindow;
+    if (options->writerPagesPerSecond > 0) {
+        poolData->writerBatch = options->writerPagesPerSecond * BM_WRITER_INTERVAL_MS / 1000;
+        if (poolData->writerBatch < 1) {
+            poolData->writerBatch = 1;
+        }
+    }
+
+    // The copies of the pages being written are aligned like the frames, for direct I/O
+    poolData->writerCandidates = malloc(sizeof(int) * poolData->numFrames);
+    if (poolData->writerCandidates == NULL ||
+        posix_memalign((void **) &poolData->writerPages, BM_FRAME_ALIGNMENT, (size_t) BM_IO_DEPTH * poolData->pageSize) != 0) {
+        return RC_BP_INIT_ERROR;
+    }
+
+    pthread_cond_init(&poolData->writerCond, NULL);
+    if (pthread_create(&poolData->writerThread, NULL, backgroundWriter, poolData) != 0) {
+        pthread_cond_destroy(&poolData->writerCond);
+        return RC_BP_INIT_ERROR;
+    }
+    poolData->writerRunning = true;
+    return RC_OK;
+}
+
+static void stopBackgroundWriter (BM_PoolData *poolData) {
+    if (!poolData->writerRunning) {
+        return;
+    }
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    poolData->writerStop = true;
+    pthread_cond_signal(&poolData->writerCond);
+    pthread_mutex_unlock(&poolData->poolMutex);
+
+    pthread_join(poolData->writerThread, NULL);
+    pthread_cond_destroy(&poolData->writerCond);
+    poolData->writerRunning = false;
+}
+
+/*
+ * Waits until no background write is in progress, so every frame the writer
+ * pinned is released. Called with the pool mutex held.
+ */
+static void waitForBackgroundWrites (BM_PoolData *poolData) {
+    while (poolData->writesInFlight > 0) {
+        pthread_cond_wait(&poolData->poolCond, &poolData->poolMutex);
+    }
+}
+
+static void *prefetcher (void *arg);
+
+/*
+ * Starts the prefetcher unless it runs already. Called with the pool mutex held.
+ */
+static RC startPrefetcher (BM_PoolData *poolData) {
+    if (poolData->prefetcherRunning) {
+        return RC_OK;
+    }
+
+    pthread_cond_init(&poolData->prefetchCond, NULL);
+    if (pthread_create(&poolData->prefetcherThread, NULL, prefetcher, poolData) != 0) {
+        pthread_cond_destroy(&poolData->prefetchCond);
+        return RC_BP_PIN_ERROR;
+    }
+    poolData->prefetcherRunning = true;
+    return RC_OK;
+}
+
+static void stopPrefetcher (BM_PoolData *poolData) {
+    if (!poolData->prefetcherRunning) {
+        return;
+    }
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    poolData->prefetcherStop = true;
+    pthread_cond_signal(&poolData->prefetchCond);
+    pthread_mutex_unlock(&poolData->poolMutex);
+
+    pthread_join(poolData->prefetcherThread, NULL);
+    pthread_cond_destroy(&poolData->prefetchCond);
+    poolData->prefetcherRunning = false;
+}
+
+/*
+ * Removes the pages of a file, or those bound for an access ring, from the
+ * prefetch queue and waits until the prefetcher is not loading one.
+ * Called with the pool mutex held.
+ *
+ * @param fileId File whose pages to drop, -1 for none
+ * @param ring   Access ring whose pages to drop, NULL for none
+ */
+static void dropPrefetches (BM_PoolData *poolData, int fileId, BM_RingData *ring) {
+    int kept = 0;
+
+    for (int i = 0; i < poolData->prefetchCount; i++) {
+        BM_PrefetchRequest request = poolData->prefetchQueue[(poolData->prefetchHead + i) % BM_PREFETCH_QUEUE_SIZE];
+        if (request.fileId != fileId && (ring == NULL || request.ring != ring)) {
+            poolData->prefetchQueue[(poolData->prefetchHead + kept++) % BM_PREFETCH_QUEUE_SIZE] = request;
+        }
+    }
+    poolData->prefetchCount = kept;
+    if (fileId != -1) {
+        free(poolData->files[fileId].warmPages);
+        poolData->files[fileId].warmPages = NULL;
+    }
+
+    while ((fileId != -1 && poolData->prefetchFileId == fileId) ||
+           (ring != NULL && poolData->prefetchRing == ring)) {
+        pthread_cond_wait(&poolData->poolCond, &poolData->poolMutex);
+    }
+}
+
+/*
+ * Allocates the memory of all frames in one block aligned to
+ * BM_FRAME_ALIGNMENT. With hugePages an arena of at least one huge page is
+ * mapped instead and the kernel is asked to back it with huge pages; that
+ * is only advice, so a kernel that declines is not an error.
+ *
+ * @param poolData  Bookkeeping of the buffer pool, numFrames and pageSize set
+ * @param hugePages Whether to ask for huge pages
+ * @return          RC_OK on success, or RC_BP_INIT_ERROR if memory allocation fails
+ */
+static RC allocFrameArena (BM_PoolData *poolData, bool hugePages) {
+    size_t size = (size_t) poolData->numFrames * poolData->pageSize;
+    void *arena = NULL;
+
+    size = (size + BM_FRAME_ALIGNMENT - 1) / BM_FRAME_ALIGNMENT * BM_FRAME_ALIGNMENT;
+    if (hugePages && size >= BM_HUGE_PAGE_SIZE) {
+        size = (size + BM_HUGE_PAGE_SIZE - 1) / BM_HUGE_PAGE_SIZE * BM_HUGE_PAGE_SIZE;
+        arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED) {
+            return RC_BP_INIT_ERROR;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(arena, size, MADV_HUGEPAGE);
+#endif
+        poolData->arenaMapped = true;
+    } else if (posix_memalign(&arena, BM_FRAME_ALIGNMENT, size) != 0) {
+        return RC_BP_INIT_ERROR;
+    }
+
+    poolData->arena = arena;
+    poolData->arenaSize = size;
+    return RC_OK;
+}
+
+/*
+ * Releases everything a pool owns. Also used to unwind a partially
+ * initialized pool, so every member may still be NULL.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ */
+static void freePoolData (BM_PoolData *poolData) {
+    Frames *frames = poolData->frames;
+
+    if (frames != NULL) {
+        for (int i = 0; i < poolData->numFrames; i++) {
+            destroyLatch(&frames[i].latch);
+        }
+        free(frames);
+    }
+    if (poolData->arenaMapped) {
+        munmap(poolData->arena, poolData->arenaSize);
+    } else {
+        free(poolData->arena);
+    }
+
+    for (int i = 0; i < poolData->numFiles; i++) {
+        if (poolData->files[i].fileName != NULL) {
+            closePageFile(&poolData->files[i].fHandle);
+            free(poolData->files[i].fileName);
+        }
+        free(poolData->files[i].warmPages);
+    }
+    free(poolData->files);
+    if (poolData->stripes != NULL) {
+        for (int i = 0; i < BM_PAGE_TABLE_STRIPES; i++) {
+            pthread_mutex_destroy(&poolData->stripes[i].lock);
+            pthread_cond_destroy(&poolData->stripes[i].ioDone);
+            free(poolData->stripes[i].table.entries);
+        }
+        free(poolData->stripes);
+    }
+    free(poolData->freeFrames);
+    free(poolData->victimHeap.frames);
+    free(poolData->lrukPeriodHeap.frames);
+    free(poolData->lrukHistory);
+    free(poolData->lrukLast);
+    free(poolData->skippedFrames);
+    free(poolData->retainedTable.entries);
+    free(poolData->retained);
+    free(poolData->retainedHistory);
+    freeARCState(poolData->arc);
+    free(poolData->writerCandidates);
+    free(poolData->writerPages);
+    free(poolData->counters);
+    free(poolData);
+}
+
+/*
+ * Allocates the frames and bookkeeping of a pool and starts its background
+ * writer, if any.
+ *
+ * @param numFrames  Number of page frames in the pool
+ * @param pageSize   Bytes per frame
+ * @param strategy   Replacement strategy to be used by the pool
+ * @param stratParam Parameter of the replacement strategy
+ * @param options    Optional pool settings, may be NULL
+ * @return           The new pool, or NULL if memory allocation fails or the options conflict
+ */
+static BM_PoolData *createPoolData (int numFrames, int pageSize, ReplacementStrategy strategy, int stratParam,
+                                    const BM_PoolOptions *options) {
+    // Mapped files go through the page cache, so they cannot also use direct I/O
+    if (options != NULL && options->mapFiles && options->directIO) {
+        return NULL;
+    }
+
+    BM_PoolData *poolData = calloc(1, sizeof(BM_PoolData));
+    if (poolData == NULL) {
+        return NULL;
+    }
+
+    poolData->numFrames = numFrames;
+    poolData->pageSize = pageSize;
+    poolData->strategy = strategy;
+    poolData->stratParam = stratParam;
+    // Frames are cache line sized, so neighbours never share a line
+    poolData->frames = aligned_alloc(BM_CACHE_LINE_SIZE, sizeof(Frames) * numFrames);
+    poolData->freeFrames = malloc(sizeof(int) * numFrames);
+    poolData->stripes = aligned_alloc(BM_CACHE_LINE_SIZE, sizeof(PageTableStripe) * BM_PAGE_TABLE_STRIPES);
+    poolData->counters = aligned_alloc(BM_CACHE_LINE_SIZE, sizeof(BM_PoolCounters));
+    // Frames of mapped files point into the mappings and need no memory of their own
+    poolData->mapFiles = (options != NULL && options->mapFiles);
+    poolData->directIO = (options != NULL && options->directIO);
+    if (poolData->frames == NULL || poolData->freeFrames == NULL || poolData->stripes == NULL ||
+        poolData->counters == NULL ||
+        (!poolData->mapFiles && allocFrameArena(poolData, options != NULL && options->hugePages) != RC_OK)) {
+        freePoolData(poolData);
+        return NULL;
+    }
+    memset(poolData->frames, 0, sizeof(Frames) * numFrames);
+    memset(poolData->counters, 0, sizeof(BM_PoolCounters));
+
+    // Stripe tables start small and grow if pages cluster in a few stripes
+    memset(poolData->stripes, 0, sizeof(PageTableStripe) * BM_PAGE_TABLE_STRIPES);
+    for (int i = 0; i < BM_PAGE_TABLE_STRIPES; i++) {
+        pthread_mutex_init(&poolData->stripes[i].lock, NULL);
+        pthread_cond_init(&poolData->stripes[i].ioDone, NULL);
+    }
+    for (int i = 0; i < BM_PAGE_TABLE_STRIPES; i++) {
+        if (pageTableInit(&poolData->stripes[i].table, numFrames / BM_PAGE_TABLE_STRIPES + 1) != RC_OK) {
+            freePoolData(poolData);
+            return NULL;
+        }
+    }
+
+    // Free frames are handed out lowest index first
+    poolData->numFreeFrames = numFrames;
+    for (int i = 0; i < numFrames; i++) {
+        poolData->freeFrames[i] = numFrames - 1 - i;
+    }
+
+    // Initialize the individual frames in the buffer pool
+    Frames *frames = poolData->frames;
+
+    for (int i = 0; i < numFrames; i++) {
+        frames[i].memPage = poolData->mapFiles ? NULL : poolData->arena + (size_t) i * poolData->pageSize;
+        frames[i].fileId = 0;
+        frames[i].pageNumber = NO_PAGE;
+        frames[i].dirty = false;
+        frames[i].fix_cnt = 0;
+        frames[i].lruOrder = 0;
+        frames[i].referenced = false;
+        frames[i].frequency = 0;
+        frames[i].heapIndex = -1;
+        frames[i].inPeriodHeap = false;
+        frames[i].lruPrev = -1;
+        frames[i].lruNext = -1;
+        frames[i].ioInProgress = false;
+        createLatch(&frames[i].latch);
+    }
+
+    if (USES_VICTIM_HEAP(poolData)) {
+        poolData->victimHeap.frames = malloc(sizeof(int) * numFrames);
+        poolData->skippedFrames = malloc(sizeof(int) * numFrames);
+        if (poolData->victimHeap.frames == NULL || poolData->skippedFrames == NULL) {
+            freePoolData(poolData);
+            return NULL;
+        }
+    }
+
+    if (strategy == RS_LFU) {
+        poolData->lfuDecayPeriod = stratParam;
+    }
+
+    if (strategy == RS_LRU_K) {
+        // K defaults to 2, the variant that distinguishes hot pages from one-off reads
+        int k = (stratParam > 0) ? stratParam : 2;
+
+        poolData->lrukK = k;
+        poolData->numRetained = numFrames;
+        poolData->lrukHistory = calloc((size_t) numFrames * k, sizeof(int));
+        poolData->lrukLast = calloc(numFrames, sizeof(int));
+        poolData->lrukPeriodHeap.frames = malloc(sizeof(int) * numFrames);
+        poolData->retained = malloc(sizeof(LRUKRetained) * numFrames);
+        poolData->retainedHistory = malloc(sizeof(int) * numFrames * k);
+        if (poolData->lrukHistory == NULL || poolData->lrukLast == NULL || poolData->lrukPeriodHeap.frames == NULL ||
+            poolData->retained == NULL || poolData->retainedHistory == NULL ||
+            pageTableInit(&poolData->retainedTable, numFrames) != RC_OK) {
+            freePoolData(poolData);
+            return NULL;
+        }
+        for (int i = 0; i < numFrames; i++) {
+            poolData->retained[i].pageNumber = NO_PAGE;
+        }
+    }
+
+    if (strategy == RS_ARC) {
+        poolData->arc = createARCState(numFrames);
+        if (poolData->arc == NULL) {
+            freePoolData(poolData);
+            return NULL;
+        }
+    }
+
+    poolData->lruHead = -1;
+    poolData->lruTail = -1;
+
+    pthread_mutex_init(&poolData->poolMutex, NULL);
+    pthread_cond_init(&poolData->poolCond, NULL);
+    pthread_cond_init(&poolData->frameFreed, NULL);
+    if (options != NULL && options->pinWaitMillis > 0) {
+        poolData->pinWaitMillis = options->pinWaitMillis;
+    }
+    if (options != NULL && options->readaheadPages > 0) {
+        poolData->readaheadPages = options->readaheadPages;
+    }
+    if (options != NULL) {
+        poolData->warmRestart = options->warmRestart;
+    }
+    poolData->prefetchFileId = -1;
+
+    if (startBackgroundWriter(poolData, options) != RC_OK) {
+        pthread_mutex_destroy(&poolData->poolMutex);
+        pthread_cond_destroy(&poolData->poolCond);
+        pthread_cond_destroy(&poolData->frameFreed);
+        freePoolData(poolData);
+        return NULL;
+    }
+
+    return poolData;
+}
+
+// Warm restart helpers
+
+// A page of a manifest, hottest first
+typedef struct BM_ManifestEntry {
+    PageNumber pageNum;
+    int heat; // use count for LFU, time of the latest pin otherwise
+} BM_ManifestEntry;
+
+static int compareManifestEntries (const void *a, const void *b) {
+    int left = ((const BM_ManifestEntry *) a)->heat;
+    int right = ((const BM_ManifestEntry *) b)->heat;
+    return (left < right) - (left > right);
+}
+
+static int comparePageNumbers (const void *a, const void *b) {
+    PageNumber left = *(const PageNumber *) a;
+    PageNumber right = *(const PageNumber *) b;
+    return (left > right) - (left < right);
+}
+
+static char *manifestName (const char *const pageFileName) {
+    char *name = malloc(strlen(pageFileName) + strlen(BM_MANIFEST_SUFFIX) + 1);
+    if (name != NULL) {
+        strcpy(name, pageFileName);
+        strcat(name, BM_MANIFEST_SUFFIX);
+    }
+    return name;
+}
+
+/*
+ * Writes the manifest of a page file: the number of pages on the first line,
+ * then one page number per line, hottest first. It is written to a temporary
+ * file and renamed over the old one, so a crash leaves either manifest whole.
+ * A manifest is only a hint, so failures are logged and otherwise ignored.
+ *
+ * @param pageFileName Name of the page file
+ * @param entries      Resident pages of the file
+ * @param numEntries   Number of entries
+ */
+static void writeManifest (const char *const pageFileName, BM_ManifestEntry *entries, int numEntries) {
+    char *name = manifestName(pageFileName);
+    char *tmpName = (name != NULL) ? malloc(strlen(name) + 5) : NULL;
+    if (tmpName == NULL) {
+        free(name);
+        return;
+    }
+    strcpy(tmpName, name);
+    strcat(tmpName, ".tmp");
+
+    qsort(entries, numEntries, sizeof(BM_ManifestEntry), compareManifestEntries);
+
+    FILE *file = fopen(tmpName, "w");
+    bool written = (file != NULL && fprintf(file, "%d\n", numEntries) > 0);
+    for (int i = 0; written && i < numEntries; i++) {
+        written = (fprintf(file, "%d\n", entries[i].pageNum) > 0);
+    }
+    if (file != NULL && fclose(file) != 0) {
+        written = false;
+    }
+    if (!written || rename(tmpName, name) != 0) {
+        LOG_WARN("Warning: Unable to write the manifest '%s'.\n", name);
+        remove(tmpName);
+    }
+
+    free(tmpName);
+    free(name);
+}
+
+/*
+ * Reads the hottest pages of a page file's manifest.
+ *
+ * @param pageFileName Name of the page file
+ * @param maxPages     Most pages to read
+ * @param pages        Receives an array of the pages, hottest first, NULL if there are none
+ * @return             Number of pages read
+ */
+static int readManifest (const char *const pageFileName, int maxPages, PageNumber **pages) {
+    char *name = manifestName(pageFileName);
+    FILE *file = (name != NULL) ? fopen(name, "r") : NULL;
+    int numPages = 0;
+    int n = 0;
+
+    *pages = NULL;
+    free(name);
+    if (file == NULL) {
+        return 0;
+    }
+
+    if (fscanf(file, "%d", &numPages) == 1 && numPages > 0) {
+        if (numPages > maxPages) {
+            numPages = maxPages;
+        }
+        *pages = malloc(sizeof(PageNumber) * numPages);
+        while (*pages != NULL && n < numPages && fscanf(file, "%d", &(*pages)[n]) == 1) {
+            if ((*pages)[n] >= 0) {
+                n++;
+            }
+        }
+    }
+    fclose(file);
+
+    if (n == 0) {
+        free(*pages);
+        *pages = NULL;
+    }
+    return n;
+}
+
+/*
+ * Starts loading the pages of a file's manifest in the background, as many
+ * of the hottest as there are free frames, in page order so the reads run
+ * through the file once. Called with the pool mutex held.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param fileId   File just attached to the pool
+ */
+static void startWarmRestart (BM_PoolData *poolData, int fileId) {
+    BM_PoolFile *file = &poolData->files[fileId];
+    PageNumber *pages;
+    int numPages = readManifest(file->fileName, poolData->numFreeFrames, &pages);
+
+    if (numPages == 0) {
+        return;
+    }
+    if (startPrefetcher(poolData) != RC_OK) {
+        free(pages);
+        return;
+    }
+
+    qsort(pages, numPages, sizeof(PageNumber), comparePageNumbers);
+    file->warmPages = pages;
+    file->numWarmPages = numPages;
+    file->warmNext = 0;
+    pthread_cond_signal(&poolData->prefetchCond);
+}
+
+/*
+ * Attaches a page file to a pool, opening it unless another BM_BufferPool
+ * already did.
+ *
+ * @param poolData     Bookkeeping of the buffer pool
+ * @param pageFileName Name of the page file
+ * @param fileId       Receives the file id
+ * @return             RC_OK, the error of opening the file, or RC_BP_INIT_ERROR if
+ *                     its pages do not fit the frames or memory allocation fails
+ */
+static RC attachPoolFile (BM_PoolData *poolData, const char *const pageFileName, int *fileId) {
+    int freeSlot = -1;
+
+    for (int i = 0; i < poolData->numFiles; i++) {
+        if (poolData->files[i].fileName == NULL) {
+            if (freeSlot == -1) {
+                freeSlot = i;
+            }
+        } else if (strcmp(poolData->files[i].fileName, pageFileName) == 0) {
+            poolData->files[i].refCount++;
+            *fileId = i;
+            return RC_OK;
+        }
+    }
+
+    if (freeSlot == -1) {
+        BM_PoolFile *files = realloc(poolData->files, sizeof(BM_PoolFile) * (poolData->numFiles + 1));
+        if (files == NULL) {
+            return RC_BP_INIT_ERROR;
+        }
+        poolData->files = files;
+        freeSlot = poolData->numFiles++;
+    }
+
+    BM_PoolFile *file = &poolData->files[freeSlot];
+    memset(file, 0, sizeof(BM_PoolFile));
+    file->fileName = strdup(pageFileName);
+    if (file->fileName == NULL) {
+        return RC_BP_INIT_ERROR;
+    }
+
+    // Open the page file once for as long as it stays attached
+    SM_AccessMode mode = poolData->mapFiles ? SM_ACCESS_MMAP : (poolData->directIO ? SM_ACCESS_DIRECT : SM_ACCESS_PREAD);
+    RC rc = openPageFileWithMode(file->fileName, &file->fHandle, mode);
+    if (rc == RC_OK && !poolData->mapFiles && file->fHandle.pageSize > poolData->pageSize) {
+        LOG_ERROR("Error: Pages of '%s' are larger than the frames of the pool.\n", pageFileName);
+        closePageFile(&file->fHandle);
+        rc = RC_BP_INIT_ERROR;
+    }
+    if (rc != RC_OK) {
+        free(file->fileName);
+        file->fileName = NULL;
+        return rc;
+    }
+    file->refCount = 1;
+
+    *fileId = freeSlot;
+    return RC_OK;
+}
+
+/*
+ * Drops one reference to a page file. The last one evicts the file's pages
+ * from the pool, so a file deleted and created again never sees stale frames.
+ */
+static void detachPoolFile (BM_PoolData *poolData, int fileId) {
+    BM_PoolFile *file = &poolData->files[fileId];
+    Frames *frames = poolData->frames;
+
+    if (--file->refCount > 0) {
+        return;
+    }
+
+    // The resident pages make the manifest, pages in access rings are no part of the hot set
+    BM_ManifestEntry *manifest = NULL;
+    int manifestSize = 0;
+    if (poolData->warmRestart) {
+        manifest = malloc(sizeof(BM_ManifestEntry) * poolData->numFrames);
+    }
+
+    // The file id may be reused, so nothing may be left to prefetch from it
+    pthread_mutex_lock(&poolData->poolMutex);
+    dropPrefetches(poolData, fileId, NULL);
+    pthread_mutex_unlock(&poolData->poolMutex);
+
+    lockWholePool(poolData);
+    waitForBackgroundWrites(poolData);
+
+    for (int i = 0; i < poolData->numFrames; i++) {
+        if (frames[i].pageNumber != NO_PAGE && frames[i].fileId == fileId) {
+            if (manifest != NULL && frames[i].ringId == 0) {
+                manifest[manifestSize].pageNum = frames[i].pageNumber;
+                manifest[manifestSize].heat = (poolData->strategy == RS_LFU) ? frames[i].frequency : frames[i].lruOrder;
+                manifestSize++;
+            }
+            if (frames[i].dirty) {
+                writeFrameToDisk(poolData, i);
+            }
+            if (USES_VICTIM_HEAP(poolData)) {
+                heapRemove(poolData, i);
+            }
+            if (poolData->strategy == RS_LRU) {
+                lruUnlink(poolData, i);
+            }
+            if (poolData->strategy == RS_ARC) {
+                arcUnlink(poolData->arc, i);
+            }
+            unmapFrame(poolData, i);
+            frames[i].fix_cnt = 0;
+            frames[i].lruOrder = 0;
+            frames[i].referenced = false;
+            frames[i].ringId = 0;
+            poolData->freeFrames[poolData->numFreeFrames++] = i;
+        }
+    }
+    signalFrameFreed(poolData);
+
+    // The file id may be reused by another file, so its retained histories and ghosts go too
+    if (poolData->strategy == RS_ARC) {
+        for (int ghost = 0; ghost < poolData->numFrames; ghost++) {
+            int node = poolData->numFrames + ghost;
+            if (poolData->arc->listOf[node] != -1 && poolData->arc->ghostFileId[ghost] == fileId) {
+                arcDropGhost(poolData, node);
+            }
+        }
+    }
+    for (int i = 0; i < poolData->numRetained; i++) {
+        if (poolData->retained[i].pageNumber != NO_PAGE && poolData->retained[i].fileId == fileId) {
+            pageTableRemove(&poolData->retainedTable, fileId, poolData->retained[i].pageNumber);
+            poolData->retained[i].pageNumber = NO_PAGE;
+        }
+    }
+
+    unlockWholePool(poolData);
+
+    if (manifest != NULL) {
+        writeManifest(file->fileName, manifest, manifestSize);
+        free(manifest);
+    }
+
+    closePageFile(&file->fHandle);
+    free(file->fileName);
+    file->fileName = NULL;
+}
+
+/*
+ * Initializes a buffer pool with the specified parameters.
+ * If a shared buffer pool is running, the new pool attaches to it instead of
+ * allocating frames of its own; numPages and strategy are then taken from the
+ * shared pool.
+ *
+ * Parameters:
+ * - bm: Pointer to the buffer pool structure to be initialized.
+ * - pageFileName: Name of the page file associated with the buffer pool.
+ * - numPages: Number of page frames in the buffer pool.
+ * - strategy: Replacement strategy to be used by the buffer pool.
+ * - stratData: Additional parameters for the replacement strategy.
+ *
+ * Returns:
+ * - RC_OK if the buffer pool is successfully initialized, otherwise an error code.
+ */
+RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
+                  const int numPages, ReplacementStrategy strategy,
+                  void *stratData) {
+    return initBufferPoolWithOptions(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+/*
+ * Initializes a buffer pool like initBufferPool, with extra settings such as
+ * a background writer. The options are ignored when attaching to the shared
+ * buffer pool, which has its own.
+ *
+ * @param options Optional pool settings, may be NULL
+ * @return        RC_OK if the buffer pool is successfully initialized, otherwise an error code
+ */
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+                             const int numPages, ReplacementStrategy strategy,
+                             void *stratData, const BM_PoolOptions *options) {
+    LOG_INFO("Initializing the Buffer Pool.\n");
+
+    // Check if the file exists
+    if (access(pageFileName, F_OK) != -1) {
+        LOG_DEBUG("File '%s' exists.\n", pageFileName);
+    } else {
+        return RC_FILE_NOT_FOUND; // Define appropriate error code
+    }
+
+    BM_PoolView *view = malloc(sizeof(BM_PoolView));
+    if (view == NULL) {
+        return RC_BP_INIT_ERROR;
+    }
+
+    pthread_mutex_lock(&sharedPoolMutex);
+    if (sharedPool != NULL) {
+        view->pool = sharedPool;
+    } else {
+        if (numPages <= 0) {
+            pthread_mutex_unlock(&sharedPoolMutex);
+            free(view);
+            return RC_BP_INIT_ERROR;
+        }
+
+        // Frames of a private pool are as large as the pages of its file
+        SM_FileHandle probe;
+        RC rc = openPageFile((char *) pageFileName, &probe);
+        if (rc != RC_OK) {
+            pthread_mutex_unlock(&sharedPoolMutex);
+            free(view);
+            return rc;
+        }
+        int pageSize = probe.pageSize;
+        closePageFile(&probe);
+
+        int *data = (int *)stratData;
+        // Use the value of the strategy-specific data
+        view->pool = createPoolData(numPages, pageSize, strategy, (data != NULL) ? *data : 0, options);
+        if (view->pool == NULL) {
+            pthread_mutex_unlock(&sharedPoolMutex);
+            free(view);
+            return RC_BP_INIT_ERROR;
+        }
+    }
+
+    // The files array may move, so the background writer must not be using it
+    pthread_mutex_lock(&view->pool->poolMutex);
+    RC rc = attachPoolFile(view->pool, pageFileName, &view->fileId);
+    if (rc == RC_OK && view->pool->warmRestart && view->pool->files[view->fileId].refCount == 1) {
+        startWarmRestart(view->pool, view->fileId);
+    }
+    pthread_mutex_unlock(&view->pool->poolMutex);
+    if (rc != RC_OK) {
+        if (!view->pool->shared) {
+            stopBackgroundWriter(view->pool);
+            stopPrefetcher(view->pool);
+            pthread_mutex_destroy(&view->pool->poolMutex);
+            pthread_cond_destroy(&view->pool->poolCond);
+            pthread_cond_destroy(&view->pool->frameFreed);
+            freePoolData(view->pool);
+        }
+        pthread_mutex_unlock(&sharedPoolMutex);
+        free(view);
+        return rc;
+    }
+    pthread_mutex_unlock(&sharedPoolMutex);
+
+    // Initialize other properties of the buffer pool
+    bm->pageFile = (char*)pageFileName;
+    bm->numPages = view->pool->numFrames;
+    bm->strategy = view->pool->strategy;
+    bm->stratParam = view->pool->stratParam;
+    view->lastPinned = NO_PAGE;
+    view->sequentialPins = 0;
+    view->readaheadNext = NO_PAGE;
+    view->readBatch = NULL;
+    bm->mgmtData = view;
+
+    LOG_INFO("Buffer Pool has initialized.\n");
+    return RC_OK;
+}
+
+/*
+ * Destroys a buffer pool, freeing up all associated resources.
+ * If the buffer pool contains any dirty pages with a fix count of 0,
+ * they are written back to disk before destroying the pool.
+ * A pool attached to the shared buffer pool only releases its file.
+ *
+ * Parameters:
+ * - bm: Pointer to the buffer pool structure to be shut down.
+ *
+ * Returns:
+ * - RC_OK if the buffer pool is successfully shut down, otherwise an error code.
+ */
+RC shutdownBufferPool(BM_BufferPool *const bm) {
+    LOG_INFO("Shutting down the Buffer Pool.\n");
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_BP_SHUNTDOWN_ERROR;
+    }
+
+    BM_PoolView *view = POOL_VIEW(bm);
+    BM_PoolData *poolData = view->pool;
+
+    if (!poolData->shared) {
+        // Acquire the pool's mutex lock
+        pthread_mutex_lock(&poolData->poolMutex);
+
+        // Set a flag to indicate that the buffer pool is shutting down
+        poolData->shuttingDown = true;
+
+        // Wait for all threads to complete their operations
+        while (poolData->activeThreads > 0) {
+            pthread_cond_wait(&poolData->poolCond, &poolData->poolMutex);
+        }
+
+        // Release the pool's mutex lock
+        pthread_mutex_unlock(&poolData->poolMutex);
+
+        stopBackgroundWriter(poolData);
+        stopPrefetcher(poolData);
+    }
+
+    // Write dirty page back to disk
+    forceFlushPool(bm);
+
+    pthread_mutex_lock(&sharedPoolMutex);
+    detachPoolFile(poolData, view->fileId);
+    pthread_mutex_unlock(&sharedPoolMutex);
+
+    if (!poolData->shared) {
+        // Destroy the mutex lock and condition variable
+        pthread_mutex_destroy(&poolData->poolMutex);
+        pthread_cond_destroy(&poolData->poolCond);
+        pthread_cond_destroy(&poolData->frameFreed);
+
+        // Free memory associated with the buffer pool
+        freePoolData(poolData);
+    }
+    free(view);
+    bm->mgmtData = NULL;
+
+    LOG_INFO("Buffer Pool has shut down.\n");
+    return RC_OK;
+}
+
+/*
+ * Starts the process-wide buffer pool. Every buffer pool initialized while it
+ * runs caches its pages in the shared frames, so hot tables can take memory
+ * from cold ones under a single budget.
+ *
+ * @param memoryLimit Total memory in bytes the pool may use for frames and bookkeeping
+ * @param strategy    Replacement strategy to be used across all files
+ * @param stratData   Additional parameters for the replacement strategy
+ * @return            RC_OK on success, or an error code otherwise
+ */
+RC initSharedBufferPool (const size_t memoryLimit, ReplacementStrategy strategy, void *stratData) {
+    return initSharedBufferPoolWithOptions(memoryLimit, strategy, stratData, NULL);
+}
+
+/*
+ * Starts the process-wide buffer pool like initSharedBufferPool, with extra
+ * settings such as a background writer.
+ *
+ * @param options Optional pool settings, may be NULL
+ * @return        RC_OK on success, or an error code otherwise
+ */
+RC initSharedBufferPoolWithOptions (const size_t memoryLimit, ReplacementStrategy strategy, void *stratData,
+                                    const BM_PoolOptions *options) {
+    LOG_INFO("Initializing the shared Buffer Pool.\n");
+    int pageSize = (options != NULL && options->pageSize > 0) ? options->pageSize : PAGE_SIZE;
+    int numFrames = (int) (memoryLimit / FRAME_FOOTPRINT(pageSize));
+    int *data = (int *)stratData;
+
+    if (numFrames <= 0 || pageSize < PAGE_SIZE || pageSize > SM_MAX_PAGE_SIZE) {
+        return RC_BP_INIT_ERROR;
+    }
+
+    pthread_mutex_lock(&sharedPoolMutex);
+    if (sharedPool != NULL) {
+        pthread_mutex_unlock(&sharedPoolMutex);
+        return RC_BP_INIT_ERROR;
+    }
+
+    sharedPool = createPoolData(numFrames, pageSize, strategy, (data != NULL) ? *data : 0, options);
+    if (sharedPool == NULL) {
+        pthread_mutex_unlock(&sharedPoolMutex);
+        return RC_BP_INIT_ERROR;
+    }
+    sharedPool->shared = true;
+    pthread_mutex_unlock(&sharedPoolMutex);
+
+    return RC_OK;
+}
+
+/*
+ * Stops the process-wide buffer pool. Fails while any buffer pool is still
+ * attached to it.
+ *
+ * @return RC_OK on success, or an error code otherwise
+ */
+RC shutdownSharedBufferPool (void) {
+    LOG_INFO("Shutting down the shared Buffer Pool.\n");
+    pthread_mutex_lock(&sharedPoolMutex);
+    if (sharedPool == NULL) {
+        pthread_mutex_unlock(&sharedPoolMutex);
+        return RC_BP_SHUNTDOWN_ERROR;
+    }
+
+    for (int i = 0; i < sharedPool->numFiles; i++) {
+        if (sharedPool->files[i].fileName != NULL) {
+            pthread_mutex_unlock(&sharedPoolMutex);
+            return RC_BP_SHUNTDOWN_ERROR;
+        }
+    }
+
+    stopBackgroundWriter(sharedPool);
+    stopPrefetcher(sharedPool);
+    pthread_mutex_destroy(&sharedPool->poolMutex);
+    pthread_cond_destroy(&sharedPool->poolCond);
+    pthread_cond_destroy(&sharedPool->frameFreed);
+    freePoolData(sharedPool);
+    sharedPool = NULL;
+    pthread_mutex_unlock(&sharedPoolMutex);
+
+    return RC_OK;
+}
 
 /*
- * Initializes a buffer pool with the specified parameters.
+ * Removes the warm restart manifest of a page file, for when the file itself
+ * is destroyed.
+ *
+ * @param pageFileName Name of the page file
+ * @return             RC_OK if the manifest is gone or never existed, otherwise an error code
+ */
+RC destroyPoolManifest (const char *const pageFileName) {
+    char *name = manifestName(pageFileName);
+    if (name == NULL) {
+        return RC_MALLOC_ERROR;
+    }
+
+    RC rc = (remove(name) == 0 || errno == ENOENT) ? RC_OK : RC_DELETE_FAILED;
+    free(name);
+    return rc;
+}
+
+// A dirty frame queued for write-back, ordered by its page number
+typedef struct BM_FlushEntry {
+    PageNumber pageNum;
+    int index;
+} BM_FlushEntry;
+
+static int compareFlushEntries (const void *a, const void *b) {
+    PageNumber left = ((const BM_FlushEntry *) a)->pageNum;
+    PageNumber right = ((const BM_FlushEntry *) b)->pageNum;
+    return (left > right) - (left < right);
+}
+
+/*
+ * Writes a run of frames holding consecutive pages of one file with a single
+ * vectored write. Called without locks, on frames pinned by startFrameWrite.
+ *
+ * @param poolData Bookkeeping of the buffer pool
+ * @param fHandle  Copy of the handle of the file the pages belong to
+ * @param run      Frames of the run, in page order
+ * @param length   Number of frames in the run
+ * @param memPages Scratch space for length page buffers
+ * @return         RC_OK, or the error of the failed write
+ */
+static RC writeFrameRun (BM_PoolData *poolData, SM_FileHandle *fHandle, BM_FlushEntry *run, int length,
+                         SM_PageHandle *memPages) {
+    Frames *frames = poolData->frames;
+
+    for (int i = 0; i < length; i++) {
+        lockLatchForWrite(&frames[run[i].index].latch);
+        memPages[i] = frames[run[i].index].memPage;
+    }
+
+    uint64_t start = monotonicNanos();
+    RC rc;
+    if (poolData->mapFiles) {
+        rc = syncBlocks(run[0].pageNum, length, fHandle);
+    } else {
+        rc = writeBlocksGather(run[0].pageNum, length, fHandle, memPages);
+    }
+    countLatency(poolData->counters->writeLatency, start);
+    if (rc == RC_OK) {
+        atomic_fetch_add(&poolData->writeSeq, 1);
+    }
+    for (int i = 0; i < length; i++) {
+        releaseLatchAfterWrite(&frames[run[i].index].latch);
+    }
+
+    return rc;
+}
+
+/*
+ * Writes all dirty pages with a fix count of 0 from the buffer pool to disk.
+ * Only pages of the buffer pool's own file are written. The pages are written
+ * in page order, each run of consecutive pages with one vectored write. Pinned
+ * pages are skipped and the rest are still written. The pool is only locked
+ * while the dirty frames are collected and pinned; the writes are made with
+ * the locks released, so pins of other pages go on meanwhile.
  *
  * Parameters:
- * - bm: Pointer to the buffer pool structure to be initialized.
- * - pageFileName: Name of the page file associated with the buffer pool.
- * - numPages: Number of page frames in the buffer pool.
- * - strategy: Replacement strategy to be used by the buffer pool.
- * - stratData: Additional parameters for the replacement strategy.
+ * - bm: Pointer to the buffer pool structure.
  *
  * Returns:
- * - RC_OK if the buffer pool is successfully initialized, otherwise an error code.
+ * - RC_OK if every dirty page was written to disk, otherwise an error code,
+ *   also when a dirty page was left unwritten because it is pinned.
  */
-RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
-                  const int numPages, ReplacementStrategy strategy,
-                  void *stratData) {
-    // Acquire the global mutex lock before initializing the buffer pool
-    pthread_mutex_lock(&bp_unique_init_mutex);
+RC forceFlushPool(BM_BufferPool *const bm) {
+    LOG_DEBUG("Forcing flush the Buffer Pool.\n");
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_BP_FLUSHPOOL_FAILED;
+    }
 
-    // Check if the buffer pool has already been initialized
-    if (isInitialized_bp) {
-        printf("Buffer pool already initialized.\n");
-        pthread_mutex_unlock(&bp_unique_init_mutex);
-        return RC_OK;
+    BM_PoolData *poolData = POOL_DATA(bm);
+    Frames *frames = poolData->frames;
+    int fileId = POOL_FILE_ID(bm);
+    int numPages = poolData->numFrames;
+
+    BM_FlushEntry *entries = malloc(sizeof(BM_FlushEntry) * numPages);
+    SM_PageHandle *memPages = malloc(sizeof(SM_PageHandle) * numPages);
+    if (entries == NULL || memPages == NULL) {
+        free(entries);
+        free(memPages);
+        return RC_BP_FLUSHPOOL_FAILED;
     }
 
-    printf("Initializing the Buffer Pool.\n");
+    lockWholePool(poolData);
+    waitForBackgroundWrites(poolData);
 
-    // Check if the file exists
-    if (access(pageFileName, F_OK) != -1) {
-        printf("File '%s' exists.\n", pageFileName);
-    } else {
-        pthread_mutex_unlock(&bp_unique_init_mutex);
-        return RC_FILE_NOT_FOUND; // Define appropriate error code
+    // Collect and pin the dirty pages, skipping over the pinned ones
+    int numDirty = 0;
+    bool skippedPinned = false;
+    for (int i = 0; i < numPages; i++) {
+        if (frames[i].fileId != fileId || !frames[i].dirty) {
+            continue;
+        }
+        if (frames[i].fix_cnt != 0) {
+            skippedPinned = true;
+            continue;
+        }
+        entries[numDirty].pageNum = frames[i].pageNumber;
+        entries[numDirty].index = i;
+        startFrameWrite(poolData, i);
+        numDirty++;
+    }
+    SM_FileHandle fHandle = poolData->files[fileId].fHandle;
+    unlockWholePool(poolData);
+    qsort(entries, numDirty, sizeof(BM_FlushEntry), compareFlushEntries);
+
+    // Write each run of consecutive pages at once
+    RC rc = RC_OK;
+    for (int start = 0; start < numDirty; ) {
+        int end = start + 1;
+        while (end < numDirty && entries[end].pageNum == entries[end - 1].pageNum + 1) {
+            end++;
+        }
+        RC runRc = writeFrameRun(poolData, &fHandle, &entries[start], end - start, memPages);
+        if (runRc != RC_OK) {
+            rc = RC_BP_FLUSHPOOL_FAILED;
+        }
+        for (int i = start; i < end; i++) {
+            endFrameWrite(poolData, entries[i].index, runRc, &fHandle);
+        }
+        start = end;
     }
 
-    // Allocate memory for the buffer pool
-    bm->mgmtData = malloc(sizeof(Frames) * numPages);
-    if (bm->mgmtData == NULL) {
-        free(bm->mgmtData);
-        pthread_mutex_unlock(&bp_unique_init_mutex);
-        return RC_BP_INIT_ERROR;
+    free(entries);
+    free(memPages);
+
+    if (rc != RC_OK || skippedPinned) {
+        return RC_BP_FLUSHPOOL_FAILED;
+    }
+    LOG_DEBUG("Finished force flush pool.\n");
+    return RC_OK;
+}
+
+/*
+ * FIFO (First-In-First-Out) page replacement strategy.
+ * This function implements the FIFO page replacement algorithm,
+ * which selects the page that was brought into memory first for eviction.
+ *
+ * @param bm     Buffer pool containing information about the buffer pool
+ * @param page   Pointer to the page to be replaced
+ * @return       RC_OK on success, or an error code otherwise
+ */
+RC FIFO (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    LOG_TRACE("Using FIFO strategy.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), pageNum);
+    int numFrames = poolData->numFrames;
+    int FIFO_PageIndex;
+
+    FIFO_PageIndex = poolData->readFromDisk % numFrames;
+
+    for (int i = 0; i< numFrames; i++) {
+        // Handle using pages
+        if (claimFrame(poolData, stripe, FIFO_PageIndex)) {
+            // Write back the old page and read the new one into its frame
+            return replaceFrame(poolData, page, stripe, FIFO_PageIndex, POOL_FILE_ID(bm), pageNum, POOL_VIEW(bm)->readBatch);
+        } else {
+            FIFO_PageIndex++;
+            FIFO_PageIndex = FIFO_PageIndex % numFrames;
+        }
     }
+    // All pages are pinned
+    return RC_BP_PIN_ERROR;
+}
 
-    // Initialize the individual frames in the buffer pool
-    Frames *frames = (Frames *)bm->mgmtData;
+/*
+ * LRU (Least Recently Used) page replacement strategy.
+ * This function implements the LRU page replacement algorithm,
+ * which selects the page that has not been used for the longest time for eviction.
+ * Resident frames form a list from most to least recently used, so the
+ * victim is found by walking back from the tail past pinned frames only.
+ *
+ * @param bm     Buffer pool containing information about the buffer pool
+ * @param page   Pointer to the page to be replaced
+ * @return       RC_OK on success, or an error code otherwise
+ */
+RC LRU (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    LOG_TRACE("Using LRU strategy.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    Frames *frames = poolData->frames;
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), pageNum);
+    int LRU_PageIndex = poolData->lruTail;
+
+    // Find the least recently used page that is not pinned
+    while (LRU_PageIndex != -1 && !claimFrame(poolData, stripe, LRU_PageIndex)) {
+        LRU_PageIndex = frames[LRU_PageIndex].lruPrev;
+    }
 
-    // Allocate memory for page latches
-    frames->pageLatches = malloc(numPages * sizeof(Latch));
-    if (frames->pageLatches == NULL) {
-        free(bm->mgmtData);
-        pthread_mutex_unlock(&bp_unique_init_mutex);
-        return RC_BP_INIT_ERROR;
+    // All pages are pinned
+    if (LRU_PageIndex == -1) {
+        return RC_BP_PIN_ERROR;
     }
 
-    for (int i = 0; i < numPages; i++) {
-        // Other initialization
-        frames[i].memPage = (SM_PageHandle) malloc(PAGE_SIZE);
-        if (frames[i].memPage == NULL) {
-            for (int j = 0; j < i; j++) {
-                free(frames[j].memPage);
-            }
-            free(frames->pageLatches);
-            free(bm->mgmtData);
-            // Handle memory allocation error
-            pthread_mutex_unlock(&bp_unique_init_mutex);
-            return RC_BP_INIT_ERROR;
+    // Write back the least recently used page and read the new one into its frame
+    RC rc = replaceFrame(poolData, page, stripe, LRU_PageIndex, POOL_FILE_ID(bm), pageNum, POOL_VIEW(bm)->readBatch);
+    if (rc == RC_OK) {
+        lruPushFront(poolData, LRU_PageIndex);
+    } else if (frames[LRU_PageIndex].pageNumber == NO_PAGE) {
+        lruUnlink(poolData, LRU_PageIndex);
+    }
+    return rc;
+}
+
+/*
+ * LRU-K page replacement strategy.
+ * Evicts the page whose K-th most recent reference lies furthest back,
+ * pages referenced fewer than K times first and the least recently used
+ * among those. Unpinned frames sit in a heap ordered that way. Pages still
+ * inside their correlated reference period wait in a second heap, ordered
+ * by their latest reference, and move over once the period has passed;
+ * they are only evicted if nothing else can be. The history of an evicted page is retained for a
+ * while, so a page that comes back is not treated as new.
+ *
+ * @param bm     Buffer pool containing information about the buffer pool
+ * @param page   Pointer to the page to be replaced
+ * @return       RC_OK on success, or an error code otherwise
+ */
+RC LRU_K (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    LOG_TRACE("Using LRU-K strategy.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    Frames *frames = poolData->frames;
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), pageNum);
+    FrameHeap *periodHeap = &poolData->lrukPeriodHeap;
+    int now = poolData->lrukClock + 1;
+    int numSkipped = 0;
+    int LRU_PageIndex = -1;
+
+    // Pages whose correlated period has passed become ordinary candidates
+    while (periodHeap->size > 0 && now - poolData->lrukLast[periodHeap->frames[0]] > LRU_K_CORRELATED_PERIOD) {
+        int index = periodHeap->frames[0];
+        heapRemove(poolData, index);
+        heapPush(poolData, &poolData->victimHeap, index);
+    }
+
+    // Take the root of the victim heap, then fall back to the page that leaves its
+    // correlated period soonest; frames another thread is busy with go back afterwards
+    FrameHeap *heaps[] = { &poolData->victimHeap, periodHeap };
+    for (int h = 0; h < 2 && LRU_PageIndex == -1; h++) {
+        while (heaps[h]->size > 0) {
+            int index = heaps[h]->frames[0];
+            heapRemove(poolData, index);
+            if (claimFrame(poolData, stripe, index)) {
+                LRU_PageIndex = index;
+                break;
+            }
+            poolData->skippedFrames[numSkipped++] = index;
         }
+    }
+    for (int i = 0; i < numSkipped; i++) {
+        heapUpdate(poolData, poolData->skippedFrames[i]);
+    }
 
-        frames[i].pageNumber = NO_PAGE;
-        frames[i].dirty = false;
-        frames[i].fix_cnt = 0;
-        frames[i].lruOrder = 0;
-        createLatch(&(frames->pageLatches[i]));
+    // All pages are pinned
+    if (LRU_PageIndex == -1) {
+        return RC_BP_PIN_ERROR;
     }
 
-    int *data = (int *)stratData;
-    if (data != NULL) {
-        // Use the value of the strategy-specific data
-        bm->stratParam = *data;
-        // Proceed with initializing the buffer pool using the value
+    int evictedFileId = frames[LRU_PageIndex].fileId;
+    PageNumber evictedPageNum = frames[LRU_PageIndex].pageNumber;
+
+    RC rc = replaceFrame(poolData, page, stripe, LRU_PageIndex, POOL_FILE_ID(bm), pageNum, POOL_VIEW(bm)->readBatch);
+    if (rc == RC_OK) {
+        lrukRetain(poolData, LRU_PageIndex, evictedFileId, evictedPageNum);
+        lrukLoad(poolData, LRU_PageIndex, POOL_FILE_ID(bm), pageNum);
+    } else if (frames[LRU_PageIndex].pageNumber != NO_PAGE) {
+        // The old page could not be written back and stays in the pool
+        heapUpdate(poolData, LRU_PageIndex);
     }
+    return rc;
+}
 
-    // Initialize other properties of the buffer pool
-    bm->pageFile = (char*)pageFileName;
-    bm->numPages = numPages;
-    bm->strategy = strategy;
+/*
+ * CLOCK (second chance) page replacement strategy.
+ * A hand sweeps the frames in a circle and stays where it stopped between
+ * evictions. A frame whose reference bit is set loses the bit and is passed
+ * over once; the first unpinned frame without it is evicted.
+ *
+ * @param bm     Buffer pool containing information about the buffer pool
+ * @param page   Pointer to the page to be replaced
+ * @return       RC_OK on success, or an error code otherwise
+ */
+RC CLOCK (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    LOG_TRACE("Using CLOCK strategy.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    Frames *frames = poolData->frames;
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), pageNum);
+    int numFrames = poolData->numFrames;
+
+    // After one full turn every unpinned frame has lost its bit, so two turns always settle it
+    for (int i = 0; i < 2 * numFrames; i++) {
+        int hand = poolData->clockHand;
+        poolData->clockHand = (hand + 1) % numFrames;
+
+        if (frames[hand].fix_cnt > 0) {
+            continue;
+        }
+        if (frames[hand].referenced) {
+            frames[hand].referenced = false;
+            continue;
+        }
+        if (claimFrame(poolData, stripe, hand)) {
+            return replaceFrame(poolData, page, stripe, hand, POOL_FILE_ID(bm), pageNum, POOL_VIEW(bm)->readBatch);
+        }
+    }
+
+    // All pages are pinned
+    return RC_BP_PIN_ERROR;
+}
+
+/*
+ * LFU (Least Frequently Used) page replacement strategy.
+ * Unpinned frames sit in a min-heap ordered by how often their page was
+ * pinned, ties broken by recency, so the victim is found in O(log n).
+ * If the pool was given a decay period, use counts are halved every that
+ * many pins.
+ *
+ * @param bm     Buffer pool containing information about the buffer pool
+ * @param page   Pointer to the page to be replaced
+ * @return       RC_OK on success, or an error code otherwise
+ */
+RC LFU (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    LOG_TRACE("Using LFU strategy.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), pageNum);
+    int numSkipped = 0;
+    int LFU_PageIndex = -1;
+
+    // Frames another thread is busy with are passed over and go back afterwards
+    while (poolData->victimHeap.size > 0) {
+        int index = poolData->victimHeap.frames[0];
+        heapRemove(poolData, index);
+        if (claimFrame(poolData, stripe, index)) {
+            LFU_PageIndex = index;
+            break;
+        }
+        poolData->skippedFrames[numSkipped++] = index;
+    }
+    for (int i = 0; i < numSkipped; i++) {
+        heapUpdate(poolData, poolData->skippedFrames[i]);
+    }
+
+    // All pages are pinned
+    if (LFU_PageIndex == -1) {
+        return RC_BP_PIN_ERROR;
+    }
+
+    RC rc = replaceFrame(poolData, page, stripe, LFU_PageIndex, POOL_FILE_ID(bm), pageNum, POOL_VIEW(bm)->readBatch);
+    if (rc != RC_OK && poolData->frames[LFU_PageIndex].pageNumber != NO_PAGE) {
+        // The old page could not be written back and stays in the pool
+        heapUpdate(poolData, LFU_PageIndex);
+    }
+    return rc;
+}
+
+/*
+ * ARC (Adaptive Replacement Cache) page replacement strategy.
+ * Pages seen once live on T1, pages seen again on T2, and the ghost lists
+ * B1 and B2 remember pages recently evicted from each. A miss that hits a
+ * ghost shifts the target size of T1 towards the list that would have kept
+ * the page. One-off pages from a scan only ever reach T1, so they cannot
+ * push the frequently used pages on T2 out of the pool.
+ *
+ * @param bm     Buffer pool containing information about the buffer pool
+ * @param page   Pointer to the page to be replaced
+ * @return       RC_OK on success, or an error code otherwise
+ */
+RC ARC (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    LOG_TRACE("Using ARC strategy.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    ARCState *arc = poolData->arc;
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), pageNum);
+    int ghostNode = arcAdapt(poolData, POOL_FILE_ID(bm), pageNum);
+    int sizeT1 = arc->lists[ARC_T1].size;
+    int ARC_PageIndex;
+
+    // Evict from T1 if it is over its target, otherwise from T2; fall back to the other list if all are pinned
+    if (sizeT1 > 0 && (sizeT1 > arc->target ||
+                       (ghostNode != -1 && arc->listOf[ghostNode] == ARC_B2 && sizeT1 == arc->target))) {
+        ARC_PageIndex = arcClaimTail(poolData, stripe, ARC_T1);
+        if (ARC_PageIndex == -1) {
+            ARC_PageIndex = arcClaimTail(poolData, stripe, ARC_T2);
+        }
+    } else {
+        ARC_PageIndex = arcClaimTail(poolData, stripe, ARC_T2);
+        if (ARC_PageIndex == -1) {
+            ARC_PageIndex = arcClaimTail(poolData, stripe, ARC_T1);
+        }
+    }
+
+    // All pages are pinned
+    if (ARC_PageIndex == -1) {
+        return RC_BP_PIN_ERROR;
+    }
+
+    Frames *evicted = &poolData->frames[ARC_PageIndex];
+    int evictedList = arc->listOf[ARC_PageIndex];
+    int evictedGhost = arcEvict(poolData, ARC_PageIndex);
+
+    RC rc = replaceFrame(poolData, page, stripe, ARC_PageIndex, POOL_FILE_ID(bm), pageNum, POOL_VIEW(bm)->readBatch);
+    if (rc == RC_OK) {
+        // The ghost may have been recycled by arcEvict
+        if (ghostNode != -1 && pageTableLookup(&arc->ghostTable, POOL_FILE_ID(bm), pageNum) != ghostNode) {
+            ghostNode = -1;
+        }
+        arcAdmit(poolData, ARC_PageIndex, ghostNode);
+    } else if (evicted->pageNumber != NO_PAGE) {
+        // The old page could not be written back and stays in the pool; its ghost may be gone already
+        if (pageTableLookup(&arc->ghostTable, evicted->fileId, evicted->pageNumber) == evictedGhost) {
+            arcDropGhost(poolData, evictedGhost);
+        }
+        arcPushFront(arc, evictedList, ARC_PageIndex);
+    }
+    return rc;
+}
+
+/*
+ * Marks a page in the buffer pool as dirty, indicating that it has been modified.
+ *
+ * @param bm   Buffer pool containing information about the buffer pool
+ * @param page Pointer to the page to be marked as dirty
+ * @return     RC_OK on success, or an error code otherwise
+ */
+RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page) {
+    LOG_TRACE("Marking dirty page.\n");
+    Frames *frames = POOL_FRAMES(bm);
+    PageTableStripe *stripe = pageStripe(POOL_DATA(bm), POOL_FILE_ID(bm), page->pageNum);
 
-    writtenToDisk = 0;
-    readFromDisk = 0;
+    pthread_mutex_lock(&stripe->lock);
 
-    printf("Buffer Pool has initialized.\n");
-    isInitialized_bp=true;
+    // Look up the frame holding the specified page
+    int index = pageTableLookup(&stripe->table, POOL_FILE_ID(bm), page->pageNum);
 
-    // Release the global mutex lock after initialization
-    pthread_mutex_unlock(&bp_unique_init_mutex);
+    // If the specified page is not found in any frame, return error
+    if (index == -1) {
+        pthread_mutex_unlock(&stripe->lock);
+        return RC_BP_UNMARK_ERROR;
+    }
 
+    frames[index].dirty = true;
+    pthread_mutex_unlock(&stripe->lock);
+    TRACE_EVENT(TRACE_MARK_DIRTY, POOL_FILE_ID(bm), page->pageNum);
+    LOG_TRACE("Marked dirty page.\n");
     return RC_OK;
 }
 
 /*
- * Destroys a buffer pool, freeing up all associated resources.
- * If the buffer pool contains any dirty pages with a fix count of 0,
- * they are written back to disk before destroying the pool.
+ * Unpins a page in the buffer pool, indicating that it is no longer in use by the calling process.
  *
- * Parameters:
- * - bm: Pointer to the buffer pool structure to be shut down.
+ * @param bm   Buffer pool containing information about the buffer pool
+ * @param page Pointer to the page to be unpinned
+ * @return     RC_OK on success, or an error code otherwise
+ */
+RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page) {
+    LOG_TRACE("Unpinning page.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    Frames *frames = poolData->frames;
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), page->pageNum);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    // Look up the frame holding the specified page
+    int index = pageTableLookup(&stripe->table, POOL_FILE_ID(bm), page->pageNum);
+
+    // If the specified page is not found in any frame, return error
+    if (index == -1) {
+        pthread_mutex_unlock(&stripe->lock);
+        LOG_WARN("Page not found in buffer pool.\n");
+        return RC_BP_UNPIN_ERROR;
+    }
+
+    if (frames[index].fix_cnt > 0) {
+        int remaining = --frames[index].fix_cnt;
+        pthread_mutex_unlock(&stripe->lock);
+
+        // The frame joins the heap once the last pin is gone; heapUpdate checks that under the pool mutex
+        bool wakeWaiters = (remaining == 0 && poolData->pinWaiters > 0);
+        if (USES_VICTIM_HEAP(poolData) || wakeWaiters) {
+            pthread_mutex_lock(&poolData->poolMutex);
+            if (USES_VICTIM_HEAP(poolData)) {
+                heapUpdate(poolData, index);
+            }
+            if (wakeWaiters) {
+                pthread_cond_broadcast(&poolData->frameFreed);
+            }
+            pthread_mutex_unlock(&poolData->poolMutex);
+        }
+        TRACE_EVENT(TRACE_UNPIN, POOL_FILE_ID(bm), page->pageNum);
+        LOG_TRACE("Unpinned page.\n");
+        return RC_OK;
+    } else {
+        pthread_mutex_unlock(&stripe->lock);
+        LOG_WARN("Page is already unpinned.\n");
+        return RC_BP_UNPIN_ERROR;
+    }
+}
+
+/*
+ * Forces a dirty page to disk, ensuring that any modifications are written back to the page file.
+ * The frame is pinned for the write, which is made with the locks released.
  *
- * Returns:
- * - RC_OK if the buffer pool is successfully shut down, otherwise an error code.
+ * @param bm   Buffer pool containing information about the buffer pool
+ * @param page Pointer to the page to be forced to disk
+ * @return     RC_OK on success, or an error code otherwise
  */
-RC shutdownBufferPool(BM_BufferPool *const bm) {
-    printf("Shutting down the Buffer Pool.\n");
-    if (isInitialized_bp == false) {
-        pthread_mutex_destroy(&buffer_pool_init_mutex);
-        return RC_BP_SHUNTDOWN_ERROR;
+RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page) {
+    LOG_TRACE("Forcing dirty page to disk.\n");
+    BM_PoolData *poolData = POOL_DATA(bm);
+    PageTableStripe *stripe = pageStripe(poolData, POOL_FILE_ID(bm), page->pageNum);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    // Look up the frame holding the specified page, once no other pin is loading it
+    int index = pageTableLookup(&stripe->table, POOL_FILE_ID(bm), page->pageNum);
+    while (index != -1 && poolData->frames[index].ioInProgress) {
+        pthread_cond_wait(&stripe->ioDone, &stripe->lock);
+        index = pageTableLookup(&stripe->table, POOL_FILE_ID(bm), page->pageNum);
+    }
+
+    // If the specified page is not found in any frame, return error
+    if (index == -1) {
+        pthread_mutex_unlock(&stripe->lock);
+        return RC_BP_FORCE_ERROR;
+    }
+
+    // The files array may move while the locks are released, so write through a copy of the handle
+    pthread_mutex_lock(&poolData->poolMutex);
+    startFrameWrite(poolData, index);
+    SM_FileHandle fHandle = poolData->files[POOL_FILE_ID(bm)].fHandle;
+    pthread_mutex_unlock(&poolData->poolMutex);
+    pthread_mutex_unlock(&stripe->lock);
+
+    RC rc = writeFrame(poolData, index, &fHandle);
+    endFrameWrite(poolData, index, rc, &fHandle);
+    TRACE_EVENT(TRACE_FORCE_PAGE, POOL_FILE_ID(bm), page->pageNum);
+    return RC_OK;
+}
+
+/*
+ * Updates the strategy's bookkeeping for a pin that found its page in the
+ * pool. FIFO and CLOCK only need the reference bit, so their hits never
+ * take the pool mutex. A page of an access ring stays in the ring while
+ * only pins through that ring find it; any other pin hands it over to the
+ * strategy. The caller holds a pin on the frame, so it cannot be evicted
+ * meanwhile.
+ */
+static void recordHit (BM_PoolData *poolData, int index, BM_RingData *ring) {
+    Frames *frames = poolData->frames;
+
+    frames[index].referenced = true;
+    if (frames[index].ringId != 0) {
+        pthread_mutex_lock(&poolData->poolMutex);
+        bool inOwnRing = (ring != NULL && frames[index].ringId == ring->id);
+        if (!inOwnRing && frames[index].ringId != 0) {
+            ringAdopt(poolData, index);
+        }
+        pthread_mutex_unlock(&poolData->poolMutex);
+        if (inOwnRing) {
+            return;
+        }
+    }
+    if (poolData->strategy == RS_FIFO || poolData->strategy == RS_CLOCK) {
+        return;
+    }
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    frames[index].lruOrder = ++poolData->lruCounter;
+    frames[index].frequency++;
+    if (poolData->strategy == RS_LRU_K) {
+        lrukReference(poolData, index);
+    } else if (poolData->strategy == RS_LRU) {
+        lruPushFront(poolData, index);
+    } else if (poolData->strategy == RS_ARC) {
+        arcPushFront(poolData->arc, ARC_T2, index);
+    }
+    if (USES_VICTIM_HEAP(poolData)) {
+        heapUpdate(poolData, index);
+    }
+
+    // Age the use counts once the decay period is over
+    if (poolData->lfuDecayPeriod > 0 && ++poolData->lfuPinsSinceDecay >= poolData->lfuDecayPeriod) {
+        lfuDecay(poolData);
+    }
+    pthread_mutex_unlock(&poolData->poolMutex);
+}
+
+/*
+ * Pins a page, or for a prefetch only loads it. Hits take only the lock of
+ * the page's stripe. A miss also takes the pool mutex to choose a frame, but
+ * releases both for the I/O; concurrent pins of the same page wait for that
+ * read instead of issuing their own. If every frame is pinned the pin fails,
+ * after waiting up to the pool's pinWaitMillis for an unpin if it was given
+ * one. A prefetch never waits: it gives up on pages already there or on
+ * their way, and on pools without a free or clean frame to load into.
+ * A miss through an access ring that is full recycles the ring's oldest
+ * frame; until the ring is full, or when that frame is pinned, the page is
+ * loaded the usual way and its frame joins the ring.
+ *
+ * @param bm       Buffer pool containing information about the buffer pool
+ * @param page     Page handle to point at the page
+ * @param pageNum  Page number to be pinned
+ * @param prefetch Whether to leave the page unpinned once it is loaded
+ * @param ring     Access ring to load the page into, NULL for none
+ * @return         RC_OK on success, or an error code otherwise
+ */
+static RC loadPage (BM_BufferPool *const bm, BM_PageHandle *const page,
+                    const PageNumber pageNum, bool prefetch, BM_RingData *ring) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_BP_PIN_ERROR;
+    }
+
+    BM_PoolData *poolData = POOL_DATA(bm);
+    Frames *frames = poolData->frames;
+    int fileId = POOL_FILE_ID(bm);
+
+    if (pageNum < 0) {
+        return RC_BP_PIN_ERROR;
     }
 
-    // Acquire the global mutex lock
-    pthread_mutex_lock(&buffer_pool_init_mutex);
+    PageTableStripe *stripe = pageStripe(poolData, fileId, pageNum);
+    struct timespec deadline;
+    bool waiting = false;
+    bool recycled = false;
+    RC rc = RC_OK;
+
+    pthread_mutex_lock(&stripe->lock);
+    while (true) {
+        // Check if page is already in buffer pool, waiting while another pin loads it
+        int index = pageTableLookup(&stripe->table, fileId, pageNum);
+        if (index != -1 && prefetch) {
+            pthread_mutex_unlock(&stripe->lock);
+            return RC_OK;
+        }
+        if (index != -1 && frames[index].ioInProgress) {
+            pthread_cond_wait(&stripe->ioDone, &stripe->lock);
+            continue;
+        }
 
-    Frames *frames = (Frames *) bm->mgmtData;
+        if (index != -1) {
+            TRACE_EVENT(TRACE_PIN_HIT, fileId, pageNum);
+            COUNT_EVENT(poolData->counters->hits);
+            frames[index].fix_cnt++;
+            pthread_mutex_unlock(&stripe->lock);
+            page->pageNum = pageNum;
+            page->data = frames[index].memPage;
+            recordHit(poolData, index, ring);
+            return RC_OK;
+        }
 
-    // Set a flag to indicate that the buffer pool is shutting down
-    buffer_pool_shutting_down = true;
+        TRACE_EVENT(TRACE_PIN_MISS, fileId, pageNum);
+        if (pageTableReserve(&stripe->table) != RC_OK) {
+            pthread_mutex_unlock(&stripe->lock);
+            return RC_BP_PIN_ERROR;
+        }
+        pthread_mutex_lock(&poolData->poolMutex);
+
+        // A full ring recycles its oldest frame
+        if (ring != NULL && ring->count == ring->numFrames) {
+            poolData->claimCleanOnly = prefetch;
+            int ringIndex = ringClaim(poolData, stripe, ring, 1);
+            poolData->claimCleanOnly = false;
+            if (ringIndex != -1) {
+                recycled = true;
+                rc = replaceFrame(poolData, page, stripe, ringIndex, fileId, pageNum, POOL_VIEW(bm)->readBatch);
+                break;
+            }
+        }
 
-    // Wait for all threads to complete their operations
-    while (active_threads > 0) {
-        pthread_cond_wait(&buffer_pool_cond, &buffer_pool_init_mutex);
-    }
+        if (poolData->numFreeFrames > 0) {
+            // Page is not in buffer pool, take a free slot if any is left
+            int freeSlotIndex = poolData->freeFrames[--poolData->numFreeFrames];
+            frames[freeSlotIndex].fix_cnt = 1;
+            frames[freeSlotIndex].ioInProgress = true;
 
-    // Write dirty page back to disk
-    forceFlushPool(bm);
+            // Read page from disk into the selected frame; on failure it goes back to the free list
+            rc = replaceFrame(poolData, page, stripe, freeSlotIndex, fileId, pageNum, POOL_VIEW(bm)->readBatch);
+            if (rc == RC_OK && ring == NULL) {
+                admitFrame(poolData, freeSlotIndex, fileId, pageNum);
+            }
+            break;
+        }
 
-    // Now free the memory for each page frame
-    for (int i = 0; i < bm->numPages; i++) {
-        if (frames[i].memPage != NULL) {
-            free(frames[i].memPage);
-            frames[i].memPage = NULL; // Avoid dangling pointer
+        // No free slot found. Frames the background writer holds cannot be
+        // chosen as victims, so let its writes finish first
+        waitForBackgroundWrites(poolData);
+
+        // Call the appropriate replacement strategy function
+        poolData->victimBusy = false;
+        poolData->claimCleanOnly = prefetch;
+        switch (poolData->strategy) {
+            case RS_FIFO:
+                rc = FIFO(bm, page, pageNum);
+                break;
+            case RS_LRU:
+                rc = LRU(bm, page, pageNum);
+                break;
+            case RS_CLOCK:
+                rc = CLOCK(bm, page, pageNum);
+                break;
+            case RS_LFU:
+                rc = LFU(bm, page, pageNum);
+                break;
+            case RS_LRU_K:
+                rc = LRU_K(bm, page, pageNum);
+                break;
+            case RS_ARC:
+                rc = ARC(bm, page, pageNum);
+                break;
+            default:
+                rc = RC_BP_PIN_ERROR;
+                break;
         }
-        if (&(frames->pageLatches[i]) != NULL) {
-            destroyLatch(&(frames->pageLatches[i]));
+        poolData->claimCleanOnly = false;
+
+        // With every other frame pinned a ring that is not full yet recycles its own
+        if (rc == RC_BP_PIN_ERROR && ring != NULL && ring->count > 0) {
+            poolData->claimCleanOnly = prefetch;
+            int ringIndex = ringClaim(poolData, stripe, ring, ring->count);
+            poolData->claimCleanOnly = false;
+            if (ringIndex != -1) {
+                recycled = true;
+                rc = replaceFrame(poolData, page, stripe, ringIndex, fileId, pageNum, POOL_VIEW(bm)->readBatch);
+                break;
+            }
         }
-    }
 
-    // Free memory for the array of page latches
-    free(frames->pageLatches);
-    frames->pageLatches = NULL;
+        // Failing that, the unpinned frames of other rings are fair game
+        if (rc == RC_BP_PIN_ERROR) {
+            poolData->claimCleanOnly = prefetch;
+            int stolenIndex = ringSteal(poolData, stripe);
+            poolData->claimCleanOnly = false;
+            if (stolenIndex != -1) {
+                rc = replaceFrame(poolData, page, stripe, stolenIndex, fileId, pageNum, POOL_VIEW(bm)->readBatch);
+                if (rc == RC_OK && ring == NULL) {
+                    admitFrame(poolData, stolenIndex, fileId, pageNum);
+                } else if (rc != RC_OK && frames[stolenIndex].pageNumber != NO_PAGE) {
+                    // The old page could not be written back and stays, now with the strategy
+                    ringAdopt(poolData, stolenIndex);
+                }
+                break;
+            }
+        }
+        if (rc != RC_BP_PIN_ERROR || prefetch) {
+            break;
+        }
 
-    // Free memory associated with the buffer pool
-    free(frames);
-    bm->mgmtData = NULL;
+        if (poolData->victimBusy) {
+            // A candidate's stripe was held by a thread that may be waiting for the
+            // pool mutex; let it finish and look again, the page may be loaded by now
+            pthread_mutex_unlock(&poolData->poolMutex);
+            pthread_mutex_unlock(&stripe->lock);
+            sched_yield();
+            pthread_mutex_lock(&stripe->lock);
+            continue;
+        }
 
-    isInitialized_bp = false;
+        // Every frame is pinned; fail, or wait for an unpin if the pool was given a timeout
+        if (poolData->pinWaitMillis == 0) {
+            break;
+        }
+        if (!waiting) {
+            // Registered as a waiter before looking once more, so an unpin in between is not missed
+            waiting = true;
+            poolData->pinWaiters++;
+            COUNT_EVENT(poolData->counters->pinWaits);
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += poolData->pinWaitMillis / 1000;
+            deadline.tv_nsec += (poolData->pinWaitMillis % 1000) * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_mutex_unlock(&poolData->poolMutex);
+            continue;
+        }
 
-    // Release the global mutex lock
-    pthread_mutex_unlock(&buffer_pool_init_mutex);
+        // Unpins of this page's stripe must not wait for us while we sleep
+        pthread_mutex_unlock(&stripe->lock);
+        int waitRc = pthread_cond_timedwait(&poolData->frameFreed, &poolData->poolMutex, &deadline);
+        pthread_mutex_unlock(&poolData->poolMutex);
+        pthread_mutex_lock(&stripe->lock);
+        if (waitRc == ETIMEDOUT) {
+            pthread_mutex_lock(&poolData->poolMutex);
+            break;
+        }
+    }
+    if (waiting) {
+        poolData->pinWaiters--;
+    }
 
-    // Destroy the mutex lock and condition variable
-    pthread_mutex_destroy(&buffer_pool_init_mutex);
-    pthread_cond_destroy(&buffer_pool_cond);
+    if (rc == RC_OK && !prefetch) {
+        COUNT_EVENT(poolData->counters->misses);
+    }
 
-    printf("Buffer Pool has shut down.\n");
-    return RC_OK;
+    // Frame the page was loaded into; frames of mapped files are not in the arena
+    int index = (rc == RC_OK) ? pageTableLookup(&stripe->table, fileId, pageNum) : -1;
+    if (rc == RC_OK && ring != NULL && !recycled) {
+        ringAttach(poolData, ring, index);
+    }
+    if (rc == RC_OK && prefetch) {
+        // Leave the page unpinned for the pin it was loaded for
+        frames[index].fix_cnt--;
+        if (USES_VICTIM_HEAP(poolData)) {
+            heapUpdate(poolData, index);
+        }
+        signalFrameFreed(poolData);
+    } else if (rc == RC_OK && poolData->lfuDecayPeriod > 0 &&
+               ++poolData->lfuPinsSinceDecay >= poolData->lfuDecayPeriod) {
+        // Age the use counts once the decay period is over
+        lfuDecay(poolData);
+    }
+    pthread_mutex_unlock(&poolData->poolMutex);
+    pthread_mutex_unlock(&stripe->lock);
+    return rc;
 }
 
 /*
- * Writes all dirty pages with a fix count of 0 from the buffer pool to disk.
- *
- * Parameters:
- * - bm: Pointer to the buffer pool structure.
+ * Takes the next page a warm restart loads. Loading only fills free frames:
+ * once none is left, every warm restart stops, so it never evicts a page
+ * someone pinned meanwhile. Called with the pool mutex held.
  *
- * Returns:
- * - RC_OK if all dirty pages are successfully written to disk, otherwise an error code.
+ * @param poolData Bookkeeping of the buffer pool
+ * @param request  Receives the page to load
+ * @return         true if there is a page to load
  */
-RC forceFlushPool(BM_BufferPool *const bm) {
-    printf("Forcing flush the Buffer Pool.\n");
-    if (isInitialized_bp == false) {
-        return RC_BP_FLUSHPOOL_FAILED;
-    }
-
-    Frames *frames = (Frames *) bm->mgmtData;
-    int numPages = bm->numPages;
-    int check_error = 0;
-
-    // Check for pinned pages
-    for (int i = 0; i< numPages; i++) {
-        if (frames[i].dirty == true && frames[i].fix_cnt == 0) {
-            // Acquire a latch to ensure exclusive access to the memory page
-            lockLatchForWrite(&(frames->pageLatches[i]));
-
-            SM_FileHandle fHandle;
-            openPageFile(bm->pageFile, &fHandle);
-            writeBlock(frames[i].pageNumber, &fHandle, frames[i].memPage);
-            closePageFile(&fHandle);
-            frames[i].dirty = false;
-            writtenToDisk++;
-            releaseLatchAfterWrite(&(frames->pageLatches[i]));
-        } else {
-            check_error++;
+static bool takeWarmPage (BM_PoolData *poolData, BM_PrefetchRequest *request) {
+    for (int i = 0; i < poolData->numFiles; i++) {
+        BM_PoolFile *file = &poolData->files[i];
+        if (file->warmPages == NULL) {
+            continue;
         }
-        if (frames[i].fix_cnt != 0) {
-            return RC_BP_FLUSHPOOL_FAILED;
+        if (poolData->numFreeFrames == 0 || file->warmNext == file->numWarmPages) {
+            free(file->warmPages);
+            file->warmPages = NULL;
+            continue;
         }
-    }
 
-    if (check_error == numPages) {
-        return RC_BP_FLUSHPOOL_FAILED;
-    } else {
-        printf("Finished force flush pool.\n");
-        return RC_OK;
+        request->fileId = i;
+        request->pageNum = file->warmPages[file->warmNext++];
+        request->ring = NULL;
+        return true;
     }
+    return false;
 }
 
 /*
- * FIFO (First-In-First-Out) page replacement strategy.
- * This function implements the FIFO page replacement algorithm,
- * which selects the page that was brought into memory first for eviction.
+ * Takes as many queued requests for the file and access ring of the one at
+ * the head of the queue as one prefetch batch holds: up to
+ * BM_PREFETCH_BATCH_PAGES pages in up to BM_IO_DEPTH runs of consecutive
+ * pages, each of at most BM_READ_RUN_PAGES. Requests past the end of the
+ * file are dropped. Called with the pool mutex held and a request queued.
  *
- * @param bm     Buffer pool containing information about the buffer pool
- * @param page   Pointer to the page to be replaced
- * @return       RC_OK on success, or an error code otherwise
+ * @param poolData   Bookkeeping of the buffer pool
+ * @param requests   Receives the requests, run after run
+ * @param runLengths Receives the number of requests in each run
+ * @return           Number of runs, 0 if every request taken was dropped
  */
-RC FIFO (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
-    printf("Using FIFO strategy.\n");
-    Frames *frames = (Frames *) bm->mgmtData;
-    int FIFO_PageIndex;
-    int check_error = 0;
-
-    FIFO_PageIndex = readFromDisk % bm->numPages;
-
-    for (int i = 0; i< bm->numPages; i++) {
-        // Handle using pages
-        if (frames[FIFO_PageIndex].fix_cnt == 0) {
-            if (frames[FIFO_PageIndex].dirty) {
-                lockLatchForWrite(&(frames->pageLatches[FIFO_PageIndex]));
-                SM_FileHandle fHandle;
-                openPageFile(bm->pageFile, &fHandle);
-                writeBlock(frames[FIFO_PageIndex].pageNumber, &fHandle, frames[FIFO_PageIndex].memPage);
-                closePageFile(&fHandle);
-                frames[FIFO_PageIndex].dirty = false;
-                writtenToDisk++;
-                releaseLatchAfterWrite(&(frames->pageLatches[FIFO_PageIndex]));
-            }
-
-            // Read page from disk into a new frame
-            lockLatchForRead(&(frames->pageLatches[FIFO_PageIndex]));
-            SM_FileHandle fHandle;
-            openPageFile(bm->pageFile, &fHandle);
-            ensureCapacity(pageNum, &fHandle);
-            readBlock(pageNum, &fHandle, frames[FIFO_PageIndex].memPage);
-            closePageFile(&fHandle);
-            releaseLatchAfterRead(&(frames->pageLatches[FIFO_PageIndex]));
-
-            readFromDisk++;
-
-            // Update frame information with the new page
-            lruCounter++;
-            frames[FIFO_PageIndex].pageNumber = pageNum;
-            frames[FIFO_PageIndex].dirty = false;
-            frames[FIFO_PageIndex].fix_cnt = 1;
-            frames[FIFO_PageIndex].lruOrder = lruCounter;
-            page->pageNum = pageNum;
-            page->data = frames[FIFO_PageIndex].memPage;
+static int takeBatch (BM_PoolData *poolData, BM_PrefetchRequest *requests, int *runLengths) {
+    BM_PrefetchRequest first = poolData->prefetchQueue[poolData->prefetchHead];
+    int numPages = poolData->files[first.fileId].fHandle.totalNumPages;
+    int numRequests = 0;
+    int numRuns = 0;
+
+    while (poolData->prefetchCount > 0 && numRequests < BM_PREFETCH_BATCH_PAGES) {
+        BM_PrefetchRequest request = poolData->prefetchQueue[poolData->prefetchHead];
+        if (request.fileId != first.fileId || request.ring != first.ring) {
+            break;
+        }
+        bool continues = (numRuns > 0 && request.pageNum == requests[numRequests - 1].pageNum + 1 &&
+                          runLengths[numRuns - 1] < BM_READ_RUN_PAGES);
+        if (!continues && numRuns == BM_IO_DEPTH) {
             break;
+        }
+        poolData->prefetchHead = (poolData->prefetchHead + 1) % BM_PREFETCH_QUEUE_SIZE;
+        poolData->prefetchCount--;
+
+        // Prefetching never grows a file
+        if (request.pageNum >= numPages) {
+            continue;
+        }
+        requests[numRequests++] = request;
+        if (continues) {
+            runLengths[numRuns - 1]++;
         } else {
-            FIFO_PageIndex++;
-            FIFO_PageIndex = FIFO_PageIndex % bm->numPages;
-            check_error++;
+            runLengths[numRuns++] = 1;
         }
     }
-    // If all pages are pinned, return an error
-    if (check_error == bm->numPages) {
-        return RC_BP_PIN_ERROR;
-    }
-    return RC_OK;
+    return numRuns;
 }
 
 /*
- * LRU (Least Recently Used) page replacement strategy.
- * This function implements the LRU page replacement algorithm,
- * which selects the page that has not been used for the longest time for eviction.
- *
- * @param bm     Buffer pool containing information about the buffer pool
- * @param page   Pointer to the page to be replaced
- * @return       RC_OK on success, or an error code otherwise
+ * Tells whether a page is in the pool or on its way there.
  */
-RC LRU (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
-    printf("Using LRU strategy.\n");
-    Frames *frames = (Frames *) bm->mgmtData;
-    int LRU_PageIndex = 0;
-    int comNum = frames[0].lruOrder;
-
-    // Find the index of the least recently used page
-    for (int i = 1; i < bm->numPages; i++) {
-        if (frames[i].lruOrder < comNum) {
-            comNum = frames[i].lruOrder;
-            LRU_PageIndex = i;
-        }
-    }
-
-    // Check if the least recently used page is dirty and write it back to disk
-    if (frames[LRU_PageIndex].dirty) {
-        lockLatchForWrite(&(frames->pageLatches[LRU_PageIndex]));
-        SM_FileHandle fHandle;
-        openPageFile(bm->pageFile, &fHandle);
-        writeBlock(frames[LRU_PageIndex].pageNumber, &fHandle, frames[LRU_PageIndex].memPage);
-        closePageFile(&fHandle);
-        frames[LRU_PageIndex].dirty = false;
-        writtenToDisk++;
-        releaseLatchAfterWrite(&(frames->pageLatches[LRU_PageIndex]));
-    }
-
-    // Read the new page from disk into the selected frame
-    lockLatchForRead(&(frames->pageLatches[LRU_PageIndex]));
-    SM_FileHandle fHandle;
-    openPageFile(bm->pageFile, &fHandle);
-    ensureCapacity(pageNum, &fHandle);
-    readBlock(pageNum, &fHandle, frames[LRU_PageIndex].memPage);
-    closePageFile(&fHandle);
-    releaseLatchAfterRead(&(frames->pageLatches[LRU_PageIndex]));
-
-    readFromDisk++;
-
-    // Update frame information with the new page and its usage order
-    lruCounter++;
-    frames[LRU_PageIndex].pageNumber = pageNum;
-    frames[LRU_PageIndex].dirty = false;
-    frames[LRU_PageIndex].fix_cnt = 1;
-    frames[LRU_PageIndex].lruOrder = lruCounter;
-    page->pageNum = pageNum;
-    page->data = frames[LRU_PageIndex].memPage;
-
-    return RC_OK;
-}
-
-// Function to swap two elements
-void swap(int* a, int* b) {
-    int temp = *a;
-    *a = *b;
-    *b = temp;
+static bool pageCached (BM_PoolData *poolData, int fileId, PageNumber pageNum) {
+    PageTableStripe *stripe = pageStripe(poolData, fileId, pageNum);
+    pthread_mutex_lock(&stripe->lock);
+    bool cached = (pageTableLookup(&stripe->table, fileId, pageNum) != -1);
+    pthread_mutex_unlock(&stripe->lock);
+    return cached;
 }
 
-// Function to partition the array and return the pivot index
-int partition(int arr[], int low, int high) {
-    int pivot = arr[high]; // Choose the rightmost element as the pivot
-    int i = low - 1; // Index of smaller element
-
-    for (int j = low; j < high; j++) {
-        // If current element is smaller than or equal to pivot
-        if (arr[j] <= pivot) {
-            i++; // Increment index of smaller element
-            swap(&arr[i], &arr[j]);
+/*
+ * Loads pages for the prefetcher through loadPage, with a view of its own
+ * for their file that copies them out of the batch where it can.
+ */
+static void loadPrefetched (BM_PoolData *poolData, const BM_ReadBatch *batch, int fileId,
+                            const BM_PrefetchRequest *requests, int numRequests) {
+    BM_PoolView view = {.pool = poolData, .fileId = fileId, .readBatch = batch};
+    BM_BufferPool bm = {.mgmtData = &view};
+
+    for (int i = 0; i < numRequests; i++) {
+        BM_PageHandle page;
+        if (loadPage(&bm, &page, requests[i].pageNum, true, requests[i].ring) == RC_OK) {
+            TRACE_EVENT(TRACE_PREFETCH, fileId, requests[i].pageNum);
         }
     }
-    swap(&arr[i + 1], &arr[high]);
-    return i + 1;
-}
-
-// Quicksort function in ascending order
-void quickSort(int arr[], int low, int high) {
-    if (low < high) {
-        // Partition the array
-        int pi = partition(arr, low, high);
-
-        // Recursively sort elements before partition and after partition
-        quickSort(arr, low, pi - 1);
-        quickSort(arr, pi + 1, high);
-    }
 }
 
 /*
- * LRU-K (Least Recently Used with K-Value) page replacement strategy.
- * This function implements the LRU-K page replacement algorithm,
- * which selects the page that has not been used for the longest time within the last K references for eviction.
- *
- * @param bm     Buffer pool containing information about the buffer pool
- * @param page   Pointer to the page to be replaced
- * @return       RC_OK on success, or an error code otherwise
+ * Prefetcher. Takes the queued pages a batch at a time, see takeBatch, and
+ * once the queue is empty the pages of warm restarts one at a time. Each run
+ * of a batch, less the cached pages at either end, is read with one request
+ * on an I/O queue of the prefetcher's own, so all of them are in flight at
+ * once; as each read finishes, the pages of its run are loaded by copying
+ * them out of it. A lone page is left for loadPage to read into its frame.
  */
-RC LRU_K (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
-    printf("Using LRU strategy.\n");
-    Frames *frames = (Frames *) bm->mgmtData;
-    int k = bm->stratParam;
-    int orderNum[bm->numPages];
-    int LRU_PageIndex = 0;
-
-    // Populate the array with the order numbers of pages
-    for (int i = 0; i < bm->numPages; i++) {
-        orderNum[i] = frames[i].lruOrder;
+static void *prefetcher (void *arg) {
+    BM_PoolData *poolData = arg;
+    BM_PrefetchRequest requests[BM_PREFETCH_BATCH_PAGES];
+    int runLengths[BM_IO_DEPTH];
+    int runStarts[BM_IO_DEPTH];
+    int runPages[BM_IO_DEPTH];
+    bool runQueued[BM_IO_DEPTH];
+    SM_IOCompletion completions[BM_IO_DEPTH];
+    BM_ReadBatch batch;
+    SM_PageHandle staging = NULL;
+    SM_IOQueue ioQueue;
+
+    // Frames of mapped files point into the mapping, there is nothing to copy them from
+    if (!poolData->mapFiles &&
+        posix_memalign((void **) &staging, BM_FRAME_ALIGNMENT, (size_t) BM_PREFETCH_BATCH_PAGES * poolData->pageSize) == 0 &&
+        initIOQueue(&ioQueue, BM_IO_DEPTH, SM_IO_URING) != RC_OK) {
+        free(staging);
+        staging = NULL;
     }
 
-    // Sort the order numbers in ascending order using quicksort
-    quickSort(orderNum, 0, bm->numPages - 1);
-
-    // Find the page with the K-th least recent order number
-    for (int i = 0; i < bm->numPages; i++) {
-        if(orderNum[bm->numPages - k] == frames[i].lruOrder) {
-            LRU_PageIndex = i;
-            break;
+    pthread_mutex_lock(&poolData->poolMutex);
+    while (!poolData->prefetcherStop) {
+        int numRuns = 1;
+        runLengths[0] = 1;
+        if (poolData->prefetchCount > 0) {
+            numRuns = takeBatch(poolData, requests, runLengths);
+        } else if (!takeWarmPage(poolData, &requests[0])) {
+            pthread_cond_wait(&poolData->prefetchCond, &poolData->poolMutex);
+            continue;
+        } else if (requests[0].pageNum >= poolData->files[requests[0].fileId].fHandle.totalNumPages) {
+            continue;
+        }
+        if (numRuns == 0) {
+            continue;
         }
-    }
 
-    // Check if the selected page is dirty and write it back to disk
-    if (frames[LRU_PageIndex].dirty) {
-        lockLatchForWrite(&(frames->pageLatches[LRU_PageIndex]));
-        SM_FileHandle fHandle;
-        openPageFile(bm->pageFile, &fHandle);
-        writeBlock(frames[LRU_PageIndex].pageNumber, &fHandle, frames[LRU_PageIndex].memPage);
-        closePageFile(&fHandle);
-        frames[LRU_PageIndex].dirty = false;
-        writtenToDisk++;
-        releaseLatchAfterWrite(&(frames->pageLatches[LRU_PageIndex]));
-    }
-
-    // Read the new page from disk into the selected frame
-    lockLatchForRead(&(frames->pageLatches[LRU_PageIndex]));
-    SM_FileHandle fHandle;
-    openPageFile(bm->pageFile, &fHandle);
-    ensureCapacity(pageNum, &fHandle);
-    readBlock(pageNum, &fHandle, frames[LRU_PageIndex].memPage);
-    closePageFile(&fHandle);
-    releaseLatchAfterRead(&(frames->pageLatches[LRU_PageIndex]));
-
-    readFromDisk++;
-
-    // Update frame information with the new page and its usage order
-    lruCounter++;
-    frames[LRU_PageIndex].pageNumber = pageNum;
-    frames[LRU_PageIndex].dirty = false;
-    frames[LRU_PageIndex].fix_cnt = 1;
-    frames[LRU_PageIndex].lruOrder = lruCounter;
-    page->pageNum = pageNum;
-    page->data = frames[LRU_PageIndex].memPage;
+        int fileId = requests[0].fileId;
+        poolData->prefetchFileId = fileId;
+        poolData->prefetchRing = requests[0].ring;
+        SM_FileHandle fHandle = poolData->files[fileId].fHandle;
+        batch.fileId = fileId;
+        batch.writeSeq = atomic_load(&poolData->writeSeq);
+        batch.numRuns = numRuns;
+        pthread_mutex_unlock(&poolData->poolMutex);
+
+        int numRequests = 0;
+        int inFlight = 0;
+        for (int r = 0; r < numRuns; r++) {
+            runStarts[r] = numRequests;
+            numRequests += runLengths[r];
+        }
+        for (int r = 0; r < numRuns; r++) {
+            int first = runStarts[r];
+            int last = first + runLengths[r] - 1;
+            batch.runs[r].numPages = 0;
+            runQueued[r] = false;
+            if (staging == NULL || (numRuns == 1 && runLengths[0] == 1)) {
+                loadPrefetched(poolData, NULL, fileId, &requests[first], runLengths[r]);
+                continue;
+            }
 
-    return RC_OK;
-}
+            while (first < last && pageCached(poolData, fileId, requests[first].pageNum)) {
+                first++;
+            }
+            while (last > first && pageCached(poolData, fileId, requests[last].pageNum)) {
+                last--;
+            }
+            batch.runs[r].firstPage = requests[first].pageNum;
+            batch.runs[r].data = staging + (size_t) first * fHandle.pageSize;
+            runPages[r] = last - first + 1;
+            if ((first == last && pageCached(poolData, fileId, requests[first].pageNum)) ||
+                submitRead(&ioQueue, batch.runs[r].firstPage, runPages[r], &fHandle,
+                           batch.runs[r].data, (void *) (intptr_t) r) != RC_OK) {
+                loadPrefetched(poolData, &batch, fileId, &requests[runStarts[r]], runLengths[r]);
+                continue;
+            }
+            runQueued[r] = true;
+            inFlight++;
+        }
 
-/*
- * Marks a page in the buffer pool as dirty, indicating that it has been modified.
- *
- * @param bm   Buffer pool containing information about the buffer pool
- * @param page Pointer to the page to be marked as dirty
- * @return     RC_OK on success, or an error code otherwise
- */
-RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page) {
-    printf("Marking dirty page.\n");
-    Frames *frames = (Frames *) bm->mgmtData;
-    int check_error = 0;
-
-    // Iterate through the frames to find the specified page
-    for (int i = 0; i< bm->numPages; i++) {
-        if (frames[i].pageNumber == page->pageNum) {
-            frames[i].dirty = true;
-        } else {
-            check_error++;
+        while (inFlight > 0) {
+            int n = 0;
+            if (waitIOQueue(&ioQueue, completions, 1, BM_IO_DEPTH, &n) != RC_OK || n == 0) {
+                // Once the queue is shut down nothing reads into the staging area anymore;
+                // the runs still queued are loaded page by page, and so is everything after
+                shutdownIOQueue(&ioQueue);
+                for (int r = 0; r < numRuns; r++) {
+                    if (runQueued[r]) {
+                        loadPrefetched(poolData, &batch, fileId, &requests[runStarts[r]], runLengths[r]);
+                    }
+                }
+                free(staging);
+                staging = NULL;
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                int r = (int) (intptr_t) completions[i].userData;
+                runQueued[r] = false;
+                if (completions[i].rc == RC_OK) {
+                    batch.runs[r].numPages = runPages[r];
+                }
+                loadPrefetched(poolData, &batch, fileId, &requests[runStarts[r]], runLengths[r]);
+                inFlight--;
+            }
         }
+
+        pthread_mutex_lock(&poolData->poolMutex);
+        poolData->prefetchFileId = -1;
+        poolData->prefetchRing = NULL;
+        pthread_cond_broadcast(&poolData->poolCond);
     }
+    pthread_mutex_unlock(&poolData->poolMutex);
 
-    // If the specified page is not found in any frame, return error
-    if(check_error == bm->numPages) {
-        return RC_BP_UNMARK_ERROR;
-    } else {
-        printf("Marked dirty page.\n");
-        return RC_OK;
+    if (staging != NULL) {
+        shutdownIOQueue(&ioQueue);
+        free(staging);
     }
+    return NULL;
 }
 
 /*
- * Unpins a page in the buffer pool, indicating that it is no longer in use by the calling process.
+ * Queues a page for the prefetcher, starting it on the first request. A
+ * full queue drops the request; prefetching is only ever a hint.
+ * Called with the pool mutex held.
  *
- * @param bm   Buffer pool containing information about the buffer pool
- * @param page Pointer to the page to be unpinned
- * @return     RC_OK on success, or an error code otherwise
+ * @return RC_OK on success, or RC_BP_PIN_ERROR if the prefetcher cannot be started
  */
-RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page) {
-    printf("Unpinning page.\n");
-    Frames *frames = (Frames *) bm->mgmtData;
-
-    // Iterate through the frames to find the specified page
-    for (int i = 0; i< bm->numPages; i++) {
-        if (frames[i].pageNumber == page->pageNum) {
-            if (frames[i].fix_cnt > 0) {
-                frames[i].fix_cnt--;
-                printf("Unpinned page.\n");
-                return RC_OK;
-            } else {
-                printf("Page is already unpinned.\n");
-                return RC_BP_UNPIN_ERROR;
-            }
-        }
+static RC queuePrefetch (BM_PoolData *poolData, int fileId, PageNumber pageNum, BM_RingData *ring) {
+    if (startPrefetcher(poolData) != RC_OK) {
+        return RC_BP_PIN_ERROR;
     }
 
-    // If the specified page is not found in any frame, return error
-    printf("Page not found in buffer pool.\n");
-    return RC_BP_UNPIN_ERROR;
+    if (poolData->prefetchCount < BM_PREFETCH_QUEUE_SIZE) {
+        int tail = (poolData->prefetchHead + poolData->prefetchCount) % BM_PREFETCH_QUEUE_SIZE;
+        poolData->prefetchQueue[tail].fileId = fileId;
+        poolData->prefetchQueue[tail].pageNum = pageNum;
+        poolData->prefetchQueue[tail].ring = ring;
+        poolData->prefetchCount++;
+        pthread_cond_signal(&poolData->prefetchCond);
+    }
+    return RC_OK;
 }
 
 /*
- * Forces a dirty page to disk, ensuring that any modifications are written back to the page file.
- *
- * @param bm   Buffer pool containing information about the buffer pool
- * @param page Pointer to the page to be forced to disk
- * @return     RC_OK on success, or an error code otherwise
+ * Follows the pins made through a view and, once BM_READAHEAD_TRIGGER of
+ * them in a row each moved on to the next page, keeps the pool's
+ * readaheadPages pages after the latest one queued for the prefetcher,
+ * bound for the access ring the pins went through if any. Pinning the
+ * same page again neither extends nor breaks a run.
  */
-RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page) {
-    printf("Forcing dirty page to disk.\n");
-    Frames *frames = (Frames *) bm->mgmtData;
-    int numPages = bm->numPages;
-    int check_error = 0;
-
-    // Iterate through the frames to find the specified page
-    for (int i = 0; i< numPages; i++) {
-        if (frames[i].pageNumber == page->pageNum) {
-            lockLatchForWrite(&(frames->pageLatches[i]));
-            SM_FileHandle fHandle;
-            openPageFile(bm->pageFile, &fHandle);
-            writeBlock(frames[i].pageNumber, &fHandle, frames[i].memPage);
-            closePageFile(&fHandle);
-            frames[i].dirty = false;
-            writtenToDisk++;
-            releaseLatchAfterWrite(&(frames->pageLatches[i]));
-        } else {
-            check_error++;
-        }
+static void readAhead (BM_BufferPool *const bm, PageNumber pageNum, BM_RingData *ring) {
+    BM_PoolView *view = POOL_VIEW(bm);
+    BM_PoolData *poolData = view->pool;
+    PageNumber last = atomic_exchange(&view->lastPinned, pageNum);
+
+    if (pageNum == last) {
+        return;
+    }
+    if (last == NO_PAGE || pageNum != last + 1) {
+        view->sequentialPins = 0;
+        view->readaheadNext = NO_PAGE;
+        return;
+    }
+    if (++view->sequentialPins < BM_READAHEAD_TRIGGER) {
+        return;
     }
 
-    // If the specified page is not found in any frame, return error
-    if(check_error == bm->numPages) {
-        return RC_BP_FORCE_ERROR;
-    } else {
-        return RC_OK;
+    PageNumber first = (view->readaheadNext > pageNum) ? view->readaheadNext : pageNum + 1;
+    PageNumber end = pageNum + poolData->readaheadPages + 1;
+    if (first >= end) {
+        return;
+    }
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    // Requests the scan has already passed would only read pages it is done with
+    while (poolData->prefetchCount > 0 &&
+           poolData->prefetchQueue[poolData->prefetchHead].fileId == view->fileId &&
+           poolData->prefetchQueue[poolData->prefetchHead].pageNum <= pageNum) {
+        poolData->prefetchHead = (poolData->prefetchHead + 1) % BM_PREFETCH_QUEUE_SIZE;
+        poolData->prefetchCount--;
+    }
+    for (PageNumber p = first; p < end; p++) {
+        queuePrefetch(poolData, view->fileId, p, ring);
     }
+    pthread_mutex_unlock(&poolData->poolMutex);
+    view->readaheadNext = end;
 }
 
 /*
  * Pins a page in the buffer pool, ensuring that it is available for use by the client.
+ * On pools with readahead, a run of sequential pins also queues the pages
+ * that follow for the prefetcher.
  *
  * @param bm      Buffer pool containing information about the buffer pool
  * @param page    Pointer to the page handle structure to store information about the pinned page
@@ -561,85 +3632,209 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page) {
  */
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
             const PageNumber pageNum) {
+    LOG_TRACE("Pinning page.\n");
+    RC rc = loadPage(bm, page, pageNum, false, NULL);
 
-    printf("Pinning page.\n");
-    if (!isInitialized_bp) {
-        return RC_BP_PIN_ERROR;
+    if (rc == RC_OK && POOL_DATA(bm)->readaheadPages > 0) {
+        readAhead(bm, pageNum, NULL);
     }
+    return rc;
+}
 
-    Frames *frames = (Frames *) bm->mgmtData;
-
-    if (pageNum < 0) {
+/*
+ * Queues pages for the prefetcher, bound for an access ring if one is given.
+ */
+static RC queuePrefetches (BM_BufferPool *const bm, const PageNumber *pageNums, int numPages,
+                           BM_RingData *ring) {
+    if (bm == NULL || bm->mgmtData == NULL || numPages < 0 || (numPages > 0 && pageNums == NULL)) {
         return RC_BP_PIN_ERROR;
     }
 
-    // Check if page is already in buffer pool
-    for (int i = 0; i< bm->numPages; i++) {
-        if (frames[i].pageNumber == pageNum) {
-            lruCounter++;
-            frames[i].fix_cnt++;
-            frames[i].lruOrder = lruCounter;
-            page->pageNum = pageNum;
-            page->data = frames[i].memPage;
-            return RC_OK;
+    BM_PoolData *poolData = POOL_DATA(bm);
+    RC rc = RC_OK;
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    for (int i = 0; i < numPages && rc == RC_OK; i++) {
+        if (pageNums[i] >= 0) {
+            rc = queuePrefetch(poolData, POOL_FILE_ID(bm), pageNums[i], ring);
         }
     }
+    pthread_mutex_unlock(&poolData->poolMutex);
+    return rc;
+}
 
-    // Page is not in buffer pool, find a free slot
-    int freeSlotIndex = -1;
-    for (int i = 0; i < bm->numPages; i++) {
-        if (frames[i].pageNumber == NO_PAGE) {
-            freeSlotIndex = i;
-            break;
-        }
+/*
+ * Asks for pages to be loaded into the pool ahead of the pins that will
+ * need them. The pages are read in the background into free or clean
+ * frames and left unpinned; pages already in the pool, pages past the end
+ * of the file and requests beyond BM_PREFETCH_QUEUE_SIZE are skipped.
+ *
+ * @param bm       Buffer pool containing information about the buffer pool
+ * @param pageNums Pages to load, most urgent first
+ * @param numPages Number of entries in pageNums
+ * @return         RC_OK on success, or RC_BP_PIN_ERROR if the arguments are
+ *                 invalid or the prefetcher cannot be started
+ */
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pageNums, int numPages) {
+    return queuePrefetches(bm, pageNums, numPages, NULL);
+}
+
+
+// Access Rings
+/*
+ * Sets up an access ring of up to numFrames frames on a buffer pool. The
+ * ring takes its frames from the pool as its first pins miss and recycles
+ * them from then on; the pages it holds stay cached and other pins find
+ * them, but leave the ring as soon as one does.
+ *
+ * @param bm        Buffer pool containing information about the buffer pool
+ * @param ring      Access ring to set up
+ * @param numFrames Most frames the ring may hold, fewer than the pool has
+ * @return          RC_OK on success, or RC_BP_INIT_ERROR if numFrames is
+ *                  out of range or memory allocation fails
+ */
+RC initAccessRing (BM_BufferPool *const bm, BM_AccessRing *const ring, const int numFrames) {
+    if (bm == NULL || bm->mgmtData == NULL || ring == NULL ||
+        numFrames < 1 || numFrames >= POOL_DATA(bm)->numFrames) {
+        return RC_BP_INIT_ERROR;
     }
 
-    // Free slot found
-    if (freeSlotIndex != -1) {
-        lockLatchForRead(&(frames->pageLatches[freeSlotIndex]));
-        // Read page from disk into the selected frame
-        SM_FileHandle fHandle;
-        openPageFile(bm->pageFile, &fHandle);
-        ensureCapacity(pageNum, &fHandle);
-        readBlock(pageNum, &fHandle, frames[freeSlotIndex].memPage);
-        closePageFile(&fHandle);
-        releaseLatchAfterRead(&(frames->pageLatches[freeSlotIndex]));
+    BM_PoolData *poolData = POOL_DATA(bm);
+    BM_RingData *ringData = calloc(1, sizeof(BM_RingData));
+    if (ringData == NULL) {
+        return RC_BP_INIT_ERROR;
+    }
+    ringData->frames = malloc(sizeof(int) * numFrames);
+    if (ringData->frames == NULL) {
+        free(ringData);
+        return RC_BP_INIT_ERROR;
+    }
+    ringData->numFrames = numFrames;
 
-        readFromDisk++;
+    pthread_mutex_lock(&poolData->poolMutex);
+    ringData->id = ++poolData->lastRingId;
+    pthread_mutex_unlock(&poolData->poolMutex);
 
-        // Update frame details
-        frames[freeSlotIndex].fix_cnt = 1;
-        frames[freeSlotIndex].pageNumber = pageNum;
-        page->pageNum = pageNum;
-        page->data = frames[freeSlotIndex].memPage;
+    ring->numFrames = numFrames;
+    ring->mgmtData = ringData;
+    return RC_OK;
+}
 
-        return RC_OK;
+/*
+ * Shuts an access ring down. Its unpinned clean pages are dropped and their
+ * frames freed, the pages still pinned or dirty are handed over to the
+ * strategy. A ring must be shut down before its buffer pool.
+ *
+ * @param bm   Buffer pool containing information about the buffer pool
+ * @param ring Access ring to shut down
+ * @return     RC_OK on success, or RC_BP_SHUNTDOWN_ERROR if the ring is not set up
+ */
+RC shutdownAccessRing (BM_BufferPool *const bm, BM_AccessRing *const ring) {
+    if (bm == NULL || bm->mgmtData == NULL || ring == NULL || ring->mgmtData == NULL) {
+        return RC_BP_SHUNTDOWN_ERROR;
     }
 
-    // No free slot found, call the appropriate replacement strategy function
-    switch (bm->strategy) {
-        case RS_FIFO:
-            return FIFO(bm, page, pageNum);
-        case RS_LRU:
-            return LRU(bm, page, pageNum);
-        case RS_LRU_K:
-            return LRU_K(bm, page, pageNum);
-        default:
-            return RC_BP_PIN_ERROR;
+    BM_PoolData *poolData = POOL_DATA(bm);
+    BM_RingData *ringData = ring->mgmtData;
+    Frames *frames = poolData->frames;
+
+    pthread_mutex_lock(&poolData->poolMutex);
+    dropPrefetches(poolData, -1, ringData);
+    pthread_mutex_unlock(&poolData->poolMutex);
+
+    for (int i = 0; i < ringData->count; i++) {
+        int index = ringData->frames[i];
+
+        // Find the page's stripe first, it has to be locked before the pool mutex
+        pthread_mutex_lock(&poolData->poolMutex);
+        int fileId = frames[index].fileId;
+        PageNumber pageNum = frames[index].pageNumber;
+        bool inRing = (frames[index].ringId == ringData->id);
+        pthread_mutex_unlock(&poolData->poolMutex);
+        if (!inRing) {
+            continue;
+        }
+
+        PageTableStripe *stripe = pageStripe(poolData, fileId, pageNum);
+        pthread_mutex_lock(&stripe->lock);
+        pthread_mutex_lock(&poolData->poolMutex);
+        if (frames[index].ringId == ringData->id) {
+            if (frames[index].fileId == fileId && frames[index].pageNumber == pageNum &&
+                frames[index].fix_cnt == 0 && !frames[index].dirty && !frames[index].ioInProgress) {
+                unmapFrame(poolData, index);
+                frames[index].lruOrder = 0;
+                frames[index].referenced = false;
+                frames[index].ringId = 0;
+                poolData->freeFrames[poolData->numFreeFrames++] = index;
+                signalFrameFreed(poolData);
+            } else {
+                ringAdopt(poolData, index);
+            }
+        }
+        pthread_mutex_unlock(&poolData->poolMutex);
+        pthread_mutex_unlock(&stripe->lock);
+    }
+
+    free(ringData->frames);
+    free(ringData);
+    ring->mgmtData = NULL;
+    return RC_OK;
+}
+
+/*
+ * Pins a page through an access ring. On a miss the page is read into a
+ * frame of the ring; a hit on a page of the strategy counts as usual.
+ *
+ * @param bm      Buffer pool containing information about the buffer pool
+ * @param ring    Access ring the page is read into
+ * @param page    Pointer to the page handle structure to store information about the pinned page
+ * @param pageNum Page number to be pinned
+ * @return        RC_OK on success, or an error code otherwise
+ */
+RC pinPageInRing (BM_BufferPool *const bm, BM_AccessRing *const ring, BM_PageHandle *const page,
+                  const PageNumber pageNum) {
+    if (ring == NULL || ring->mgmtData == NULL) {
+        return RC_BP_PIN_ERROR;
+    }
+
+    RC rc = loadPage(bm, page, pageNum, false, ring->mgmtData);
+    if (rc == RC_OK && POOL_DATA(bm)->readaheadPages > 0) {
+        readAhead(bm, pageNum, ring->mgmtData);
+    }
+    return rc;
+}
+
+/*
+ * Like prefetchPages, but the pages are read into frames of an access ring.
+ *
+ * @param bm       Buffer pool containing information about the buffer pool
+ * @param ring     Access ring the pages are read into
+ * @param pageNums Pages to load, most urgent first
+ * @param numPages Number of entries in pageNums
+ * @return         RC_OK on success, or RC_BP_PIN_ERROR if the arguments are
+ *                 invalid or the prefetcher cannot be started
+ */
+RC prefetchPagesInRing (BM_BufferPool *const bm, BM_AccessRing *const ring,
+                        const PageNumber *pageNums, int numPages) {
+    if (ring == NULL || ring->mgmtData == NULL) {
+        return RC_BP_PIN_ERROR;
     }
+    return queuePrefetches(bm, pageNums, numPages, ring->mgmtData);
 }
 
 
 // Statistics Interface
 /*
  * Retrieves the page numbers stored in each frame of the buffer pool.
+ * Frames of a shared pool that hold another file's pages read as NO_PAGE.
  *
  * @param bm Buffer pool containing information about the buffer pool
  * @return   An array containing the page numbers stored in each frame,
  *           or NULL if memory allocation fails
  */
 PageNumber *getFrameContents (BM_BufferPool *const bm) {
-    Frames *frames = (Frames *)bm->mgmtData;
+    Frames *frames = POOL_FRAMES(bm);
+    int fileId = POOL_FILE_ID(bm);
     int numPages = bm->numPages;
     PageNumber *contents = malloc(sizeof(PageNumber) * numPages);
 
@@ -648,16 +3843,21 @@ PageNumber *getFrameContents (BM_BufferPool *const bm) {
         return NULL;
     }
 
+    // Frames the background writer holds would show an extra fix count
+    lockWholePool(POOL_DATA(bm));
+    waitForBackgroundWrites(POOL_DATA(bm));
+
     // Iterate over all page frames
     for (int i = 0; i < numPages; i++) {
         // If the frame is empty, assign NO_PAGE
-        if (frames[i].pageNumber == NO_PAGE) {
+        if (frames[i].pageNumber == NO_PAGE || frames[i].fileId != fileId) {
             contents[i] = NO_PAGE;
         } else {
             // Otherwise, assign the page number stored in the frame
             contents[i] = frames[i].pageNumber;
         }
     }
+    unlockWholePool(POOL_DATA(bm));
 
     return contents;
 }
@@ -672,20 +3872,30 @@ PageNumber *getFrameContents (BM_BufferPool *const bm) {
  *           or NULL if memory allocation fails
  */
 bool *getDirtyFlags (BM_BufferPool *const bm) {
-    Frames *frames = (Frames *)bm->mgmtData;
+    Frames *frames = POOL_FRAMES(bm);
+    int fileId = POOL_FILE_ID(bm);
     int numPages = bm->numPages;
     bool *dirtyFlags = malloc(sizeof(bool) * numPages);
 
+    if (dirtyFlags == NULL) {
+        return NULL;
+    }
+
+    // Frames the background writer holds would show an extra fix count
+    lockWholePool(POOL_DATA(bm));
+    waitForBackgroundWrites(POOL_DATA(bm));
+
     // Iterate over all page frames
     for (int i = 0; i < numPages; i++) {
         // If the frame is empty, it's considered clean
-        if (frames[i].pageNumber == NO_PAGE) {
+        if (frames[i].pageNumber == NO_PAGE || frames[i].fileId != fileId) {
             dirtyFlags[i] = false;
         } else {
             // Otherwise, get the dirty flag of the page
             dirtyFlags[i] = frames[i].dirty;
         }
     }
+    unlockWholePool(POOL_DATA(bm));
     return dirtyFlags;
 }
 
@@ -698,20 +3908,30 @@ bool *getDirtyFlags (BM_BufferPool *const bm) {
  *           or NULL if memory allocation fails
  */
 int *getFixCounts (BM_BufferPool *const bm) {
-    Frames *frames = (Frames *)bm->mgmtData;
+    Frames *frames = POOL_FRAMES(bm);
+    int fileId = POOL_FILE_ID(bm);
     int numPages = bm->numPages;
-    int *fixCounts = malloc(sizeof(bool) * numPages);
+    int *fixCounts = malloc(sizeof(int) * numPages);
+
+    if (fixCounts == NULL) {
+        return NULL;
+    }
+
+    // Frames the background writer holds would show an extra fix count
+    lockWholePool(POOL_DATA(bm));
+    waitForBackgroundWrites(POOL_DATA(bm));
 
     // Iterate over all page frames
     for (int i = 0; i < numPages; i++) {
         // If the frame is empty, it's considered clean
-        if (frames[i].pageNumber == NO_PAGE) {
-            fixCounts[i] = false;
+        if (frames[i].pageNumber == NO_PAGE || frames[i].fileId != fileId) {
+            fixCounts[i] = 0;
         } else {
             // Otherwise, get the dirty flag of the page
             fixCounts[i] = frames[i].fix_cnt;
         }
     }
+    unlockWholePool(POOL_DATA(bm));
     return fixCounts;
 }
 
@@ -722,7 +3942,10 @@ int *getFixCounts (BM_BufferPool *const bm) {
  * @return   The total number of read operations performed on the buffer pool
  */
 int getNumReadIO (BM_BufferPool *const bm) {
-    return (readFromDisk + 1);
+    pthread_mutex_lock(&POOL_DATA(bm)->poolMutex);
+    int reads = POOL_DATA(bm)->files[POOL_FILE_ID(bm)].readFromDisk;
+    pthread_mutex_unlock(&POOL_DATA(bm)->poolMutex);
+    return (reads + 1);
 }
 
 /*
@@ -732,5 +3955,60 @@ int getNumReadIO (BM_BufferPool *const bm) {
  * @return   The total number of write operations performed on the buffer pool
  */
 int getNumWriteIO (BM_BufferPool *const bm) {
-    return writtenToDisk;
-}
\ No newline at end of file
+    pthread_mutex_lock(&POOL_DATA(bm)->poolMutex);
+    int writes = POOL_DATA(bm)->files[POOL_FILE_ID(bm)].writtenToDisk;
+    pthread_mutex_unlock(&POOL_DATA(bm)->poolMutex);
+    return writes;
+}
+
+/*
+ * Retrieves the number of dirty pages that had to be written back by the pin
+ * evicting them rather than by the background writer. Counted for the whole
+ * pool, not per file.
+ *
+ * @param bm Buffer pool containing information about the buffer pool
+ * @return   The number of dirty evictions
+ */
+int getNumDirtyEvictions (BM_BufferPool *const bm) {
+    return (int) atomic_load_explicit(&POOL_DATA(bm)->counters->dirtyEvictions, memory_order_relaxed);
+}
+
+/*
+ * Retrieves the number of pins that found every frame pinned and waited
+ * for an unpin, whether or not one came in time. Counted for the whole pool.
+ *
+ * @param bm Buffer pool containing information about the buffer pool
+ * @return   The number of pin waits
+ */
+int getNumPinWaits (BM_BufferPool *const bm) {
+    return (int) atomic_load_explicit(&POOL_DATA(bm)->counters->pinWaits, memory_order_relaxed);
+}
+
+/*
+ * Takes a snapshot of the pool's counters: pin hits and misses, evictions,
+ * pin waits, and histograms of read and write latencies. It neither locks
+ * nor allocates, so a monitoring thread may poll it while the pool works;
+ * each counter is read on its own, so the snapshot is not one instant.
+ * Counted for the whole pool, not per file.
+ *
+ * @param bm    Buffer pool containing information about the buffer pool
+ * @param stats Receives the counters
+ * @return      RC_OK, or RC_INVALID_INPUT if the pool is not initialized
+ */
+RC getPoolStats (BM_BufferPool *const bm, BM_Stats *const stats) {
+    if (bm == NULL || bm->mgmtData == NULL || stats == NULL) {
+        return RC_INVALID_INPUT;
+    }
+
+    BM_PoolCounters *counters = POOL_DATA(bm)->counters;
+    stats->hits = atomic_load_explicit(&counters->hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&counters->misses, memory_order_relaxed);
+    stats->evictions = atomic_load_explicit(&counters->evictions, memory_order_relaxed);
+    stats->dirtyEvictions = atomic_load_explicit(&counters->dirtyEvictions, memory_order_relaxed);
+    stats->pinWaits = atomic_load_explicit(&counters->pinWaits, memory_order_relaxed);
+    for (int i = 0; i < BM_LATENCY_BUCKETS; i++) {
+        stats->readLatency[i] = atomic_load_explicit(&counters->readLatency[i], memory_order_relaxed);
+        stats->writeLatency[i] = atomic_load_explicit(&counters->writeLatency[i], memory_order_relaxed);
+    }
+    return RC_OK;
+}
@@ -13,32 +13,102 @@
 #include <time.h>
 #include <pthread.h>
 
-extern pthread_mutex_t buffer_pool_init_mutex;
-extern pthread_cond_t buffer_pool_cond;
-extern int active_threads;
-extern bool buffer_pool_shutting_down;
-
 // Replacement Strategies
 typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5
 } ReplacementStrategy;
 
+// LRU-K: pins of a page at most this many pins apart count as one reference
+#ifndef LRU_K_CORRELATED_PERIOD
+#define LRU_K_CORRELATED_PERIOD 2
+#endif
+
+// LRU-K: pins for which the history of an evicted page is kept
+#ifndef LRU_K_RETAINED_PERIOD
+#define LRU_K_RETAINED_PERIOD 1024
+#endif
+
+// Number of independently locked parts of the page table, a power of two
+#ifndef BM_PAGE_TABLE_STRIPES
+#define BM_PAGE_TABLE_STRIPES 64
+#endif
+
+// Frame memory: one arena aligned for direct I/O, and frame bookkeeping on cache lines of its own
+#ifndef BM_FRAME_ALIGNMENT
+#define BM_FRAME_ALIGNMENT 4096
+#endif
+#ifndef BM_CACHE_LINE_SIZE
+#define BM_CACHE_LINE_SIZE 64
+#endif
+#ifndef BM_HUGE_PAGE_SIZE
+#define BM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+// Prefetching: requests a pool queues before dropping new ones, and how many
+// pins of consecutive pages make a run that starts readahead
+#ifndef BM_PREFETCH_QUEUE_SIZE
+#define BM_PREFETCH_QUEUE_SIZE 256
+#endif
+#ifndef BM_READAHEAD_TRIGGER
+#define BM_READAHEAD_TRIGGER 2
+#endif
+
+// Prefetch batches: the most pages one read of a run of consecutive pages
+// covers, and the most pages the prefetcher takes off its queue at once
+#ifndef BM_READ_RUN_PAGES
+#define BM_READ_RUN_PAGES 32
+#endif
+#ifndef BM_PREFETCH_BATCH_PAGES
+#define BM_PREFETCH_BATCH_PAGES 128
+#endif
+
+// Reads the prefetcher and writes the background writer each keep in flight
+#ifndef BM_IO_DEPTH
+#define BM_IO_DEPTH 32
+#endif
+
+// Statistics: buckets of the I/O latency histograms. Bucket i counts the I/Os
+// that took from 2^i up to 2^(i+1) nanoseconds, the last one all longer ones
+#ifndef BM_LATENCY_BUCKETS
+#define BM_LATENCY_BUCKETS 32
+#endif
+
+// Warm restart: the manifest of a page file is kept next to it, named after it with this suffix
+#ifndef BM_MANIFEST_SUFFIX
+#define BM_MANIFEST_SUFFIX ".manifest"
+#endif
+
+// Background writer: how often it wakes up to clean pages
+#ifndef BM_WRITER_INTERVAL_MS
+#define BM_WRITER_INTERVAL_MS 10
+#endif
+
 // Data Types and Structures
 typedef int PageNumber;
 #define NO_PAGE -1
 
 typedef struct Frames {
+    int fileId; // page file of the page, frames of a shared pool hold pages of many files
     PageNumber pageNumber;
-    SM_PageHandle memPage;
-    bool dirty;
-    int fix_cnt;
+    SM_PageHandle memPage; // this frame's slice of the pool's arena, one page size long
+    _Atomic bool dirty;
+    _Atomic int fix_cnt; // raised under the lock of the page's page table stripe, or by the background writer under the pool mutex
+    _Atomic bool ioInProgress; // set while a pin reads the page in or writes the old one out
     int lruOrder;
-    Latch *pageLatches;
-} Frames;
+    _Atomic bool referenced; // CLOCK reference bit, set on every pin
+    int frequency; // LFU use count, halved when the pool ages
+    int heapIndex; // position in the victim heap, or LRU-K's heap of pages inside their correlated period; -1 while pinned or empty
+    bool inPeriodHeap; // heapIndex refers to LRU-K's correlated period heap
+    int lruPrev; // neighbours in the LRU list, -1 at either end
+    int lruNext;
+    _Atomic int ringId; // access ring recycling the frame, 0 while the strategy manages it
+    Latch latch; // held while the frame is read from or written to disk
+} __attribute__((aligned(BM_CACHE_LINE_SIZE))) Frames;
 
 typedef struct BM_BufferPool {
 	char *pageFile;
@@ -54,6 +124,36 @@ typedef struct BM_PageHandle {
 	char *data;
 } BM_PageHandle;
 
+// Optional pool settings, zero fields keep the defaults
+typedef struct BM_PoolOptions {
+    double writerCleanRatio; // share of the frames nearest eviction the background writer keeps clean, 0 disables it
+    int writerPagesPerSecond; // background write rate limit, 0 for no limit
+    int pinWaitMillis; // how long a pin waits for an unpin while every frame is pinned, 0 fails at once
+    bool hugePages; // map the frame arena and ask for transparent huge pages if it spans one
+    int readaheadPages; // pages loaded ahead of a run of sequential pins, 0 disables readahead
+    bool warmRestart; // keep a manifest of each file's hottest pages on shutdown and load them back on init
+    int pageSize; // frame size of the shared pool, 0 for PAGE_SIZE; a private pool takes its file's page size
+    bool mapFiles; // map the page files and point frames at their pages instead of copying them; forcing becomes msync
+    bool directIO; // read and write the page files with O_DIRECT so pages are cached once, not also by the kernel
+} BM_PoolOptions;
+
+// Access ring: a few frames a bulk reader such as a table scan recycles for
+// the pages it reads, so they do not push other pages out of the pool
+typedef struct BM_AccessRing {
+    int numFrames;
+    void *mgmtData; // bookkeeping of the buffer manager, NULL once shut down
+} BM_AccessRing;
+
+// Counters of a pool as taken by getPoolStats; a shared pool counts for all its files
+typedef struct BM_Stats {
+    uint64_t hits; // pins that found their page in the pool
+    uint64_t misses; // pins that read their page from disk
+    uint64_t evictions; // pages replaced by another
+    uint64_t dirtyEvictions; // evicted pages the pin had to write back itself
+    uint64_t pinWaits; // pins that found every frame pinned and waited for an unpin
+    uint64_t readLatency[BM_LATENCY_BUCKETS]; // page reads, including prefetches
+    uint64_t writeLatency[BM_LATENCY_BUCKETS]; // writes, a run of pages flushed at once counts as one
+} BM_Stats;
 
 // convenience macros
 #define MAKE_POOL()					\
@@ -66,12 +166,29 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
+// Shared Buffer Pool: while it runs, initBufferPool attaches to it instead of
+// allocating frames, and all open files share one memory budget
+RC initSharedBufferPool(const size_t memoryLimit, ReplacementStrategy strategy,
+		void *stratData);
+RC initSharedBufferPoolWithOptions(const size_t memoryLimit, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *options);
+RC shutdownSharedBufferPool(void);
+
+// Warm restart: removes the manifest kept for a page file, if there is one
+RC destroyPoolManifest(const char *const pageFileName);
+
 // Replacement Strategies Functions
 RC FIFO (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
 RC LRU (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC CLOCK (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC LFU (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC ARC (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
 RC LRU_K (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
 
 // Buffer Manager Interface Access Pages
@@ -80,6 +197,16 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pageNums, int numPages);
+
+// Access Rings: pages pinned or prefetched through a ring and pinned by
+// nobody else are recycled within the ring and never enter the strategy
+RC initAccessRing (BM_BufferPool *const bm, BM_AccessRing *const ring, const int numFrames);
+RC shutdownAccessRing (BM_BufferPool *const bm, BM_AccessRing *const ring);
+RC pinPageInRing (BM_BufferPool *const bm, BM_AccessRing *const ring, BM_PageHandle *const page,
+		const PageNumber pageNum);
+RC prefetchPagesInRing (BM_BufferPool *const bm, BM_AccessRing *const ring,
+		const PageNumber *pageNums, int numPages);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -87,6 +214,9 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumDirtyEvictions (BM_BufferPool *const bm);
+int getNumPinWaits (BM_BufferPool *const bm);
+RC getPoolStats (BM_BufferPool *const bm, BM_Stats *const stats);
 
 
 #endif
@@ -33,6 +33,8 @@ typedef int RC;
 #define RC_MEMORY_ALLOCATION_ERROR 21
 #define RC_NO_FREE_SLOT_FOUND 22
 #define RC_UNEXPECTED_ACTION 25
+#define RC_IO_QUEUE_FULL 26
+#define RC_IO_QUEUE_FAILED 27
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
@@ -4,6 +4,15 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "trace.h"
 
 // define bool if not defined
 #ifndef bool
@@ -15,69 +24,121 @@
 #define TRUE true
 #define FALSE false
 
-// typedef Structure to represent a latch
+// Latch protecting a buffer frame. Writers take it exclusively: a short spin,
+// then a futex park until the holder wakes them. Readers that can retry use
+// the version instead, which is odd while a writer holds the latch, and
+// never write to the latch themselves.
 typedef struct {
-    pthread_rwlock_t lock;   // Read-write lock
+    _Atomic uint32_t state;   // 0 free, 1 held, 2 held with parked waiters
+    _Atomic uint32_t version; // bumped on every exclusive acquire and release
 } Latch;
 
+// Attempts at the latch before parking the thread
+#ifndef LATCH_SPIN_COUNT
+#define LATCH_SPIN_COUNT 100
+#endif
+
 // Function declarations and definitions
 
+static inline void latchPause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline void latchWait(_Atomic uint32_t *addr, uint32_t value) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *) addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+    (void) addr;
+    (void) value;
+    sched_yield();
+#endif
+}
+
+static inline void latchWake(_Atomic uint32_t *addr) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *) addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void) addr;
+#endif
+}
+
 // Create and Destroy Latch Function
 static inline void createLatch(Latch *latch) {
-    pthread_rwlock_init(&latch->lock, NULL);
+    atomic_init(&latch->state, 0);
+    atomic_init(&latch->version, 0);
 }
 
 static inline void destroyLatch(Latch *latch) {
-    pthread_rwlock_destroy(&latch->lock);
+    (void) latch;
 }
 
 // Acquiring
 
-// Acquire the latch for reading
-static inline void lockLatchForRead(Latch *latch) {
-    if (latch == NULL) {
-        fprintf(stderr, "Error: Null latch pointer at location %p\n", (void *)latch);
-        return;
-    }
-    printf("Locking latch for read operation at location %p\n", (void *)latch);
-    int result = pthread_rwlock_rdlock(&latch->lock);
-    if (result != 0) {
-        fprintf(stderr, "Failed to acquire read lock: error code %d\n", result);
-    }
-}
-
-// Acquire the latch for writing
+// Acquire the latch exclusively, for writing the frame or filling it
 static inline void lockLatchForWrite(Latch *latch) {
     if (latch == NULL) {
-        fprintf(stderr, "Error: Null latch pointer at location %p\n", (void *)latch);
+        LOG_ERROR("Error: Null latch pointer at location %p\n", (void *)latch);
         return;
     }
-    printf("Locking latch for write operation at location %p\n", (void *)latch);
-    int result = pthread_rwlock_wrlock(&latch->lock);
-    if (result != 0) {
-        fprintf(stderr, "Failed to acquire write lock: error code %d\n", result);
+    LOG_TRACE("Locking latch for write operation at location %p\n", (void *)latch);
+
+    uint32_t expected = 0;
+    int spins = 0;
+    while (!atomic_compare_exchange_weak_explicit(&latch->state, &expected, 1,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+        if (++spins >= LATCH_SPIN_COUNT) {
+            // Park, marking the latch so the holder knows to wake someone
+            while (atomic_exchange_explicit(&latch->state, 2, memory_order_acquire) != 0) {
+                latchWait(&latch->state, 2);
+            }
+            break;
+        }
+        expected = 0;
+        latchPause();
     }
+
+    // Odd while held, so optimistic readers know to retry
+    atomic_store_explicit(&latch->version,
+                          atomic_load_explicit(&latch->version, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
 }
 
-// Releasing
+// Start an optimistic read: returns the version to validate against,
+// waiting while a writer holds the latch
+static inline uint32_t beginOptimisticRead(Latch *latch) {
+    uint32_t version;
+    int spins = 0;
 
-// Releasing latch after reading
-static inline void releaseLatchAfterRead(Latch *latch) {
-    printf("Releasing latch after reading at location %p\n", (void *)latch);
-    int unlockResult = pthread_rwlock_unlock(&latch->lock);
-    if (unlockResult != 0) {
-        printf("Failed to release latch\n");
-        printf("Error code: %d\n", unlockResult);
+    while ((version = atomic_load_explicit(&latch->version, memory_order_acquire)) & 1) {
+        if (++spins < LATCH_SPIN_COUNT) {
+            latchPause();
+        } else {
+            sched_yield();
+        }
     }
+    return version;
+}
+
+// Finish an optimistic read: true if no writer held the latch since
+// beginOptimisticRead, otherwise what was read must be discarded
+static inline bool validateOptimisticRead(Latch *latch, uint32_t version) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&latch->version, memory_order_relaxed) == version;
 }
 
+// Releasing
+
 // Releasing latch after writing
 static inline void releaseLatchAfterWrite(Latch *latch) {
-    printf("Releasing latch after writing at location %p\n", (void *)latch);
-    int unlockResult = pthread_rwlock_unlock(&latch->lock);
-    if (unlockResult != 0) {
-        printf("Failed to release latch\n");
-        printf("Error code: %d\n", unlockResult);
+    LOG_TRACE("Releasing latch after writing at location %p\n", (void *)latch);
+    atomic_store_explicit(&latch->version,
+                          atomic_load_explicit(&latch->version, memory_order_relaxed) + 1,
+                          memory_order_release);
+    if (atomic_exchange_explicit(&latch->state, 0, memory_order_release) == 2) {
+        latchWake(&latch->state);
     }
 }
 
@@ -1,4 +1,5 @@
 #include "storage_mgr.h"
+#include "trace.h"
 #include "buffer_mgr.h"
 #include "stdlib.h"
 #include <string.h>
@@ -11,6 +12,8 @@
  * These can be adjusted based on system requirements
  */
 #define BUFFER_PAGE_LIMIT 5
+#define SCAN_PREFETCH_PAGES 2
+#define SCAN_RING_FRAMES (SCAN_PREFETCH_PAGES + 2)
 #define INVALID_PAGE_NUM -1
 #define INVALID_SLOT_NUM -1
 #define DELETED_RECORD_MARKER 0xFD
@@ -23,7 +26,7 @@ static int computeRecordSize(Schema *schema);
 static int findFreePageIndex(RM_TableData *table);
 static int locateFreeSlot(char *pageData, int recordCount);
 static bool isValidRecordID(RID id, int totalPages);
-static void initPageDirectoryEntry(PageDirectoryEntry *entry, int pageId);
+static void initPageDirectoryEntry(PageDirectoryEntry *entry, int pageId, int pageSize);
 static RC savePageDirectoryToDisk(RM_TableData *table);
 static RC loadPageDirectoryFromDisk(RM_TableData *table);
 static void updatePageStatistics(RM_TableData *table, int pageIdx, int spaceChange, bool recordAdded);
@@ -39,17 +42,17 @@ static int ceilDivision(int numerator, int denominator);
  * Must be called before any other record manager functions
  */
 RC initRecordManager(void *customConfig) {
-    printf("Starting record manager initialization process...\n");
+    LOG_INFO("Starting record manager initialization process...\n");
     
     // Initialize the underlying storage manager
     initStorageManager();
     
     // We could use customConfig for advanced settings in future versions
     if (customConfig != NULL) {
-        printf("Custom configuration provided but not used in current implementation\n");
+        LOG_DEBUG("Custom configuration provided but not used in current implementation\n");
     }
     
-    printf("Record manager successfully initialized\n");
+    LOG_INFO("Record manager successfully initialized\n");
     return RC_OK;
 }
 
@@ -58,12 +61,12 @@ RC initRecordManager(void *customConfig) {
  * Should be called when record manager is no longer needed
  */
 RC shutdownRecordManager() {
-    printf("Executing record manager shutdown sequence\n");
+    LOG_INFO("Executing record manager shutdown sequence\n");
     
     // In this implementation, we don't maintain global state
     // Future versions might need to clean up shared resources here
     
-    printf("Record manager shutdown completed successfully\n");
+    LOG_INFO("Record manager shutdown completed successfully\n");
     return RC_OK;
 }
 
@@ -76,18 +79,26 @@ RC shutdownRecordManager() {
  * This involves creating a page file and storing schema information
  */
 RC createTable(char *tableName, Schema *schema) {
-    printf("Creating new table '%s'...\n", tableName);
+    return createTableWithPageSize(tableName, schema, PAGE_SIZE);
+}
+
+/* 
+ * Creates a new table like createTable, with pages of the given size
+ * Larger pages hold more records each, so scans and inserts touch fewer pages
+ */
+RC createTableWithPageSize(char *tableName, Schema *schema, int pageSize) {
+    LOG_INFO("Creating new table '%s'...\n", tableName);
     
     // Validate input parameters
     if (!tableName || !schema) {
-        printf("Error: Table name or schema is NULL\n");
+        LOG_ERROR("Error: Table name or schema is NULL\n");
         return RC_INVALID_INPUT;
     }
     
     // Step 1: Create the underlying page file
-    RC status = createPageFile(tableName);
+    RC status = createPageFileWithPageSize(tableName, pageSize);
     if (status != RC_OK) {
-        printf("Error: Failed to create page file for table '%s'\n", tableName);
+        LOG_ERROR("Error: Failed to create page file for table '%s'\n", tableName);
         return status;
     }
     
@@ -95,12 +106,12 @@ RC createTable(char *tableName, Schema *schema) {
     SM_FileHandle fileHandle;
     status = openPageFile(tableName, &fileHandle);
     if (status != RC_OK) {
-        printf("Error: Failed to open page file for table '%s'\n", tableName);
+        LOG_ERROR("Error: Failed to open page file for table '%s'\n", tableName);
         return status;
     }
     
     // Step 3: Prepare the schema page (page 0)
-    char *schemaPage = calloc(1, PAGE_SIZE);
+    char *schemaPage = calloc(1, pageSize);
     if (!schemaPage) {
         closePageFile(&fileHandle);
         return RC_MEMORY_ALLOCATION_FAIL;
@@ -110,7 +121,7 @@ RC createTable(char *tableName, Schema *schema) {
     int position = 0;
     
     // Write number of attributes
-    if (position + sizeof(int) > PAGE_SIZE) {
+    if (position + sizeof(int) > pageSize) {
         free(schemaPage);
         closePageFile(&fileHandle);
         return RC_PAGE_FULL;
@@ -122,7 +133,7 @@ RC createTable(char *tableName, Schema *schema) {
     for (int i = 0; i < schema->numAttr; i++) {
         int nameLen = strlen(schema->attrNames[i]) + 1; // Include null terminator
         
-        if (position + nameLen > PAGE_SIZE) {
+        if (position + nameLen > pageSize) {
             free(schemaPage);
             closePageFile(&fileHandle);
             return RC_PAGE_FULL;
@@ -134,7 +145,7 @@ RC createTable(char *tableName, Schema *schema) {
     
     // Write data types
     int dataTypesSize = schema->numAttr * sizeof(DataType);
-    if (position + dataTypesSize > PAGE_SIZE) {
+    if (position + dataTypesSize > pageSize) {
         free(schemaPage);
         closePageFile(&fileHandle);
         return RC_PAGE_FULL;
@@ -144,7 +155,7 @@ RC createTable(char *tableName, Schema *schema) {
     
     // Write type lengths
     int typeLengthsSize = schema->numAttr * sizeof(int);
-    if (position + typeLengthsSize > PAGE_SIZE) {
+    if (position + typeLengthsSize > pageSize) {
         free(schemaPage);
         closePageFile(&fileHandle);
         return RC_PAGE_FULL;
@@ -153,7 +164,7 @@ RC createTable(char *tableName, Schema *schema) {
     position += typeLengthsSize;
     
     // Write key information
-    if (position + sizeof(int) + (schema->keySize * sizeof(int)) > PAGE_SIZE) {
+    if (position + sizeof(int) + (schema->keySize * sizeof(int)) > pageSize) {
         free(schemaPage);
         closePageFile(&fileHandle);
         return RC_PAGE_FULL;
@@ -175,7 +186,7 @@ RC createTable(char *tableName, Schema *schema) {
     }
     
     // Step 6: Initialize page directory (page 1)
-    char *directoryPage = calloc(1, PAGE_SIZE);
+    char *directoryPage = calloc(1, pageSize);
     if (!directoryPage) {
         closePageFile(&fileHandle);
         return RC_MEMORY_ALLOCATION_FAIL;
@@ -195,7 +206,7 @@ RC createTable(char *tableName, Schema *schema) {
     
     // Initialize first page entry
     PageDirectoryEntry firstPage;
-    initPageDirectoryEntry(&firstPage, 0);
+    initPageDirectoryEntry(&firstPage, 0, pageSize);
     
     // Write the entry
     memcpy(directoryPage + position, &firstPage, sizeof(PageDirectoryEntry));
@@ -215,17 +226,17 @@ RC createTable(char *tableName, Schema *schema) {
         return status;
     }
     
-    printf("Table '%s' created successfully\n", tableName);
+    LOG_INFO("Table '%s' created successfully\n", tableName);
     return RC_OK;
 }
 
 /* 
  * Helper function to initialize a page directory entry
  */
-static void initPageDirectoryEntry(PageDirectoryEntry *entry, int pageId) {
+static void initPageDirectoryEntry(PageDirectoryEntry *entry, int pageId, int pageSize) {
     entry->pageID = pageId;
     entry->hasFreeSlot = true;
-    entry->freeSpace = PAGE_SIZE;
+    entry->freeSpace = pageSize;
     entry->recordCount = 0;
 }
 
@@ -234,11 +245,11 @@ static void initPageDirectoryEntry(PageDirectoryEntry *entry, int pageId) {
  * This involves reading schema information and page directory
  */
 RC openTable(RM_TableData *rel, char *tableName) {
-    printf("Opening table '%s'...\n", tableName);
+    LOG_INFO("Opening table '%s'...\n", tableName);
     
     // Validate input parameters
     if (!rel || !tableName) {
-        printf("Error: Invalid table data or name\n");
+        LOG_ERROR("Error: Invalid table data or name\n");
         return RC_INVALID_INPUT;
     }
     
@@ -246,14 +257,14 @@ RC openTable(RM_TableData *rel, char *tableName) {
     rel->name = tableName;
     rel->schema = malloc(sizeof(Schema));
     if (!rel->schema) {
-        printf("Error: Failed to allocate memory for schema\n");
+        LOG_ERROR("Error: Failed to allocate memory for schema\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
     rel->managementData = malloc(sizeof(RM_managementData));
     if (!rel->managementData) {
         free(rel->schema);
-        printf("Error: Failed to allocate memory for management data\n");
+        LOG_ERROR("Error: Failed to allocate memory for management data\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -264,17 +275,20 @@ RC openTable(RM_TableData *rel, char *tableName) {
     if (status != RC_OK) {
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to open page file for table '%s'\n", tableName);
+        LOG_ERROR("Error: Failed to open page file for table '%s'\n", tableName);
         return status;
     }
+    mgmtData->pageSize = mgmtData->fileHndl.pageSize;
     
-    // Step 3: Initialize buffer pool
-    status = initBufferPool(&mgmtData->bm, tableName, BUFFER_PAGE_LIMIT, RS_LRU, NULL);
+    // Step 3: Initialize buffer pool, reloading the pages that were hot when the table was closed
+    BM_PoolOptions options = {0};
+    options.warmRestart = true;
+    status = initBufferPoolWithOptions(&mgmtData->bm, tableName, BUFFER_PAGE_LIMIT, RS_LRU, NULL, &options);
     if (status != RC_OK) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to initialize buffer pool\n");
+        LOG_ERROR("Error: Failed to initialize buffer pool\n");
         return status;
     }
     
@@ -285,23 +299,23 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to pin schema page\n");
+        LOG_ERROR("Error: Failed to pin schema page\n");
         return status;
     }
     
     // Copy schema data to memory
-    char *schemaData = malloc(PAGE_SIZE);
+    char *schemaData = malloc(mgmtData->pageSize);
     if (!schemaData) {
         unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
         shutdownBufferPool(&mgmtData->bm);
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to allocate memory for schema data\n");
+        LOG_ERROR("Error: Failed to allocate memory for schema data\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
-    memcpy(schemaData, mgmtData->pageHndlBM.data, PAGE_SIZE);
+    memcpy(schemaData, mgmtData->pageHndlBM.data, mgmtData->pageSize);
     
     // Unpin the schema page
     status = unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
@@ -311,7 +325,7 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to unpin schema page\n");
+        LOG_ERROR("Error: Failed to unpin schema page\n");
         return status;
     }
     
@@ -330,7 +344,7 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to allocate memory for attribute names\n");
+        LOG_ERROR("Error: Failed to allocate memory for attribute names\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -352,7 +366,7 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to allocate memory for data types\n");
+        LOG_ERROR("Error: Failed to allocate memory for data types\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -373,7 +387,7 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to allocate memory for type lengths\n");
+        LOG_ERROR("Error: Failed to allocate memory for type lengths\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -399,7 +413,7 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to allocate memory for key attributes\n");
+        LOG_ERROR("Error: Failed to allocate memory for key attributes\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -423,11 +437,11 @@ RC openTable(RM_TableData *rel, char *tableName) {
         closePageFile(&mgmtData->fileHndl);
         free(rel->schema);
         free(rel->managementData);
-        printf("Error: Failed to load page directory\n");
+        LOG_ERROR("Error: Failed to load page directory\n");
         return status;
     }
     
-    printf("Table '%s' opened successfully\n", tableName);
+    LOG_INFO("Table '%s' opened successfully\n", tableName);
     return RC_OK;
 }
 
@@ -444,13 +458,13 @@ static RC loadPageDirectoryFromDisk(RM_TableData *table) {
     }
     
     // Copy directory data to memory
-    char *directoryData = malloc(PAGE_SIZE);
+    char *directoryData = malloc(mgmtData->pageSize);
     if (!directoryData) {
         unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
-    memcpy(directoryData, mgmtData->pageHndlBM.data, PAGE_SIZE);
+    memcpy(directoryData, mgmtData->pageHndlBM.data, mgmtData->pageSize);
     
     // Unpin the directory page
     status = unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
@@ -495,10 +509,10 @@ static RC savePageDirectoryToDisk(RM_TableData *table) {
     RM_managementData *mgmtData = (RM_managementData *)table->managementData;
     
     // Calculate max entries per directory page
-    int maxEntriesPerPage = (PAGE_SIZE - 2 * sizeof(int)) / sizeof(PageDirectoryEntry);
+    int maxEntriesPerPage = (mgmtData->pageSize - 2 * sizeof(int)) / sizeof(PageDirectoryEntry);
     
     // Allocate memory for directory page
-    char *directoryPage = calloc(1, PAGE_SIZE);
+    char *directoryPage = calloc(1, mgmtData->pageSize);
     if (!directoryPage) {
         return RC_MEMORY_ALLOCATION_FAIL;
     }
@@ -533,11 +547,11 @@ static RC savePageDirectoryToDisk(RM_TableData *table) {
  * Closes a table and frees all associated resources
  */
 RC closeTable(RM_TableData *rel) {
-    printf("Closing table '%s'...\n", rel->name);
+    LOG_INFO("Closing table '%s'...\n", rel->name);
     
     // Validate input parameters
     if (!rel || !rel->managementData || !rel->schema) {
-        printf("Warning: Table already closed or invalid\n");
+        LOG_WARN("Warning: Table already closed or invalid\n");
         return RC_OK;
     }
     
@@ -575,21 +589,21 @@ RC closeTable(RM_TableData *rel) {
     // Step 3: Shutdown buffer pool
     RC status = shutdownBufferPool(&mgmtData->bm);
     if (status != RC_OK) {
-        printf("Warning: Failed to shutdown buffer pool\n");
+        LOG_WARN("Warning: Failed to shutdown buffer pool\n");
         // Continue with cleanup despite error
     }
     
     // Step 4: Close page file
     status = closePageFile(&mgmtData->fileHndl);
     if (status != RC_OK) {
-        printf("Warning: Failed to close page file\n");
+        LOG_WARN("Warning: Failed to close page file\n");
         // Continue with cleanup despite error
     }
     
     // Step 5: Free management data
     free(rel->managementData);
     
-    printf("Table closed successfully\n");
+    LOG_INFO("Table closed successfully\n");
     return RC_OK;
 }
 
@@ -597,22 +611,29 @@ RC closeTable(RM_TableData *rel) {
  * Deletes a table by removing its underlying page file
  */
 RC deleteTable(char *tableName) {
-    printf("Deleting table '%s'...\n", tableName);
+    LOG_INFO("Deleting table '%s'...\n", tableName);
     
     // Validate input parameters
     if (!tableName) {
-        printf("Error: Invalid table name\n");
+        LOG_ERROR("Error: Invalid table name\n");
         return RC_INVALID_NAME;
     }
     
     // Delete the page file
     RC status = destroyPageFile(tableName);
     if (status != RC_OK) {
-        printf("Error: Failed to delete page file for table '%s'\n", tableName);
+        LOG_ERROR("Error: Failed to delete page file for table '%s'\n", tableName);
+        return status;
+    }
+
+    // The buffer pool's manifest of the table's hot pages goes with it
+    status = destroyPoolManifest(tableName);
+    if (status != RC_OK) {
+        LOG_ERROR("Error: Failed to delete the buffer pool manifest of table '%s'\n", tableName);
         return status;
     }
     
-    printf("Table '%s' deleted successfully\n", tableName);
+    LOG_INFO("Table '%s' deleted successfully\n", tableName);
     return RC_OK;
 }
 
@@ -644,11 +665,11 @@ int getNumTuples(RM_TableData *rel) {
  * Inserts a new record into the table
  */
 RC insertRecord(RM_TableData *rel, Record *record) {
-    printf("Inserting record into table '%s'...\n", rel->name);
+    LOG_TRACE("Inserting record into table '%s'...\n", rel->name);
     
     // Validate input parameters
     if (!rel || !rel->managementData || !record) {
-        printf("Error: Invalid table or record\n");
+        LOG_ERROR("Error: Invalid table or record\n");
         return RC_INVALID_INPUT;
     }
     
@@ -658,7 +679,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     int recordSize = computeRecordSize(rel->schema);
     
     // Calculate max entries per directory page
-    int maxEntriesPerPage = (PAGE_SIZE - 2 * sizeof(int)) / sizeof(PageDirectoryEntry);
+    int maxEntriesPerPage = (mgmtData->pageSize - 2 * sizeof(int)) / sizeof(PageDirectoryEntry);
     
     // Check if we need a new directory page
     bool needNewDirectory = mgmtData->numPages > maxEntriesPerPage * mgmtData->numPageDP;
@@ -668,9 +689,9 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         mgmtData->numPageDP++;
         
         // Create new directory page
-        char *newDirectoryPage = calloc(1, PAGE_SIZE);
+        char *newDirectoryPage = calloc(1, mgmtData->pageSize);
         if (!newDirectoryPage) {
-            printf("Error: Failed to allocate memory for new directory page\n");
+            LOG_ERROR("Error: Failed to allocate memory for new directory page\n");
             return RC_MEMORY_ALLOCATION_FAIL;
         }
         
@@ -678,7 +699,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         RC status = appendEmptyBlock(&mgmtData->fileHndl);
         if (status != RC_OK) {
             free(newDirectoryPage);
-            printf("Error: Failed to append new directory page\n");
+            LOG_ERROR("Error: Failed to append new directory page\n");
             return status;
         }
         
@@ -686,7 +707,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         free(newDirectoryPage);
         
         if (status != RC_OK) {
-            printf("Error: Failed to write new directory page\n");
+            LOG_ERROR("Error: Failed to write new directory page\n");
             return status;
         }
     }
@@ -707,19 +728,20 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         PageDirectoryEntry *newDirectory = realloc(mgmtData->pageDirectory, newSize);
         
         if (!newDirectory) {
-            printf("Error: Failed to resize page directory\n");
+            LOG_ERROR("Error: Failed to resize page directory\n");
             return RC_MEMORY_ALLOCATION_FAIL;
         }
         
         mgmtData->pageDirectory = newDirectory;
         
         // Initialize new page directory entry
-        initPageDirectoryEntry(&mgmtData->pageDirectory[pageIndex], mgmtData->numPages - mgmtData->numPageDP);
+        initPageDirectoryEntry(&mgmtData->pageDirectory[pageIndex], mgmtData->numPages - mgmtData->numPageDP,
+                               mgmtData->pageSize);
         
         // Create new page
-        char *newPage = calloc(1, PAGE_SIZE);
+        char *newPage = calloc(1, mgmtData->pageSize);
         if (!newPage) {
-            printf("Error: Failed to allocate memory for new page\n");
+            LOG_ERROR("Error: Failed to allocate memory for new page\n");
             return RC_MEMORY_ALLOCATION_FAIL;
         }
         
@@ -727,7 +749,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         RC status = appendEmptyBlock(&mgmtData->fileHndl);
         if (status != RC_OK) {
             free(newPage);
-            printf("Error: Failed to append new page\n");
+            LOG_ERROR("Error: Failed to append new page\n");
             return status;
         }
         
@@ -735,7 +757,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
         free(newPage);
         
         if (status != RC_OK) {
-            printf("Error: Failed to write new page\n");
+            LOG_ERROR("Error: Failed to write new page\n");
             return status;
         }
     }
@@ -744,7 +766,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     int pageToPin = mgmtData->pageDirectory[pageIndex].pageID + mgmtData->numPageDP + 1;
     RC status = pinPage(&mgmtData->bm, &mgmtData->pageHndlBM, pageToPin);
     if (status != RC_OK) {
-        printf("Error: Failed to pin page\n");
+        LOG_ERROR("Error: Failed to pin page\n");
         return status;
     }
     
@@ -760,7 +782,7 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     }
     
     // Calculate record offset
-    int recordOffset = PAGE_SIZE - (mgmtData->pageDirectory[pageIndex].recordCount * recordSize);
+    int recordOffset = mgmtData->pageSize - (mgmtData->pageDirectory[pageIndex].recordCount * recordSize);
     
     // Update slot directory entry
     SlotDirectoryEntry *slotEntry = (SlotDirectoryEntry *)(pageData + slotIndex * sizeof(SlotDirectoryEntry));
@@ -782,25 +804,25 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     status = markDirty(&mgmtData->bm, &mgmtData->pageHndlBM);
     if (status != RC_OK) {
         unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
-        printf("Error: Failed to mark page as dirty\n");
+        LOG_ERROR("Error: Failed to mark page as dirty\n");
         return status;
     }
     
     // Unpin the page
     status = unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
     if (status != RC_OK) {
-        printf("Error: Failed to unpin page\n");
+        LOG_ERROR("Error: Failed to unpin page\n");
         return status;
     }
     
     // Save page directory to disk
     status = savePageDirectoryToDisk(rel);
     if (status != RC_OK) {
-        printf("Error: Failed to save page directory\n");
+        LOG_ERROR("Error: Failed to save page directory\n");
         return status;
     }
     
-    printf("Record inserted successfully\n");
+    LOG_TRACE("Record inserted successfully\n");
     return RC_OK;
 }
 
@@ -849,11 +871,11 @@ static void updatePageStatistics(RM_TableData *table, int pageIdx, int spaceChan
  * Deletes a record from the table
  */
 RC deleteRecord(RM_TableData *rel, RID id) {
-    printf("Deleting record from table '%s'...\n", rel->name);
+    LOG_TRACE("Deleting record from table '%s'...\n", rel->name);
     
     // Validate input parameters
     if (!rel || !rel->managementData) {
-        printf("Error: Invalid table\n");
+        LOG_ERROR("Error: Invalid table\n");
         return RC_INVALID_INPUT;
     }
     
@@ -861,14 +883,14 @@ RC deleteRecord(RM_TableData *rel, RID id) {
     
     // Validate RID
     if (!isValidRecordID(id, mgmtData->numPages)) {
-        printf("Error: Invalid record ID\n");
+        LOG_ERROR("Error: Invalid record ID\n");
         return RC_RM_INVALID_RID;
     }
     
     // Pin the page
     RC status = pinPage(&mgmtData->bm, &mgmtData->pageHndlBM, id.page + mgmtData->numPageDP + 1);
     if (status != RC_OK) {
-        printf("Error: Failed to pin page\n");
+        LOG_ERROR("Error: Failed to pin page\n");
         return status;
     }
     
@@ -881,7 +903,7 @@ RC deleteRecord(RM_TableData *rel, RID id) {
     // Check if slot is already free
     if (slotEntry->isFree) {
         unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
-        printf("Error: Record not found\n");
+        LOG_ERROR("Error: Record not found\n");
         return RC_RM_RECORD_NOT_FOUND;
     }
     
@@ -899,25 +921,25 @@ RC deleteRecord(RM_TableData *rel, RID id) {
     status = markDirty(&mgmtData->bm, &mgmtData->pageHndlBM);
     if (status != RC_OK) {
         unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
-        printf("Error: Failed to mark page as dirty\n");
+        LOG_ERROR("Error: Failed to mark page as dirty\n");
         return status;
     }
     
     // Unpin the page
     status = unpinPage(&mgmtData->bm, &mgmtData->pageHndlBM);
     if (status != RC_OK) {
-        printf("Error: Failed to unpin page\n");
+        LOG_ERROR("Error: Failed to unpin page\n");
         return status;
     }
     
     // Save page directory to disk
     status = savePageDirectoryToDisk(rel);
     if (status != RC_OK) {
-        printf("Error: Failed to save page directory\n");
+        LOG_ERROR("Error: Failed to save page directory\n");
         return status;
     }
     
-    printf("Record deleted successfully\n");
+    LOG_TRACE("Record deleted successfully\n");
     return RC_OK;
 }
 
@@ -929,23 +951,23 @@ static bool isValidRecordID(RID id, int totalPages) {
 }
 
 RC updateRecord(RM_TableData *table, Record *record) {
-    printf("Attempting to modify record in table: %s\n", table->name);
+    LOG_TRACE("Attempting to modify record in table: %s\n", table->name);
     
     if (!table || !table->managementData || !record) {
-        fprintf(stderr, "Error: Null reference detected for table or record\n");
+        LOG_ERROR("Error: Null reference detected for table or record\n");
         return RC_INVALID_INPUT;
     }
     
     RM_managementData *metadata = (RM_managementData *)table->managementData;
     
     if (!isValidRecordID(record->id, metadata->numPages)) {
-        fprintf(stderr, "Error: Provided Record ID is invalid\n");
+        LOG_ERROR("Error: Provided Record ID is invalid\n");
         return RC_RM_INVALID_RID;
     }
     
     RC result = pinPage(&metadata->bm, &metadata->pageHndlBM, record->id.page + metadata->numPageDP + 1);
     if (result != RC_OK) {
-        fprintf(stderr, "Failure in pinning the page\n");
+        LOG_ERROR("Failure in pinning the page\n");
         return result;
     }
     
@@ -954,7 +976,7 @@ RC updateRecord(RM_TableData *table, Record *record) {
     
     if (slotInfo->isFree) {
         unpinPage(&metadata->bm, &metadata->pageHndlBM);
-        fprintf(stderr, "Error: No valid record found at the specified location\n");
+        LOG_ERROR("Error: No valid record found at the specified location\n");
         return RC_RM_RECORD_NOT_FOUND;
     }
     
@@ -966,12 +988,12 @@ RC updateRecord(RM_TableData *table, Record *record) {
         unpinPage(&metadata->bm, &metadata->pageHndlBM);
         
         if ((result = deleteRecord(table, record->id)) != RC_OK) {
-            fprintf(stderr, "Error: Deletion process failed during update\n");
+            LOG_ERROR("Error: Deletion process failed during update\n");
             return result;
         }
         
         if ((result = insertRecord(table, record)) != RC_OK) {
-            fprintf(stderr, "Error: Reinsertion failed during update\n");
+            LOG_ERROR("Error: Reinsertion failed during update\n");
             return result;
         }
     } else {
@@ -979,17 +1001,17 @@ RC updateRecord(RM_TableData *table, Record *record) {
         
         if ((result = markDirty(&metadata->bm, &metadata->pageHndlBM)) != RC_OK) {
             unpinPage(&metadata->bm, &metadata->pageHndlBM);
-            fprintf(stderr, "Error: Failed to flag page as modified\n");
+            LOG_ERROR("Error: Failed to flag page as modified\n");
             return result;
         }
         
         if ((result = unpinPage(&metadata->bm, &metadata->pageHndlBM)) != RC_OK) {
-            fprintf(stderr, "Error: Issue encountered during page unpinning\n");
+            LOG_ERROR("Error: Issue encountered during page unpinning\n");
             return result;
         }
     }
     
-    printf("Record update finalized successfully\n");
+    LOG_TRACE("Record update finalized successfully\n");
     return RC_OK;
 }
 
@@ -1060,11 +1082,11 @@ RC getRecord(RM_TableData *rel, RID id, Record *record) {
  * Initializes a scan operation on the table
  */
 RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *condition) {
-    printf("Starting scan on table '%s'...\n", rel->name);
+    LOG_DEBUG("Starting scan on table '%s'...\n", rel->name);
     
     // Validate input parameters
     if (!rel || !scan) {
-        printf("Error: Invalid table or scan handle\n");
+        LOG_ERROR("Error: Invalid table or scan handle\n");
         return RC_INVALID_INPUT;
     }
     
@@ -1074,7 +1096,7 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *condition) {
     // Allocate memory for scan info
     ScanInfo *scanInfo = malloc(sizeof(ScanInfo));
     if (!scanInfo) {
-        printf("Error: Failed to allocate memory for scan info\n");
+        LOG_ERROR("Error: Failed to allocate memory for scan info\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -1082,11 +1104,22 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *condition) {
     scanInfo->condition = condition;
     scanInfo->currentPage = 0;
     scanInfo->currentSlot = 0;
+    scanInfo->prefetchedUpTo = 0;
+    scanInfo->ring.mgmtData = NULL;
+    
+    // A scan of a table larger than the pool reads through a ring of its own,
+    // so it does not evict the pages other operations keep using
+    RM_managementData *mgmtData = (RM_managementData *)rel->managementData;
+    if (mgmtData->numPages - mgmtData->numPageDP > mgmtData->bm.numPages &&
+        initAccessRing(&mgmtData->bm, &scanInfo->ring, SCAN_RING_FRAMES) != RC_OK) {
+        LOG_DEBUG("Pool too small for a scan ring, scanning without one\n");
+        scanInfo->ring.mgmtData = NULL;
+    }
     
     // Set scan management data
     scan->mgmtData = scanInfo;
     
-    printf("Scan initialized successfully\n");
+    LOG_DEBUG("Scan initialized successfully\n");
     return RC_OK;
 }
 
@@ -1097,6 +1130,31 @@ static int ceilDivision(int numerator, int denominator) {
     return (numerator + denominator - 1) / denominator;
 }
 
+/* 
+ * Asks the buffer pool to read the data pages after the scan's current one
+ * in the background, so the next page is there when the scan gets to it
+ */
+static void prefetchScanPages(RM_managementData *mgmtData, ScanInfo *scanInfo, int maxEntriesPerPage) {
+    PageNumber pageNums[SCAN_PREFETCH_PAGES];
+    int lastPage = mgmtData->numPages - mgmtData->numPageDP;
+    int first = (scanInfo->prefetchedUpTo > scanInfo->currentPage) ? scanInfo->prefetchedUpTo : scanInfo->currentPage + 1;
+    int n = 0;
+    
+    for (int page = first; page <= scanInfo->currentPage + SCAN_PREFETCH_PAGES && page <= lastPage; page++) {
+        pageNums[n++] = ceilDivision(page + 1, maxEntriesPerPage) + 1 + page;
+    }
+    if (n == 0) {
+        return;
+    }
+    
+    RC status = (scanInfo->ring.mgmtData != NULL)
+            ? prefetchPagesInRing(&mgmtData->bm, &scanInfo->ring, pageNums, n)
+            : prefetchPages(&mgmtData->bm, pageNums, n);
+    if (status == RC_OK) {
+        scanInfo->prefetchedUpTo = first + n;
+    }
+}
+
 /* 
  * Retrieves the next record that satisfies the scan condition
  */
@@ -1111,7 +1169,7 @@ RC next(RM_ScanHandle *scan, Record *record) {
     RM_managementData *mgmtData = (RM_managementData *)rel->managementData;
     
     // Calculate max entries per directory page
-    int maxEntriesPerPage = (PAGE_SIZE - 2 * sizeof(int)) / sizeof(PageDirectoryEntry);
+    int maxEntriesPerPage = (mgmtData->pageSize - 2 * sizeof(int)) / sizeof(PageDirectoryEntry);
     
     // Calculate record size
     int recordSize = computeRecordSize(rel->schema);
@@ -1121,8 +1179,15 @@ RC next(RM_ScanHandle *scan, Record *record) {
         // Calculate page number to pin
         int pageNum = ceilDivision(scanInfo->currentPage + 1, maxEntriesPerPage) + 1 + scanInfo->currentPage;
         
-        // Pin the page
-        RC status = pinPage(&mgmtData->bm, &mgmtData->pageHndlBM, pageNum);
+        // Let the following pages load while this one is scanned
+        if (scanInfo->currentSlot == 0) {
+            prefetchScanPages(mgmtData, scanInfo, maxEntriesPerPage);
+        }
+        
+        // Pin the page, through the scan's ring if it has one
+        RC status = (scanInfo->ring.mgmtData != NULL)
+                ? pinPageInRing(&mgmtData->bm, &scanInfo->ring, &mgmtData->pageHndlBM, pageNum)
+                : pinPage(&mgmtData->bm, &mgmtData->pageHndlBM, pageNum);
         if (status != RC_OK) {
             return status;
         }
@@ -1192,19 +1257,26 @@ RC next(RM_ScanHandle *scan, Record *record) {
  * Closes a scan operation
  */
 RC closeScan(RM_ScanHandle *scan) {
-    printf("Closing scan...\n");
+    LOG_DEBUG("Closing scan...\n");
     
     // Validate input parameters
     if (!scan || !scan->mgmtData) {
-        printf("Warning: Scan already closed or invalid\n");
+        LOG_WARN("Warning: Scan already closed or invalid\n");
         return RC_OK;
     }
     
+    // Give the ring's frames back to the pool
+    ScanInfo *scanInfo = (ScanInfo *)scan->mgmtData;
+    if (scanInfo->ring.mgmtData != NULL && scan->rel != NULL) {
+        RM_managementData *mgmtData = (RM_managementData *)scan->rel->managementData;
+        shutdownAccessRing(&mgmtData->bm, &scanInfo->ring);
+    }
+    
     // Free scan info
     free(scan->mgmtData);
     scan->mgmtData = NULL;
     
-    printf("Scan closed successfully\n");
+    LOG_DEBUG("Scan closed successfully\n");
     return RC_OK;
 }
 
@@ -1249,7 +1321,7 @@ int getRecordSize(Schema *schema) {
 }
 
 Schema *createSchema(int attributeCount, char **attributeNames, DataType *dataTypes, int *lengths, int keyCount, int *keyAttributes) {
-    printf("Initializing schema with %d attributes...\n", attributeCount);
+    LOG_DEBUG("Initializing schema with %d attributes...\n", attributeCount);
     
     Schema *schemaInstance = (Schema *)malloc(sizeof(Schema));
     if (!schemaInstance) {
@@ -1297,7 +1369,7 @@ Schema *createSchema(int attributeCount, char **attributeNames, DataType *dataTy
     // Copy key attributes
     memcpy(schemaInstance->keyAttrs, keyAttributes, keyCount * sizeof(int));
     
-    printf("Schema successfully initialized.\n");
+    LOG_DEBUG("Schema successfully initialized.\n");
     return schemaInstance;
 }
 
@@ -1306,11 +1378,11 @@ Schema *createSchema(int attributeCount, char **attributeNames, DataType *dataTy
  * Frees memory allocated for a schema
  */
 RC freeSchema(Schema *schema) {
-    printf("Freeing schema...\n");
+    LOG_DEBUG("Freeing schema...\n");
     
     // Validate input parameters
     if (!schema) {
-        printf("Warning: Schema already freed or invalid\n");
+        LOG_WARN("Warning: Schema already freed or invalid\n");
         return RC_OK;
     }
     
@@ -1342,7 +1414,7 @@ RC freeSchema(Schema *schema) {
     // Free schema
     free(schema);
     
-    printf("Schema freed successfully\n");
+    LOG_DEBUG("Schema freed successfully\n");
     return RC_OK;
 }
 
@@ -1350,18 +1422,18 @@ RC freeSchema(Schema *schema) {
  * Creates a new record for a given schema
  */
 RC createRecord(Record **record, Schema *schema) {
-    printf("Creating record...\n");
+    LOG_TRACE("Creating record...\n");
     
     // Validate input parameters
     if (!record || !schema) {
-        printf("Error: Invalid record pointer or schema\n");
+        LOG_ERROR("Error: Invalid record pointer or schema\n");
         return RC_INVALID_INPUT;
     }
     
     // Allocate memory for record
     Record *newRecord = malloc(sizeof(Record));
     if (!newRecord) {
-        printf("Error: Failed to allocate memory for record\n");
+        LOG_ERROR("Error: Failed to allocate memory for record\n");
         return RC_MEMORY_ALLOCATION_FAIL;
     }
     
@@ -1375,7 +1447,7 @@ RC createRecord(Record **record, Schema *schema) {
     // Allocate memory for record data
     newRecord->data = calloc(1, recordSize);
     if (!newRecord->data) {
-        printf("Error: Failed to allocate memory for record data\n");
+        LOG_ERROR("Error: Failed to allocate memory for record data\n");
         free(newRecord);
         return RC_MEMORY_ALLOCATION_FAIL;
     }
@@ -1383,7 +1455,7 @@ RC createRecord(Record **record, Schema *schema) {
     // Set output parameter
     *record = newRecord;
     
-    printf("Record created successfully\n");
+    LOG_TRACE("Record created successfully\n");
     return RC_OK;
 }
 
@@ -1391,11 +1463,11 @@ RC createRecord(Record **record, Schema *schema) {
  * Frees memory allocated for a record
  */
 RC freeRecord(Record *record) {
-    printf("Freeing record...\n");
+    LOG_TRACE("Freeing record...\n");
     
     // Validate input parameters
     if (!record) {
-        printf("Warning: Record already freed or invalid\n");
+        LOG_WARN("Warning: Record already freed or invalid\n");
         return RC_OK;
     }
     
@@ -1407,7 +1479,7 @@ RC freeRecord(Record *record) {
     // Free record
     free(record);
     
-    printf("Record freed successfully\n");
+    LOG_TRACE("Record freed successfully\n");
     return RC_OK;
 }
 
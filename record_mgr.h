@@ -10,6 +10,8 @@ typedef struct ScanInfo
     Expr *condition;
     int currentPage;
     int currentSlot;
+    int prefetchedUpTo; // first page index not yet handed to the buffer pool to prefetch
+    BM_AccessRing ring; // frames the scan reads its pages into, mgmtData NULL if it uses the pool as is
 } ScanInfo;
 
 typedef bool (*Condition)(Record *record);
@@ -26,6 +28,7 @@ typedef struct RM_ScanHandle
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithPageSize (char *name, Schema *schema, int pageSize);
 extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
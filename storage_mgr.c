@@ -1,24 +1,203 @@
+// O_DIRECT is a GNU extension
+#define _GNU_SOURCE
 #include "storage_mgr.h"
 #include "dberror.h"
+#include "trace.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+// io_uring is reached through raw system calls, so it only needs the kernel headers
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SM_HAVE_IO_URING 1
+#endif
 
 // Default setting of the storage manager status
 bool isInitialized=false;
 
+// One mapping of a page file, from its header on. A mapping replaced by a
+// larger one stays until the file is closed, so pointers into it stay valid;
+// both map the same pages of the page cache.
+typedef struct SM_Mapping {
+    char *addr;
+    size_t size;
+    struct SM_Mapping *previous;
+} SM_Mapping;
+
+// Per-handle state kept behind fHandle->mgmtInfo, shared by copies of the handle
+typedef struct SM_FileInfo {
+    int fd;
+    off_t dataOffset; // where page 0 starts: after the header page, or at 0 in a file from before headers
+    SM_AccessMode mode; // the mode granted, SM_ACCESS_PREAD if O_DIRECT was not available
+    _Atomic(SM_Mapping *) mapping; // current mapping in SM_ACCESS_MMAP mode
+    pthread_mutex_t mapLock; // serializes remapping
+} SM_FileInfo;
+
+#define FILE_DESCRIPTOR(fHandle) (((SM_FileInfo *) (fHandle)->mgmtInfo)->fd)
+#define FILE_INFO(fHandle) ((SM_FileInfo *) (fHandle)->mgmtInfo)
+
+// Mappings grow in steps of at least this many bytes, and at least double
+#define SM_MAP_CHUNK (1024 * 1024)
+
+#define IS_DIRECT_ALIGNED(address) (((uintptr_t) (address) & (SM_DIRECT_ALIGNMENT - 1)) == 0)
+
+// The first page of a file is its header; page n is stored right after it
+#define PAGE_OFFSET(fHandle, pageNum) (FILE_INFO(fHandle)->dataOffset + (off_t) (pageNum) * (fHandle)->pageSize)
+
+// Start of the header page, the rest of it is zero
+typedef struct SM_FileHeader {
+    char magic[8]; // SM_FILE_MAGIC
+    int32_t version;
+    int32_t pageSize;
+} SM_FileHeader;
+
+#define SM_FILE_MAGIC "PAGEFILE"
+#define SM_FILE_VERSION 1
+
+// Most buffers one vectored write takes, POSIX guarantees at least 16
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Re-reads the page count from the file itself. Several handles may be open on
+// the same file (the record manager and the buffer pool each keep one), so a
+// handle's cached totalNumPages can fall behind appends made through another.
+static RC refreshTotalNumPages (SM_FileHandle *fHandle) {
+    struct stat fileStat;
+    if (fstat(FILE_DESCRIPTOR(fHandle), &fileStat) != 0) {
+        LOG_ERROR("Error: Unable to determine the file size.\n");
+        return RC_READ_FAILED;
+    }
+    int numPages = (int) ((fileStat.st_size - FILE_INFO(fHandle)->dataOffset) / fHandle->pageSize);
+    fHandle->totalNumPages = (numPages > 0) ? numPages : 0;
+    return RC_OK;
+}
+
+// Returns a mapping that covers the file up to the end of page pageNum,
+// replacing the current one with a larger one if needed, or NULL if mmap fails.
+static SM_Mapping *mappingFor (SM_FileHandle *fHandle, int pageNum) {
+    SM_FileInfo *info = FILE_INFO(fHandle);
+    size_t needed = (size_t) PAGE_OFFSET(fHandle, pageNum + 1);
+    SM_Mapping *mapping = atomic_load_explicit(&info->mapping, memory_order_acquire);
+    if (mapping != NULL && mapping->size >= needed) {
+        return mapping;
+    }
+
+    pthread_mutex_lock(&info->mapLock);
+    mapping = atomic_load_explicit(&info->mapping, memory_order_relaxed);
+    if (mapping == NULL || mapping->size < needed) {
+        size_t size = (mapping != NULL && mapping->size * 2 > needed) ? mapping->size * 2 : needed;
+        size = (size + SM_MAP_CHUNK - 1) / SM_MAP_CHUNK * SM_MAP_CHUNK;
+
+        // Mapping past the end of the file is fine as long as nothing touches it
+        SM_Mapping *larger = malloc(sizeof(SM_Mapping));
+        char *addr = (larger != NULL) ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, info->fd, 0) : MAP_FAILED;
+        if (addr == MAP_FAILED) {
+            LOG_ERROR("Error: Unable to map %zu bytes of '%s'.\n", size, fHandle->fileName);
+            free(larger);
+            pthread_mutex_unlock(&info->mapLock);
+            return NULL;
+        }
+        larger->addr = addr;
+        larger->size = size;
+        larger->previous = mapping;
+        atomic_store_explicit(&info->mapping, larger, memory_order_release);
+        mapping = larger;
+    }
+    pthread_mutex_unlock(&info->mapLock);
+    return mapping;
+}
+
+// Whether memPage is where some mapping of the file keeps page pageNum, so
+// writing it back would copy the page onto itself
+static bool isMappedPage (SM_FileHandle *fHandle, int pageNum, SM_PageHandle memPage) {
+    SM_Mapping *mapping = atomic_load_explicit(&FILE_INFO(fHandle)->mapping, memory_order_acquire);
+    for (; mapping != NULL; mapping = mapping->previous) {
+        if (memPage == mapping->addr + PAGE_OFFSET(fHandle, pageNum)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Allocates a zeroed page buffer aligned for direct I/O
+static SM_PageHandle allocPageBuffer (int pageSize) {
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, SM_DIRECT_ALIGNMENT, pageSize) != 0) {
+        return NULL;
+    }
+    memset(buffer, 0, pageSize);
+    return buffer;
+}
+
+// Switches an open file to O_DIRECT. Returns false, leaving the file as it
+// was, if its pages are not a multiple of SM_DIRECT_ALIGNMENT or the file
+// system refuses direct I/O, either when the flag is set or on a first read.
+static bool enableDirectIO (SM_FileHandle *fHandle) {
+    int fd = FILE_DESCRIPTOR(fHandle);
+    if (fHandle->pageSize % SM_DIRECT_ALIGNMENT != 0) {
+        LOG_WARN("Warning: Pages of '%s' are too small for direct I/O, using buffered I/O.\n", fHandle->fileName);
+        return false;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) == -1) {
+        LOG_WARN("Warning: '%s' does not support direct I/O, using buffered I/O.\n", fHandle->fileName);
+        return false;
+    }
+
+    SM_PageHandle probe = allocPageBuffer(fHandle->pageSize);
+    bool supported = (probe != NULL && pread(fd, probe, fHandle->pageSize, 0) >= 0);
+    free(probe);
+    if (!supported) {
+        LOG_WARN("Warning: '%s' does not support direct I/O, using buffered I/O.\n", fHandle->fileName);
+        fcntl(fd, F_SETFL, flags);
+    }
+    return supported;
+}
+
 /* manipulating page files */
 void initStorageManager () {
     isInitialized = true;
-    printf("Initializing the Storage Manager.\n");
+    LOG_INFO("Initializing the Storage Manager.\n");
 }
 
 RC createPageFile (char *fileName) {
-    printf("Page file starts creating.\n");
+    return createPageFileWithPageSize(fileName, PAGE_SIZE);
+}
+
+/*
+ * Creates a page file of one empty page whose pages are pageSize bytes. The
+ * page size is kept in a header page in front of the pages and read back by
+ * openPageFile.
+ *
+ * @param fileName Name of the page file
+ * @param pageSize A power of two from PAGE_SIZE to SM_MAX_PAGE_SIZE
+ * @return         RC_OK, or RC_INVALID_INPUT for any other page size
+ */
+RC createPageFileWithPageSize (char *fileName, int pageSize) {
+    LOG_INFO("Page file starts creating.\n");
+    if (pageSize < PAGE_SIZE || pageSize > SM_MAX_PAGE_SIZE || (pageSize & (pageSize - 1)) != 0) {
+        LOG_ERROR("Error: Invalid page size %d.\n", pageSize);
+        return RC_INVALID_INPUT;
+    }
+
     FILE *fileExists = fopen(fileName,"r");
     if (fileExists != NULL) {
         fclose(fileExists);
-        fprintf(stderr, "Error: File already exists.\n");
+        LOG_ERROR("Error: File already exists.\n");
         exit(1);
     }
 
@@ -27,81 +206,161 @@ RC createPageFile (char *fileName) {
         exit(1);
     }
 
-    // Buffer to store '\0' bytes
-    char newBuffer[PAGE_SIZE];
-    memset(newBuffer, 0, PAGE_SIZE);
+    // The header page followed by one page of '\0' bytes
+    char *newBuffer = calloc(2, pageSize);
+    if (newBuffer == NULL) {
+        fclose(file);
+        remove(fileName);
+        return RC_MALLOC_ERROR;
+    }
+    SM_FileHeader header = {.version = SM_FILE_VERSION, .pageSize = pageSize};
+    memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+    memcpy(newBuffer, &header, sizeof(header));
 
     // Write to the file
-    fwrite(newBuffer, sizeof(char), PAGE_SIZE, file);
+    size_t written = fwrite(newBuffer, sizeof(char), 2 * pageSize, file);
+    free(newBuffer);
 
     // Close file
-    fclose(file);
+    if (fclose(file) != 0 || written != (size_t) (2 * pageSize)) {
+        remove(fileName);
+        return RC_WRITE_FAILED;
+    }
 
-    printf("Page file is created.\n");
+    LOG_INFO("Page file is created.\n");
     return RC_OK;
 }
 
 RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
-    printf("Page file opening.\n");
-    // Check for existence
-    FILE *fileExists = fopen(fileName,"r");
-    if (fileExists == NULL) {
-        return RC_FILE_NOT_FOUND;
-    }
-    fclose(fileExists);
+    return openPageFileWithMode(fileName, fHandle, SM_ACCESS_PREAD);
+}
 
-    fHandle->fileName = fileName;
-    if (fHandle->fileName == NULL) {
+/*
+ * Opens a page file like openPageFile, choosing how its pages are accessed.
+ * In SM_ACCESS_MMAP mode the file is mapped into memory: readBlock and
+ * writeBlock copy from and to the mapping without a system call, mapBlock
+ * hands out pointers into it, and syncBlocks turns into msync. The mapping
+ * grows in large steps as the file does.
+ * In SM_ACCESS_DIRECT mode reads and writes bypass the page cache with
+ * O_DIRECT. That needs pages that are a multiple of SM_DIRECT_ALIGNMENT and a
+ * file system that supports it; otherwise the file is opened in
+ * SM_ACCESS_PREAD mode instead, which getAccessMode reports.
+ *
+ * @param fileName Name of the page file
+ * @param fHandle  Handle to initialize
+ * @param mode     SM_ACCESS_PREAD, SM_ACCESS_MMAP or SM_ACCESS_DIRECT
+ * @return         RC_OK, or an error code if the file cannot be opened or mapped
+ */
+RC openPageFileWithMode (char *fileName, SM_FileHandle *fHandle, SM_AccessMode mode) {
+    LOG_TRACE("Page file opening.\n");
+    if (fileName == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
-    fHandle->totalNumPages = 0;
-    fHandle->curPagePos = 0;
-    fHandle->mgmtInfo = NULL;
 
-    // Open the file
-    fHandle->mgmtInfo = fopen(fileName, "r+");
-
-    // Get the total number of pages
-    if (fseek(fHandle->mgmtInfo, 0, SEEK_END) != 0) {
-        fprintf(stderr, "Error: Unable to seek to the end of the file.\n");
-        fclose(fHandle->mgmtInfo);
-        return RC_READ_FAILED;
+    // Open the file once; every later read and write is positional on this descriptor
+    int fd = open(fileName, O_RDWR);
+    if (fd == -1) {
+        return (errno == ENOENT) ? RC_FILE_NOT_FOUND : RC_FILE_OPEN_FAILED;
     }
 
-    long fileSize = ftell(fHandle->mgmtInfo);
-
-    if (fileSize == -1) {
-        fprintf(stderr, "Error: Unable to determine the file size.\n");
-        fclose(fHandle->mgmtInfo);
-        return RC_READ_FAILED;
+    SM_FileInfo *info = (SM_FileInfo *) malloc(sizeof(SM_FileInfo));
+    if (info == NULL) {
+        close(fd);
+        return RC_MALLOC_ERROR;
+    }
+    info->fd = fd;
+    info->mode = mode;
+    atomic_init(&info->mapping, NULL);
+    pthread_mutex_init(&info->mapLock, NULL);
+
+    // The page size comes from the header page. A file written before there
+    // were headers has none: its pages are PAGE_SIZE bytes from the start on.
+    SM_FileHeader header;
+    struct stat fileStat;
+    bool hasHeader = pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header) &&
+                     memcmp(header.magic, SM_FILE_MAGIC, sizeof(header.magic)) == 0;
+    if (!hasHeader && fstat(fd, &fileStat) == 0 && fileStat.st_size % PAGE_SIZE == 0) {
+        header.pageSize = PAGE_SIZE;
+        info->dataOffset = 0;
+    } else if (hasHeader && header.pageSize >= PAGE_SIZE && header.pageSize <= SM_MAX_PAGE_SIZE) {
+        info->dataOffset = header.pageSize;
+    } else {
+        LOG_ERROR("Error: '%s' is not a page file.\n", fileName);
+        pthread_mutex_destroy(&info->mapLock);
+        close(fd);
+        free(info);
+        return RC_FILE_OPEN_FAILED;
     }
 
-    fHandle->totalNumPages = ftell(fHandle->mgmtInfo) / PAGE_SIZE;
+    fHandle->fileName = fileName;
+    fHandle->pageSize = header.pageSize;
+    fHandle->curPagePos = 0;
+    fHandle->mgmtInfo = info;
 
-    // Rewind the file
-    rewind(fHandle->mgmtInfo);
+    // Get the total number of pages, and map them in SM_ACCESS_MMAP mode
+    RC rc = refreshTotalNumPages(fHandle);
+    if (rc == RC_OK && mode == SM_ACCESS_MMAP && mappingFor(fHandle, fHandle->totalNumPages) == NULL) {
+        rc = RC_FILE_OPEN_FAILED;
+    }
+    if (rc == RC_OK && mode == SM_ACCESS_DIRECT && !enableDirectIO(fHandle)) {
+        info->mode = SM_ACCESS_PREAD;
+    }
+    if (rc != RC_OK) {
+        pthread_mutex_destroy(&info->mapLock);
+        close(fd);
+        free(info);
+        fHandle->mgmtInfo = NULL;
+        return rc;
+    }
 
     return RC_OK;
 }
 
+/*
+ * Tells how an open page file reaches its pages, which for a file opened in
+ * SM_ACCESS_DIRECT mode shows whether direct I/O was available.
+ *
+ * @param fHandle Open page file
+ * @return        The access mode, SM_ACCESS_PREAD for a handle that is not open
+ */
+SM_AccessMode getAccessMode (SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return SM_ACCESS_PREAD;
+    }
+    return FILE_INFO(fHandle)->mode;
+}
+
 RC closePageFile (SM_FileHandle *fHandle) {
-    printf("Page file closing.\n");
+    LOG_TRACE("Page file closing.\n");
 
     // Check if file handle is initialized
     if (fHandle->mgmtInfo == NULL) {
         return  RC_FILE_NOT_FOUND;
     }
 
-    if (fclose(fHandle->mgmtInfo) == 0) {
-        fHandle->mgmtInfo = NULL;
+    SM_FileInfo *info = FILE_INFO(fHandle);
+    SM_Mapping *mapping = atomic_load_explicit(&info->mapping, memory_order_acquire);
+    while (mapping != NULL) {
+        SM_Mapping *previous = mapping->previous;
+        munmap(mapping->addr, mapping->size);
+        free(mapping);
+        mapping = previous;
+    }
+    pthread_mutex_destroy(&info->mapLock);
+
+    int result = close(info->fd);
+    free(fHandle->mgmtInfo);
+    fHandle->mgmtInfo = NULL;
+
+    if (result == 0) {
         return RC_OK;
     } else {
-        return  RC_FILE_NOT_FOUND;
+        return  RC_FILE_CLOSE_FAILED;
     }
 }
 
 RC destroyPageFile (char *fileName) {
-    printf("Page file deleting.\n");
+    LOG_INFO("Page file deleting.\n");
     // Check for existence
     FILE *fileExists = fopen(fileName,"r");
     if (fileExists == NULL) {
@@ -118,27 +377,234 @@ RC destroyPageFile (char *fileName) {
 }
 
 RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    printf("Reading Blocks.\n");
+    LOG_TRACE("Reading Blocks.\n");
     // Check the validation
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
     if (pageNum < 0 || pageNum > fHandle->totalNumPages) {
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Move the file pointer to the pageNum
-    if (fseek(fHandle->mgmtInfo, pageNum * PAGE_SIZE, SEEK_SET) != 0) {
-        fprintf(stderr, "Error: Unable to move the file pointer to the pageNum.\n");
-        return RC_READ_FAILED;
+    // A page known to exist is copied out of the mapping; only the page past
+    // the end, which the mapping cannot back, is left to pread
+    if (FILE_INFO(fHandle)->mode == SM_ACCESS_MMAP && pageNum < fHandle->totalNumPages) {
+        SM_Mapping *mapping = mappingFor(fHandle, pageNum);
+        if (mapping == NULL) {
+            return RC_READ_FAILED;
+        }
+        memcpy(memPage, mapping->addr + PAGE_OFFSET(fHandle, pageNum), fHandle->pageSize);
+        fHandle->curPagePos = pageNum;
+        TRACE_EVENT(TRACE_READ_BLOCK, FILE_DESCRIPTOR(fHandle), pageNum);
+        return RC_OK;
     }
 
-    // Stores its content in the memory pointed to by the memPage page handle
-    fread(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
+    // Direct I/O into a buffer that is not aligned for it goes through one that is
+    SM_PageHandle buffer = memPage;
+    if (FILE_INFO(fHandle)->mode == SM_ACCESS_DIRECT && !IS_DIRECT_ALIGNED(memPage)) {
+        buffer = allocPageBuffer(fHandle->pageSize);
+        if (buffer == NULL) {
+            return RC_MALLOC_ERROR;
+        }
+    }
+
+    // Read the page with a single positional read
+    ssize_t bytesRead = pread(FILE_DESCRIPTOR(fHandle), buffer, fHandle->pageSize, PAGE_OFFSET(fHandle, pageNum));
+    if (bytesRead >= 0 && bytesRead < fHandle->pageSize) {
+        // Reading at the end of the file yields an empty page
+        memset(buffer + bytesRead, 0, fHandle->pageSize - bytesRead);
+    }
+    if (buffer != memPage) {
+        memcpy(memPage, buffer, fHandle->pageSize);
+        free(buffer);
+    }
+    if (bytesRead < 0) {
+        LOG_ERROR("Error: Unable to read page %d.\n", pageNum);
+        return RC_READ_FAILED;
+    }
 
     // Update current position
     fHandle->curPagePos = pageNum;
+    TRACE_EVENT(TRACE_READ_BLOCK, FILE_DESCRIPTOR(fHandle), pageNum);
 
     return RC_OK;
 }
 
+/*
+ * Reads numPages consecutive pages starting at firstPage, scattering them
+ * into separate buffers, with as few positional reads as IOV_MAX allows.
+ * Like readBlock, the run may reach at most one page past the end of the
+ * file, and whatever lies past the end reads as empty pages.
+ *
+ * @param firstPage Page number of the first page in the run
+ * @param numPages  Number of pages in the run
+ * @param fHandle   Open page file
+ * @param memPages  One buffer of the file's page size per page, in page order
+ * @return          RC_OK, RC_READ_NON_EXISTING_PAGE if the run reaches
+ *                  further, or RC_READ_FAILED if it could not be read
+ */
+RC readBlocksScatter (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    LOG_TRACE("Reading a run of blocks.\n");
+    // Check the validation
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    if (firstPage < 0 || numPages <= 0 || memPages == NULL || firstPage + numPages - 1 > fHandle->totalNumPages) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    // A mapped file is copied out page by page through readBlock's mapping
+    // path, and so is a direct read into buffers not aligned for it
+    bool pageByPage = (FILE_INFO(fHandle)->mode == SM_ACCESS_MMAP);
+    for (int i = 0; FILE_INFO(fHandle)->mode == SM_ACCESS_DIRECT && i < numPages && !pageByPage; i++) {
+        pageByPage = !IS_DIRECT_ALIGNED(memPages[i]);
+    }
+    if (pageByPage) {
+        for (int i = 0; i < numPages; i++) {
+            RC rc = readBlock(firstPage + i, fHandle, memPages[i]);
+            if (rc != RC_OK) {
+                return rc;
+            }
+        }
+        return RC_OK;
+    }
+
+    struct iovec iov[IOV_MAX];
+    for (int done = 0; done < numPages; ) {
+        int count = numPages - done;
+        if (count > IOV_MAX) {
+            count = IOV_MAX;
+        }
+        for (int i = 0; i < count; i++) {
+            iov[i].iov_base = memPages[done + i];
+            iov[i].iov_len = fHandle->pageSize;
+        }
+
+        // A read may stop short anywhere, only the end of the file ends it early
+        ssize_t wanted = (ssize_t) count * fHandle->pageSize;
+        ssize_t bytesRead = 0;
+        while (bytesRead < wanted) {
+            int skip = bytesRead / fHandle->pageSize;
+            size_t into = bytesRead % fHandle->pageSize;
+            iov[skip].iov_base = memPages[done + skip] + into;
+            iov[skip].iov_len = fHandle->pageSize - into;
+            ssize_t n = preadv(FILE_DESCRIPTOR(fHandle), &iov[skip], count - skip,
+                               PAGE_OFFSET(fHandle, firstPage + done) + bytesRead);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            bytesRead += n;
+        }
+
+        // Reading at the end of the file yields empty pages, stopping before it is an error
+        ssize_t inFile = (ssize_t) (fHandle->totalNumPages - firstPage - done) * fHandle->pageSize;
+        if (bytesRead < wanted && bytesRead < inFile) {
+            LOG_ERROR("Error: Unable to read pages %d to %d.\n", firstPage + done, firstPage + done + count - 1);
+            return RC_READ_FAILED;
+        }
+        for (int i = 0; i < count; i++) {
+            ssize_t pageStart = (ssize_t) i * fHandle->pageSize;
+            if (bytesRead < pageStart + fHandle->pageSize) {
+                ssize_t valid = (bytesRead > pageStart) ? bytesRead - pageStart : 0;
+                memset(memPages[done + i] + valid, 0, fHandle->pageSize - valid);
+            }
+        }
+        done += count;
+    }
+
+    fHandle->curPagePos = firstPage + numPages - 1;
+#ifdef TRACE_RING
+    for (int i = 0; i < numPages; i++) {
+        TRACE_EVENT(TRACE_READ_BLOCK, FILE_DESCRIPTOR(fHandle), firstPage + i);
+    }
+#endif
+
+    return RC_OK;
+}
+
+/*
+ * Reads numPages consecutive pages starting at firstPage into one buffer
+ * of numPages times the file's page size, as readBlocksScatter does.
+ *
+ * @param firstPage Page number of the first page in the run
+ * @param numPages  Number of pages in the run
+ * @param fHandle   Open page file
+ * @param memPage   Buffer receiving the pages back to back
+ * @return          RC_OK, or the error of readBlocksScatter
+ */
+RC readBlocks (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (numPages <= 0 || memPage == NULL) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    SM_PageHandle memPages[IOV_MAX];
+    for (int done = 0; done < numPages; ) {
+        int count = numPages - done;
+        if (count > IOV_MAX) {
+            count = IOV_MAX;
+        }
+        for (int i = 0; i < count; i++) {
+            memPages[i] = memPage + (size_t) (done + i) * fHandle->pageSize;
+        }
+
+        RC rc = readBlocksScatter(firstPage + done, count, fHandle, memPages);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        done += count;
+    }
+    return RC_OK;
+}
+
+/*
+ * Points memPage at page pageNum in the mapping of a file opened in
+ * SM_ACCESS_MMAP mode, so the page is read and written without a copy. The
+ * pointer stays valid until the file is closed; changes made through it
+ * reach the file like those of writeBlock.
+ *
+ * @param pageNum Page number, below the number of pages of the file
+ * @param fHandle Page file opened in SM_ACCESS_MMAP mode
+ * @param memPage Receives the address of the page
+ * @return        RC_OK, RC_READ_NON_EXISTING_PAGE past the end of the file,
+ *                or RC_INVALID_INPUT if the file is not mapped
+ */
+RC mapBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *memPage) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (FILE_INFO(fHandle)->mode != SM_ACCESS_MMAP) {
+        return RC_INVALID_INPUT;
+    }
+
+    // Touching the mapping past the end of the file would fault
+    if (pageNum >= fHandle->totalNumPages) {
+        RC rc = refreshTotalNumPages(fHandle);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    SM_Mapping *mapping = mappingFor(fHandle, pageNum);
+    if (mapping == NULL) {
+        return RC_READ_FAILED;
+    }
+    *memPage = mapping->addr + PAGE_OFFSET(fHandle, pageNum);
+    fHandle->curPagePos = pageNum;
+    TRACE_EVENT(TRACE_READ_BLOCK, FILE_DESCRIPTOR(fHandle), pageNum);
+    return RC_OK;
+}
+
 int getBlockPos (SM_FileHandle *fHandle) {
     // Check for NULL pointer
     if (fHandle == NULL) {
@@ -213,6 +679,7 @@ RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
 }
 
 RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    LOG_TRACE("Writing Blocks.\n");
     // Check validation
     if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
@@ -222,17 +689,193 @@ RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
         return RC_WRITE_FAILED;
     }
 
-    // Move the pointer to the target page
-    if (fseek(fHandle->mgmtInfo, pageNum *PAGE_SIZE, SEEK_SET) != 0) {
-        fprintf(stderr, "Error: Unable to move the file pointer to the pageNum.\n");
-        return RC_READ_FAILED;
+    // An existing page is copied into the mapping, unless memPage is that very
+    // page; a page past the end grows the file through pwrite
+    if (FILE_INFO(fHandle)->mode == SM_ACCESS_MMAP && pageNum < fHandle->totalNumPages) {
+        if (!isMappedPage(fHandle, pageNum, memPage)) {
+            SM_Mapping *mapping = mappingFor(fHandle, pageNum);
+            if (mapping == NULL) {
+                return RC_WRITE_FAILED;
+            }
+            memcpy(mapping->addr + PAGE_OFFSET(fHandle, pageNum), memPage, fHandle->pageSize);
+        }
+        fHandle->curPagePos = pageNum;
+        TRACE_EVENT(TRACE_WRITE_BLOCK, FILE_DESCRIPTOR(fHandle), pageNum);
+        return RC_OK;
     }
 
-    // Write Content to the file
-    fwrite(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
+    // Direct I/O from a buffer that is not aligned for it goes through one that is
+    SM_PageHandle buffer = memPage;
+    if (FILE_INFO(fHandle)->mode == SM_ACCESS_DIRECT && !IS_DIRECT_ALIGNED(memPage)) {
+        buffer = allocPageBuffer(fHandle->pageSize);
+        if (buffer == NULL) {
+            return RC_MALLOC_ERROR;
+        }
+        memcpy(buffer, memPage, fHandle->pageSize);
+    }
 
+    // Write Content to the file with a single positional write
+    ssize_t bytesWritten = pwrite(FILE_DESCRIPTOR(fHandle), buffer, fHandle->pageSize, PAGE_OFFSET(fHandle, pageNum));
+    if (buffer != memPage) {
+        free(buffer);
+    }
+    if (bytesWritten != fHandle->pageSize) {
+        LOG_ERROR("Error: Unable to write page %d.\n", pageNum);
+        return RC_WRITE_FAILED;
+    }
+
+    // Writing the page just past the end grows the file
+    if (pageNum == fHandle->totalNumPages) {
+        fHandle->totalNumPages++;
+    }
     fHandle->curPagePos = pageNum;
+    TRACE_EVENT(TRACE_WRITE_BLOCK, FILE_DESCRIPTOR(fHandle), pageNum);
+
+    return RC_OK;
+}
+
+/*
+ * Writes numPages consecutive pages starting at firstPage, gathering them
+ * from separate buffers, with as few positional writes as IOV_MAX allows.
+ * Like writeBlock, the run may start at most one page past the end of the
+ * file and grows it as needed.
+ *
+ * @param firstPage Page number of the first page in the run
+ * @param numPages  Number of pages in the run
+ * @param fHandle   Open page file
+ * @param memPages  One buffer of the file's page size per page, in page order
+ * @return          RC_OK, or RC_WRITE_FAILED if any part of the run could not be written
+ */
+RC writeBlocksGather (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    LOG_TRACE("Writing a run of blocks.\n");
+    // Check validation
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    if (firstPage < 0 || firstPage > fHandle->totalNumPages || numPages <= 0 || memPages == NULL) {
+        return RC_WRITE_FAILED;
+    }
+
+    // A run of existing pages goes page by page through writeBlock's mapping
+    // path, and so does a direct write of buffers not aligned for it
+    bool pageByPage = (FILE_INFO(fHandle)->mode == SM_ACCESS_MMAP && firstPage + numPages <= fHandle->totalNumPages);
+    for (int i = 0; FILE_INFO(fHandle)->mode == SM_ACCESS_DIRECT && i < numPages && !pageByPage; i++) {
+        pageByPage = !IS_DIRECT_ALIGNED(memPages[i]);
+    }
+    if (pageByPage) {
+        for (int i = 0; i < numPages; i++) {
+            RC rc = writeBlock(firstPage + i, fHandle, memPages[i]);
+            if (rc != RC_OK) {
+                return rc;
+            }
+        }
+        return RC_OK;
+    }
+
+    struct iovec iov[IOV_MAX];
+    for (int done = 0; done < numPages; ) {
+        int count = numPages - done;
+        if (count > IOV_MAX) {
+            count = IOV_MAX;
+        }
+        for (int i = 0; i < count; i++) {
+            iov[i].iov_base = memPages[done + i];
+            iov[i].iov_len = fHandle->pageSize;
+        }
+
+        ssize_t bytesWritten = pwritev(FILE_DESCRIPTOR(fHandle), iov, count, PAGE_OFFSET(fHandle, firstPage + done));
+        if (bytesWritten != (ssize_t) count * fHandle->pageSize) {
+            LOG_ERROR("Error: Unable to write pages %d to %d.\n", firstPage + done, firstPage + done + count - 1);
+            return RC_WRITE_FAILED;
+        }
+        done += count;
+    }
 
+    if (firstPage + numPages > fHandle->totalNumPages) {
+        fHandle->totalNumPages = firstPage + numPages;
+    }
+    fHandle->curPagePos = firstPage + numPages - 1;
+#ifdef TRACE_RING
+    for (int i = 0; i < numPages; i++) {
+        TRACE_EVENT(TRACE_WRITE_BLOCK, FILE_DESCRIPTOR(fHandle), firstPage + i);
+    }
+#endif
+
+    return RC_OK;
+}
+
+/*
+ * Writes numPages consecutive pages starting at firstPage from one buffer
+ * of numPages times the file's page size, as writeBlocksGather does.
+ *
+ * @param firstPage Page number of the first page in the run
+ * @param numPages  Number of pages in the run
+ * @param fHandle   Open page file
+ * @param memPage   Buffer holding the pages back to back
+ * @return          RC_OK, or the error of writeBlocksGather
+ */
+RC writeBlocks (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (numPages <= 0 || memPage == NULL) {
+        return RC_WRITE_FAILED;
+    }
+
+    SM_PageHandle memPages[IOV_MAX];
+    for (int done = 0; done < numPages; ) {
+        int count = numPages - done;
+        if (count > IOV_MAX) {
+            count = IOV_MAX;
+        }
+        for (int i = 0; i < count; i++) {
+            memPages[i] = memPage + (size_t) (done + i) * fHandle->pageSize;
+        }
+
+        RC rc = writeBlocksGather(firstPage + done, count, fHandle, memPages);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        done += count;
+    }
+    return RC_OK;
+}
+
+/*
+ * Makes the writes to numPages pages from firstPage on durable. A mapped
+ * file is synced with msync over just those pages, any other file with
+ * fdatasync.
+ *
+ * @param firstPage First page to sync
+ * @param numPages  Number of pages to sync
+ * @param fHandle   Open page file
+ * @return          RC_OK, or RC_WRITE_FAILED if the pages could not be synced
+ */
+RC syncBlocks (int firstPage, int numPages, SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (firstPage < 0 || numPages <= 0) {
+        return RC_WRITE_FAILED;
+    }
+
+    if (FILE_INFO(fHandle)->mode != SM_ACCESS_MMAP) {
+        return (fdatasync(FILE_DESCRIPTOR(fHandle)) == 0) ? RC_OK : RC_WRITE_FAILED;
+    }
+
+    // msync takes whole pages of memory, so round the range out to them
+    SM_Mapping *mapping = mappingFor(fHandle, firstPage + numPages - 1);
+    if (mapping == NULL) {
+        return RC_WRITE_FAILED;
+    }
+    size_t memoryPage = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = (size_t) PAGE_OFFSET(fHandle, firstPage) / memoryPage * memoryPage;
+    size_t end = (size_t) PAGE_OFFSET(fHandle, firstPage + numPages);
+    if (msync(mapping->addr + start, end - start, MS_SYNC) != 0) {
+        LOG_ERROR("Error: Unable to sync pages %d to %d.\n", firstPage, firstPage + numPages - 1);
+        return RC_WRITE_FAILED;
+    }
     return RC_OK;
 }
 
@@ -253,21 +896,24 @@ RC appendEmptyBlock (SM_FileHandle *fHandle) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    // Move the pointer to the end
-    if (fseek(fHandle->mgmtInfo, 0, SEEK_END) != 0) {
-        fprintf(stderr, "Error: Unable to move the file pointer to the pageNum.\n");
-        return RC_READ_FAILED;
-    };
+    // Append after the real end of the file, which may have moved under another handle
+    RC rc = refreshTotalNumPages(fHandle);
+    if (rc != RC_OK) {
+        return rc;
+    }
 
-    // Get zero bytes buffer
-    SM_PageHandle zeroPg = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
+    // Get zero bytes buffer, aligned in case the file uses direct I/O
+    SM_PageHandle zeroPg = allocPageBuffer(fHandle->pageSize);
+    if (zeroPg == NULL) {
+        return RC_MALLOC_ERROR;
+    }
 
     // Write the page to the file
-    size_t appendContent = fwrite(zeroPg, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
+    ssize_t appendContent = pwrite(FILE_DESCRIPTOR(fHandle), zeroPg, fHandle->pageSize, PAGE_OFFSET(fHandle, fHandle->totalNumPages));
+    free(zeroPg);
 
     // Check Errors
-    if (appendContent != PAGE_SIZE) {
-        free(zeroPg);
+    if (appendContent != fHandle->pageSize) {
         return RC_WRITE_FAILED;
     }
 
@@ -275,8 +921,6 @@ RC appendEmptyBlock (SM_FileHandle *fHandle) {
     fHandle->totalNumPages++;
     fHandle->curPagePos = fHandle->totalNumPages - 1;
 
-    free(zeroPg);
-
     return RC_OK;
 }
 
@@ -287,13 +931,749 @@ RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
     }
 
     if (fHandle->totalNumPages < numberOfPages) {
-        int increasePg = numberOfPages - fHandle->totalNumPages;
-        for (int i = 0; i < increasePg; i++) {
-            RC result = appendEmptyBlock(fHandle);
+        // Another handle may already have grown the file
+        RC rc = refreshTotalNumPages(fHandle);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+
+    if (fHandle->totalNumPages < numberOfPages) {
+        // Append the missing pages with one vectored write per IOV_MAX of
+        // them, all gathered from the same empty page
+        SM_PageHandle zeroPg = allocPageBuffer(fHandle->pageSize);
+        if (zeroPg == NULL) {
+            return RC_MALLOC_ERROR;
+        }
+        SM_PageHandle zeroPages[IOV_MAX];
+        for (int i = 0; i < IOV_MAX; i++) {
+            zeroPages[i] = zeroPg;
+        }
+        while (fHandle->totalNumPages < numberOfPages) {
+            int increasePg = numberOfPages - fHandle->totalNumPages;
+            if (increasePg > IOV_MAX) {
+                increasePg = IOV_MAX;
+            }
+            RC result = writeBlocksGather(fHandle->totalNumPages, increasePg, fHandle, zeroPages);
             if (result != RC_OK) {
+                free(zeroPg);
                 return result;
             }
         }
+        free(zeroPg);
+
+        // Cover the new pages with one remap rather than one per page
+        if (FILE_INFO(fHandle)->mode == SM_ACCESS_MMAP && mappingFor(fHandle, numberOfPages - 1) == NULL) {
+            return RC_WRITE_FAILED;
+        }
     }
     return RC_OK;
-}
\ No newline at end of file
+}
+/************************************************************
+ *                    asynchronous I/O                      *
+ ************************************************************/
+typedef enum SM_IOOp {
+    SM_IO_READ = 0,
+    SM_IO_WRITE = 1
+} SM_IOOp;
+
+// A request from its submission until its completion is handed out
+typedef struct SM_IORequest {
+    SM_IOOp op;
+    int fd;
+    char *buffer;
+    size_t length;
+    size_t done; // bytes transferred so far, a short transfer goes on from here
+    size_t inFile; // bytes of a read before the end of the file; the rest reads as empty pages
+    off_t offset;
+    int firstPage;
+    int numPages;
+    void *userData;
+    RC rc;
+    bool inRing; // taken by the io_uring and not reaped yet
+} SM_IORequest;
+
+// State of a queue kept behind queue->mgmtInfo
+typedef struct SM_IOQueueInfo {
+    pthread_mutex_t lock;
+    int depth;
+    SM_IORequest *requests; // depth slots
+    int *freeSlots; // stack of unused slots
+    int numFree;
+    int *doneSlots; // ring of finished slots, in the order they finished
+    int doneHead;
+    int numDone;
+    int inFlight; // submitted and not finished yet
+
+    // io_uring backend
+    int ringFd;
+    void *ring; // submission and completion rings, mapped together
+    size_t ringSize;
+    void *sqes;
+    size_t sqesSize;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqArray;
+    unsigned sqMask;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    void *cqes;
+    bool ringFailed; // waiting on the ring failed, new requests no longer go to it
+
+    // worker backend
+    pthread_t workers[SM_IO_WORKERS];
+    int numWorkers;
+    int *pendingSlots; // ring of slots waiting for a worker
+    int pendingHead;
+    int numPending;
+    pthread_cond_t workReady; // wakes the workers when a request is queued
+    pthread_cond_t workDone; // wakes a waiter when a request finished
+    bool stop;
+} SM_IOQueueInfo;
+
+#define IO_QUEUE_INFO(queue) ((SM_IOQueueInfo *) (queue)->mgmtInfo)
+
+// user_data of the cancellations sent to a failed ring, beyond any slot
+#define SM_RING_CANCEL UINT64_MAX
+
+// Pause between looks at the completion ring of a failed io_uring while shutting down
+#define SM_RING_POLL_MICROS 1000
+
+/*
+ * Reads or writes what is left of a request with positional calls, for the
+ * worker backend and for requests that cannot go through io_uring.
+ *
+ * @return Bytes of the request transferred, fewer than asked only if a read
+ *         met the end of the file, or -1 on an error
+ */
+static ssize_t transferRequest (SM_IORequest *request) {
+    size_t done = request->done;
+
+    while (done < request->length) {
+        ssize_t n;
+        if (request->op == SM_IO_READ) {
+            n = pread(request->fd, request->buffer + done, request->length - done, request->offset + done);
+        } else {
+            n = pwrite(request->fd, request->buffer + done, request->length - done, request->offset + done);
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+/*
+ * Records the result of a request and queues its slot for pollIOQueue and
+ * waitIOQueue. Like readBlocks, a read that meets the end of the file yields
+ * empty pages past it, while one that ends before it failed. Called with the
+ * queue lock held.
+ *
+ * @param info   State of the queue
+ * @param slot   Slot of the request
+ * @param result Bytes of the request transferred, or a negative value on an error
+ */
+static void finishRequest (SM_IOQueueInfo *info, int slot, ssize_t result) {
+    SM_IORequest *request = &info->requests[slot];
+
+    if (request->op == SM_IO_READ) {
+        request->rc = (result < 0 || (size_t) result < request->inFile) ? RC_READ_FAILED : RC_OK;
+        if (request->rc == RC_OK && (size_t) result < request->length) {
+            memset(request->buffer + result, 0, request->length - result);
+        }
+    } else {
+        request->rc = (result >= 0 && (size_t) result == request->length) ? RC_OK : RC_WRITE_FAILED;
+    }
+    if (request->rc != RC_OK) {
+        LOG_ERROR("Error: Unable to %s pages %d to %d.\n", (request->op == SM_IO_READ) ? "read" : "write",
+                  request->firstPage, request->firstPage + request->numPages - 1);
+    }
+
+    request->inRing = false;
+    info->doneSlots[(info->doneHead + info->numDone++) % info->depth] = slot;
+    info->inFlight--;
+}
+
+#ifdef SM_HAVE_IO_URING
+/*
+ * Tells whether a ring supports plain reads and writes, which came after
+ * io_uring itself.
+ */
+static bool ringSupportsReadWrite (int ringFd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    bool supported = false;
+
+    if (probe != NULL && syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        supported = probe->ops_len > IORING_OP_WRITE &&
+                    (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                    (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return supported;
+}
+
+/*
+ * Sets up an io_uring with room for depth requests and maps its rings. The
+ * completion ring the kernel sizes at twice that can never overflow, since
+ * no more than depth requests are ever in flight.
+ *
+ * @return true if the ring is ready, false if the kernel has none to offer
+ */
+static bool setupRing (SM_IOQueueInfo *info, int depth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int ringFd = syscall(__NR_io_uring_setup, depth, &params);
+    if (ringFd < 0) {
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !ringSupportsReadWrite(ringFd)) {
+        close(ringFd);
+        return false;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    info->ringSize = (sqSize > cqSize) ? sqSize : cqSize;
+    info->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    info->ring = mmap(NULL, info->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (info->ring == MAP_FAILED) {
+        close(ringFd);
+        return false;
+    }
+    info->sqes = mmap(NULL, info->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (info->sqes == MAP_FAILED) {
+        munmap(info->ring, info->ringSize);
+        close(ringFd);
+        return false;
+    }
+
+    char *ring = info->ring;
+    info->sqHead = (unsigned *) (ring + params.sq_off.head);
+    info->sqTail = (unsigned *) (ring + params.sq_off.tail);
+    info->sqArray = (unsigned *) (ring + params.sq_off.array);
+    info->sqMask = *(unsigned *) (ring + params.sq_off.ring_mask);
+    info->cqHead = (unsigned *) (ring + params.cq_off.head);
+    info->cqTail = (unsigned *) (ring + params.cq_off.tail);
+    info->cqMask = *(unsigned *) (ring + params.cq_off.ring_mask);
+    info->cqes = ring + params.cq_off.cqes;
+    info->ringFd = ringFd;
+    return true;
+}
+
+/*
+ * Hands what is left of a request to the kernel. Called with the queue lock held.
+ *
+ * @return true if the kernel took it
+ */
+static bool ringSubmit (SM_IOQueueInfo *info, int slot) {
+    SM_IORequest *request = &info->requests[slot];
+    unsigned tail = *info->sqTail;
+    unsigned index = tail & info->sqMask;
+    struct io_uring_sqe *sqe = &((struct io_uring_sqe *) info->sqes)[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (request->op == SM_IO_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = request->fd;
+    sqe->addr = (uintptr_t) (request->buffer + request->done);
+    sqe->len = request->length - request->done;
+    sqe->off = request->offset + request->done;
+    sqe->user_data = slot;
+    info->sqArray[index] = index;
+    atomic_store_explicit((_Atomic unsigned *) info->sqTail, tail + 1, memory_order_release);
+
+    long submitted;
+    do {
+        submitted = syscall(__NR_io_uring_enter, info->ringFd, 1, 0, 0, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted != 1) {
+        // Nothing was consumed, so the entry can be taken back
+        atomic_store_explicit((_Atomic unsigned *) info->sqTail, tail, memory_order_release);
+        return false;
+    }
+    request->inRing = true;
+    return true;
+}
+
+/*
+ * Moves the completions the kernel posted to the finished slots. A transfer
+ * that stopped short goes on from where it stopped, through the ring unless
+ * that fails, with the lock released meanwhile. The completion ring is read
+ * straight from memory, so this works even once the ring cannot be waited
+ * on. Called with the queue lock held.
+ */
+static void ringReap (SM_IOQueueInfo *info) {
+    while (true) {
+        unsigned head = *info->cqHead;
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *) info->cqTail, memory_order_acquire);
+        if (head == tail) {
+            break;
+        }
+        struct io_uring_cqe *cqe = &((struct io_uring_cqe *) info->cqes)[head & info->cqMask];
+        uint64_t userData = cqe->user_data;
+        int res = cqe->res;
+        atomic_store_explicit((_Atomic unsigned *) info->cqHead, head + 1, memory_order_release);
+
+        // Completions of cancellations only matter through the requests they end
+        if (userData >= (uint64_t) info->depth || !info->requests[userData].inRing) {
+            continue;
+        }
+        int slot = (int) userData;
+        SM_IORequest *request = &info->requests[slot];
+        request->inRing = false;
+        if (res == -EINTR || res == -EAGAIN) {
+            res = 0;
+        } else if (res < 0) {
+            finishRequest(info, slot, -1);
+            continue;
+        } else if (res == 0 || request->done + res >= request->length ||
+                   (request->op == SM_IO_READ && request->done + res >= request->inFile)) {
+            // Done, or a read that reached the end of the file
+            finishRequest(info, slot, request->done + res);
+            continue;
+        }
+
+        request->done += res;
+        if (info->ringFailed || !ringSubmit(info, slot)) {
+            pthread_mutex_unlock(&info->lock);
+            ssize_t result = transferRequest(request);
+            pthread_mutex_lock(&info->lock);
+            finishRequest(info, slot, result);
+        }
+    }
+}
+
+/*
+ * Sleeps until the kernel posts at least one completion. Called without the
+ * queue lock.
+ *
+ * @return true once a completion may be there, false if the ring cannot be
+ *         waited on
+ */
+static bool ringWait (SM_IOQueueInfo *info) {
+    long rc;
+    do {
+        rc = syscall(__NR_io_uring_enter, info->ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (rc < 0 && errno == EINTR);
+    return rc >= 0;
+}
+
+/*
+ * Gives up on a ring that cannot be waited on: asks the kernel to cancel the
+ * requests still in it and sends later requests past it. The requests keep
+ * their slots, and the kernel their buffers, until their completions show up
+ * in the completion ring. Called with the queue lock held.
+ */
+static void ringFail (SM_IOQueueInfo *info) {
+    LOG_ERROR("Error: Unable to wait on the io_uring.\n");
+    info->ringFailed = true;
+
+    unsigned tail = *info->sqTail;
+    unsigned count = 0;
+    for (int slot = 0; slot < info->depth; slot++) {
+        if (!info->requests[slot].inRing) {
+            continue;
+        }
+        unsigned index = (tail + count) & info->sqMask;
+        struct io_uring_sqe *sqe = &((struct io_uring_sqe *) info->sqes)[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = slot;
+        sqe->user_data = SM_RING_CANCEL;
+        info->sqArray[index] = index;
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    atomic_store_explicit((_Atomic unsigned *) info->sqTail, tail + count, memory_order_release);
+    if (syscall(__NR_io_uring_enter, info->ringFd, count, 0, 0, NULL, 0) < 0) {
+        // The ring takes nothing anymore; its requests can only run their course
+        atomic_store_explicit((_Atomic unsigned *) info->sqTail, tail, memory_order_release);
+    }
+}
+#endif
+
+/*
+ * Worker of a queue without io_uring. Takes the queued requests in order
+ * and does them with the queue lock released.
+ */
+static void *ioWorker (void *arg) {
+    SM_IOQueueInfo *info = arg;
+
+    pthread_mutex_lock(&info->lock);
+    while (true) {
+        if (info->numPending == 0) {
+            if (info->stop) {
+                break;
+            }
+            pthread_cond_wait(&info->workReady, &info->lock);
+            continue;
+        }
+
+        int slot = info->pendingSlots[info->pendingHead];
+        info->pendingHead = (info->pendingHead + 1) % info->depth;
+        info->numPending--;
+        pthread_mutex_unlock(&info->lock);
+
+        ssize_t result = transferRequest(&info->requests[slot]);
+
+        pthread_mutex_lock(&info->lock);
+        finishRequest(info, slot, result);
+        pthread_cond_broadcast(&info->workDone);
+    }
+    pthread_mutex_unlock(&info->lock);
+
+    return NULL;
+}
+
+static void freeIOQueueInfo (SM_IOQueueInfo *info) {
+    free(info->requests);
+    free(info->freeSlots);
+    free(info->doneSlots);
+    free(info->pendingSlots);
+    free(info);
+}
+
+/*
+ * Sets up a queue for up to depth reads and writes in flight at once. With
+ * SM_IO_URING the queue submits them to an io_uring; if the kernel offers
+ * none, or not one that reads and writes files, it falls back to
+ * SM_IO_THREADS, a pool of SM_IO_WORKERS threads doing positional reads and
+ * writes. queue->backend tells which one the queue got. A queue is meant
+ * for one thread at a time.
+ *
+ * @param queue   Queue to set up
+ * @param depth   Most requests in flight at once, up to SM_MAX_IO_DEPTH
+ * @param backend Backend to use if possible
+ * @return        RC_OK, RC_INVALID_INPUT for a depth out of range, or
+ *                RC_MALLOC_ERROR if the queue could not be set up
+ */
+RC initIOQueue (SM_IOQueue *queue, int depth, SM_IOBackend backend) {
+    if (queue == NULL || depth <= 0 || depth > SM_MAX_IO_DEPTH) {
+        return RC_INVALID_INPUT;
+    }
+
+    SM_IOQueueInfo *info = calloc(1, sizeof(SM_IOQueueInfo));
+    if (info == NULL) {
+        return RC_MALLOC_ERROR;
+    }
+    info->depth = depth;
+    info->ringFd = -1;
+    info->requests = calloc(depth, sizeof(SM_IORequest));
+    info->freeSlots = malloc(sizeof(int) * depth);
+    info->doneSlots = malloc(sizeof(int) * depth);
+    info->pendingSlots = malloc(sizeof(int) * depth);
+    if (info->requests == NULL || info->freeSlots == NULL || info->doneSlots == NULL || info->pendingSlots == NULL) {
+        freeIOQueueInfo(info);
+        return RC_MALLOC_ERROR;
+    }
+    for (int i = 0; i < depth; i++) {
+        info->freeSlots[info->numFree++] = depth - 1 - i;
+    }
+    pthread_mutex_init(&info->lock, NULL);
+    pthread_cond_init(&info->workReady, NULL);
+    pthread_cond_init(&info->workDone, NULL);
+
+#ifdef SM_HAVE_IO_URING
+    if (backend == SM_IO_URING && setupRing(info, depth)) {
+        queue->depth = depth;
+        queue->backend = SM_IO_URING;
+        queue->mgmtInfo = info;
+        return RC_OK;
+    }
+#endif
+
+    int numWorkers = (depth < SM_IO_WORKERS) ? depth : SM_IO_WORKERS;
+    for (int i = 0; i < numWorkers; i++) {
+        if (pthread_create(&info->workers[i], NULL, ioWorker, info) != 0) {
+            break;
+        }
+        info->numWorkers++;
+    }
+    if (info->numWorkers == 0) {
+        pthread_cond_destroy(&info->workDone);
+        pthread_cond_destroy(&info->workReady);
+        pthread_mutex_destroy(&info->lock);
+        freeIOQueueInfo(info);
+        return RC_MALLOC_ERROR;
+    }
+
+    queue->depth = depth;
+    queue->backend = SM_IO_THREADS;
+    queue->mgmtInfo = info;
+    return RC_OK;
+}
+
+/*
+ * Queues a read or a write of a run of pages. Runs on mapped files, and
+ * direct runs from or into buffers not aligned for it, are done right away
+ * through readBlocks and writeBlocks and only their completion is queued;
+ * so is a run the io_uring refused.
+ */
+static RC submitRequest (SM_IOQueue *queue, SM_IOOp op, int firstPage, int numPages, SM_FileHandle *fHandle,
+                         SM_PageHandle memPage, void *userData) {
+    if (queue == NULL || queue->mgmtInfo == NULL || fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (op == SM_IO_READ && (firstPage < 0 || numPages <= 0 || memPage == NULL ||
+                             firstPage + numPages - 1 > fHandle->totalNumPages)) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    if (op == SM_IO_WRITE && (firstPage < 0 || numPages <= 0 || memPage == NULL ||
+                              firstPage > fHandle->totalNumPages)) {
+        return RC_WRITE_FAILED;
+    }
+
+    SM_IOQueueInfo *info = IO_QUEUE_INFO(queue);
+    pthread_mutex_lock(&info->lock);
+    if (info->numFree == 0) {
+        pthread_mutex_unlock(&info->lock);
+        return RC_IO_QUEUE_FULL;
+    }
+
+    int slot = info->freeSlots[--info->numFree];
+    SM_IORequest *request = &info->requests[slot];
+    request->op = op;
+    request->fd = FILE_DESCRIPTOR(fHandle);
+    request->buffer = memPage;
+    request->length = (size_t) numPages * fHandle->pageSize;
+    request->done = 0;
+    request->inFile = 0;
+    if (firstPage < fHandle->totalNumPages) {
+        request->inFile = (size_t) (fHandle->totalNumPages - firstPage) * fHandle->pageSize;
+        if (request->inFile > request->length) {
+            request->inFile = request->length;
+        }
+    }
+    request->offset = PAGE_OFFSET(fHandle, firstPage);
+    request->firstPage = firstPage;
+    request->numPages = numPages;
+    request->userData = userData;
+    info->inFlight++;
+
+    if (FILE_INFO(fHandle)->mode == SM_ACCESS_MMAP ||
+        (FILE_INFO(fHandle)->mode == SM_ACCESS_DIRECT && !IS_DIRECT_ALIGNED(memPage))) {
+        pthread_mutex_unlock(&info->lock);
+        RC rc = (op == SM_IO_READ) ? readBlocks(firstPage, numPages, fHandle, memPage)
+                                   : writeBlocks(firstPage, numPages, fHandle, memPage);
+        pthread_mutex_lock(&info->lock);
+        finishRequest(info, slot, (rc == RC_OK) ? (ssize_t) request->length : -1);
+        pthread_mutex_unlock(&info->lock);
+        return RC_OK;
+    }
+
+#ifdef SM_HAVE_IO_URING
+    if (queue->backend == SM_IO_URING) {
+        if (info->ringFailed || !ringSubmit(info, slot)) {
+            pthread_mutex_unlock(&info->lock);
+            ssize_t result = transferRequest(request);
+            pthread_mutex_lock(&info->lock);
+            finishRequest(info, slot, result);
+        }
+        pthread_mutex_unlock(&info->lock);
+        return RC_OK;
+    }
+#endif
+
+    info->pendingSlots[(info->pendingHead + info->numPending++) % info->depth] = slot;
+    pthread_cond_signal(&info->workReady);
+    pthread_mutex_unlock(&info->lock);
+    return RC_OK;
+}
+
+/*
+ * Queues a read of numPages consecutive pages starting at firstPage into
+ * memPage, which must stay untouched until the read's completion is taken.
+ * As with readBlocks the run may reach one page past the end of the file,
+ * which reads as empty pages.
+ *
+ * @param queue     Queue to submit to
+ * @param firstPage Page number of the first page in the run
+ * @param numPages  Number of pages in the run
+ * @param fHandle   Open page file; only used during the call
+ * @param memPage   Buffer of numPages times the file's page size
+ * @param userData  Handed back with the completion
+ * @return          RC_OK, RC_IO_QUEUE_FULL with depth requests in flight or
+ *                  not taken yet, or RC_READ_NON_EXISTING_PAGE for a run
+ *                  reaching further
+ */
+RC submitRead (SM_IOQueue *queue, int firstPage, int numPages, SM_FileHandle *fHandle,
+               SM_PageHandle memPage, void *userData) {
+    return submitRequest(queue, SM_IO_READ, firstPage, numPages, fHandle, memPage, userData);
+}
+
+/*
+ * Queues a write of numPages consecutive pages starting at firstPage from
+ * memPage, which must stay untouched until the write's completion is taken.
+ * The run may start at most one page past the end of the file. A run that
+ * grows the file does not update the handle's page count, ensureCapacity
+ * picks it up from the file.
+ *
+ * @param queue     Queue to submit to
+ * @param firstPage Page number of the first page in the run
+ * @param numPages  Number of pages in the run
+ * @param fHandle   Open page file; only used during the call
+ * @param memPage   Buffer of numPages times the file's page size
+ * @param userData  Handed back with the completion
+ * @return          RC_OK, RC_IO_QUEUE_FULL with depth requests in flight or
+ *                  not taken yet, or RC_WRITE_FAILED for a run starting further
+ */
+RC submitWrite (SM_IOQueue *queue, int firstPage, int numPages, SM_FileHandle *fHandle,
+                SM_PageHandle memPage, void *userData) {
+    return submitRequest(queue, SM_IO_WRITE, firstPage, numPages, fHandle, memPage, userData);
+}
+
+/*
+ * Takes up to maxCompletions finished requests, in the order they finished,
+ * waiting until at least minCompletions have, or until nothing is left in
+ * flight to wait for. Their slots are free for new requests on return.
+ * If the io_uring cannot be waited on, the requests still in it keep their
+ * slots and buffers until the kernel is done with them; later calls take
+ * them once it is, and shutdownIOQueue waits for it.
+ *
+ * @param queue          Queue to take the completions from
+ * @param completions    Receives the completions
+ * @param minCompletions Completions to wait for, 0 to only take those already there
+ * @param maxCompletions Capacity of completions
+ * @param numCompletions Receives the number of completions taken
+ * @return               RC_OK, RC_INVALID_INPUT for bad arguments, or
+ *                       RC_IO_QUEUE_FAILED if fewer than minCompletions are
+ *                       finished and the io_uring cannot be waited on
+ */
+RC waitIOQueue (SM_IOQueue *queue, SM_IOCompletion *completions, int minCompletions, int maxCompletions,
+                int *numCompletions) {
+    if (queue == NULL || queue->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (completions == NULL || numCompletions == NULL || maxCompletions <= 0 ||
+        minCompletions < 0 || minCompletions > maxCompletions) {
+        return RC_INVALID_INPUT;
+    }
+
+    SM_IOQueueInfo *info = IO_QUEUE_INFO(queue);
+    pthread_mutex_lock(&info->lock);
+    while (true) {
+#ifdef SM_HAVE_IO_URING
+        if (queue->backend == SM_IO_URING) {
+            ringReap(info);
+        }
+#endif
+        if (info->numDone >= minCompletions || info->inFlight == 0) {
+            break;
+        }
+#ifdef SM_HAVE_IO_URING
+        if (queue->backend == SM_IO_URING && info->ringFailed) {
+            // Nothing to wait on; the requests left keep their slots until the kernel posts them
+            pthread_mutex_unlock(&info->lock);
+            *numCompletions = 0;
+            return RC_IO_QUEUE_FAILED;
+        }
+        if (queue->backend == SM_IO_URING) {
+            pthread_mutex_unlock(&info->lock);
+            bool waited = ringWait(info);
+            pthread_mutex_lock(&info->lock);
+            if (!waited) {
+                ringFail(info);
+            }
+            continue;
+        }
+#endif
+        pthread_cond_wait(&info->workDone, &info->lock);
+    }
+
+    int n = 0;
+    while (n < maxCompletions && info->numDone > 0) {
+        int slot = info->doneSlots[info->doneHead];
+        info->doneHead = (info->doneHead + 1) % info->depth;
+        info->numDone--;
+
+        SM_IORequest *request = &info->requests[slot];
+        completions[n].userData = request->userData;
+        completions[n].firstPage = request->firstPage;
+        completions[n].numPages = request->numPages;
+        completions[n].rc = request->rc;
+        n++;
+        info->freeSlots[info->numFree++] = slot;
+    }
+    pthread_mutex_unlock(&info->lock);
+
+    *numCompletions = n;
+    return RC_OK;
+}
+
+/*
+ * Takes up to maxCompletions finished requests without waiting.
+ */
+RC pollIOQueue (SM_IOQueue *queue, SM_IOCompletion *completions, int maxCompletions, int *numCompletions) {
+    return waitIOQueue(queue, completions, 0, maxCompletions, numCompletions);
+}
+
+/*
+ * Waits for the requests in flight to finish, drops the completions not
+ * taken and releases the queue. Once it returns the kernel is done with
+ * every buffer, even if the io_uring failed.
+ *
+ * @param queue Queue to shut down
+ * @return      RC_OK, or RC_FILE_HANDLE_NOT_INIT if the queue is not set up
+ */
+RC shutdownIOQueue (SM_IOQueue *queue) {
+    if (queue == NULL || queue->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    SM_IOQueueInfo *info = IO_QUEUE_INFO(queue);
+    pthread_mutex_lock(&info->lock);
+    while (info->inFlight > 0) {
+#ifdef SM_HAVE_IO_URING
+        if (queue->backend == SM_IO_URING) {
+            ringReap(info);
+            if (info->inFlight > 0 && info->ringFailed) {
+                // The kernel may still use the buffers, so look at the completion ring until it is done
+                pthread_mutex_unlock(&info->lock);
+                usleep(SM_RING_POLL_MICROS);
+                pthread_mutex_lock(&info->lock);
+            } else if (info->inFlight > 0) {
+                pthread_mutex_unlock(&info->lock);
+                bool waited = ringWait(info);
+                pthread_mutex_lock(&info->lock);
+                if (!waited) {
+                    ringFail(info);
+                }
+            }
+            continue;
+        }
+#endif
+        pthread_cond_wait(&info->workDone, &info->lock);
+    }
+    info->stop = true;
+    pthread_cond_broadcast(&info->workReady);
+    pthread_mutex_unlock(&info->lock);
+
+    for (int i = 0; i < info->numWorkers; i++) {
+        pthread_join(info->workers[i], NULL);
+    }
+#ifdef SM_HAVE_IO_URING
+    if (info->ringFd >= 0) {
+        munmap(info->sqes, info->sqesSize);
+        munmap(info->ring, info->ringSize);
+        close(info->ringFd);
+    }
+#endif
+    pthread_cond_destroy(&info->workDone);
+    pthread_cond_destroy(&info->workReady);
+    pthread_mutex_destroy(&info->lock);
+    freeIOQueueInfo(info);
+    queue->mgmtInfo = NULL;
+    return RC_OK;
+}
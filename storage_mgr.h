@@ -11,17 +11,58 @@ typedef struct SM_FileHandle {
 	int totalNumPages;
 	int curPagePos;
 	void *mgmtInfo;
+	int pageSize; // bytes per page, fixed when the file was created
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// How an open page file reaches its pages
+typedef enum SM_AccessMode {
+	SM_ACCESS_PREAD = 0, // positional reads and writes into the caller's buffers
+	SM_ACCESS_MMAP = 1, // the file is mapped, pages are copied from and to the mapping or used in place
+	SM_ACCESS_DIRECT = 2 // O_DIRECT, bypassing the page cache
+} SM_AccessMode;
+
+// Direct I/O needs buffers, offsets and page sizes aligned to this
+#define SM_DIRECT_ALIGNMENT 4096
+
+// Largest page size a page file may be created with
+#define SM_MAX_PAGE_SIZE 65536
+
+// Asynchronous I/O: requests are submitted to a queue and finish in any order
+typedef enum SM_IOBackend {
+	SM_IO_URING = 0, // io_uring, if the kernel offers it
+	SM_IO_THREADS = 1 // a few worker threads doing positional reads and writes
+} SM_IOBackend;
+
+typedef struct SM_IOQueue {
+	int depth; // most requests in flight at once
+	SM_IOBackend backend; // the backend granted, SM_IO_THREADS if io_uring was not available
+	void *mgmtInfo;
+} SM_IOQueue;
+
+// A finished request, as handed out by pollIOQueue and waitIOQueue
+typedef struct SM_IOCompletion {
+	void *userData; // as given when the request was submitted
+	int firstPage;
+	int numPages;
+	RC rc; // RC_OK, or why the request failed
+} SM_IOCompletion;
+
+// Worker threads of a queue without io_uring, and the deepest queue allowed
+#define SM_IO_WORKERS 4
+#define SM_MAX_IO_DEPTH 4096
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileWithMode (char *fileName, SM_FileHandle *fHandle, SM_AccessMode mode);
+extern SM_AccessMode getAccessMode (SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
@@ -33,11 +74,25 @@ extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC mapBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *memPage);
+extern RC readBlocks (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocksScatter (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocksGather (int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC syncBlocks (int firstPage, int numPages, SM_FileHandle *fHandle);
+
+/* asynchronous I/O */
+extern RC initIOQueue (SM_IOQueue *queue, int depth, SM_IOBackend backend);
+extern RC submitRead (SM_IOQueue *queue, int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern RC submitWrite (SM_IOQueue *queue, int firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern RC pollIOQueue (SM_IOQueue *queue, SM_IOCompletion *completions, int maxCompletions, int *numCompletions);
+extern RC waitIOQueue (SM_IOQueue *queue, SM_IOCompletion *completions, int minCompletions, int maxCompletions, int *numCompletions);
+extern RC shutdownIOQueue (SM_IOQueue *queue);
 
 #endif
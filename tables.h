@@ -56,6 +56,7 @@ typedef struct RM_managementData
     PageDirectoryEntry *pageDirectory; // Added field for page directory
     int numPages; // Added field for number of pages
     int numPageDP;
+    int pageSize; // size of the table's pages, read from its page file
 } RM_managementData;
 
 // information of a table schema: its attributes, datatypes, 
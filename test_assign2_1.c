@@ -0,0 +1,1566 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "test_helper.h"
+#include "trace.h"
+
+// check the frames of a pool as printed by sprintPoolContent
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+		do {									\
+			char *real;								\
+			char *_exp = (char *) (expected);                                   \
+			real = sprintPoolContent(bm);					\
+			if (strcmp((_exp),(real)) != 0)					\
+			{									\
+				printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+				free(real);							\
+				exit(1);							\
+			}									\
+			printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+			free(real);								\
+		} while(0)
+
+#define TEST_FILE "testbuffer.bin"
+
+// test methods
+static void testLRU (void);
+static void testClock (void);
+static void testLFU (void);
+static void testLFUAging (void);
+static void testLRUK (void);
+static void testARC (void);
+static void testBackgroundWriter (void);
+static void testTraceRing (void);
+static void testFrameLatch (void);
+static void testConcurrentPins (void);
+static void testPinWait (void);
+static void testFrameArena (void);
+static void testPrefetch (void);
+static void testAccessRing (void);
+static void testFlushPool (void);
+static void testPoolStats (void);
+static void testWarmRestart (void);
+static void testPageSize (void);
+static void testMappedFile (void);
+static void testDirectIO (void);
+static void testVectoredIO (void);
+static void testAsyncIO (void);
+
+// helper methods
+static void pinAndUnpin (BM_BufferPool *bm, BM_PageHandle *h, PageNumber pageNum);
+static void waitForReads (BM_BufferPool *bm, int reads);
+static int sumLatencies (uint64_t *histogram);
+static void *incrementUnderLatch (void *arg);
+static void *pinConcurrently (void *arg);
+static void *unpinLater (void *arg);
+
+// test name
+char *testName;
+
+// shared by the latch test threads
+#define LATCH_TEST_ROUNDS 100000
+static Latch testLatch;
+static long latchCounter;
+
+// work of one thread of the concurrent pin test
+#define CONCURRENT_PAGES 64
+typedef struct PinWorker {
+    BM_BufferPool *bm;
+    int seed;
+    int rounds; // 0 pins every page once, starting at seed
+    int errors; // pins that failed or saw the wrong page
+} PinWorker;
+
+// main method
+int
+main (void)
+{
+    initStorageManager();
+    testName = "";
+
+    testLRU();
+    testClock();
+    testLFU();
+    testLFUAging();
+    testLRUK();
+    testARC();
+    testBackgroundWriter();
+    testTraceRing();
+    testFrameLatch();
+    testConcurrentPins();
+    testPinWait();
+    testFrameArena();
+    testPrefetch();
+    testAccessRing();
+    testFlushPool();
+    testPoolStats();
+    testWarmRestart();
+    testPageSize();
+    testMappedFile();
+    testDirectIO();
+    testVectoredIO();
+    testAsyncIO();
+
+    return 0;
+}
+
+// ************************************************************
+void
+testLRU (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    testName = "test LRU page replacement";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_LRU, NULL));
+
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+
+    // a hit moves page 0 to the front, so page 1 is the least recently used
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 3);
+    ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "least recently used page replaced");
+
+    // the least recently used page is pinned, the next one goes instead
+    TEST_CHECK(pinPage(bm, pinned, 2));
+    pinAndUnpin(bm, h, 4);
+    ASSERT_EQUALS_POOL("[4 0],[3 0],[2 1]", bm, "pinned page skipped");
+
+    TEST_CHECK(pinPage(bm, h, 3));
+    TEST_CHECK(pinPage(bm, h, 4));
+    ASSERT_ERROR(pinPage(bm, h, 5), "no victim while every page is pinned");
+
+    h->pageNum = 3;
+    TEST_CHECK(unpinPage(bm, h));
+    h->pageNum = 4;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(unpinPage(bm, pinned));
+
+    // unpinning is not a use, page 2 was pinned longest ago
+    pinAndUnpin(bm, h, 5);
+    ASSERT_EQUALS_POOL("[4 0],[3 0],[5 0]", bm, "recency follows the pins");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testClock (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    testName = "test CLOCK page replacement";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_CLOCK, NULL));
+
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "pool filled in order");
+
+    // every frame is referenced, so the hand clears them all and comes back to the first
+    pinAndUnpin(bm, h, 3);
+    ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "first frame replaced after a full turn");
+
+    // page 1 gets a second chance, page 2 does not
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 4);
+    ASSERT_EQUALS_POOL("[3 0],[1 0],[4 0]", bm, "referenced page passed over");
+
+    // the hand continues where it stopped
+    pinAndUnpin(bm, h, 5);
+    ASSERT_EQUALS_POOL("[3 0],[5 0],[4 0]", bm, "hand resumes after the last victim");
+
+    // pinned frames are never victims
+    TEST_CHECK(pinPage(bm, pinned, 3));
+    pinAndUnpin(bm, h, 6);
+    ASSERT_EQUALS_POOL("[3 1],[5 0],[6 0]", bm, "pinned page skipped");
+
+    TEST_CHECK(pinPage(bm, h, 5));
+    TEST_CHECK(pinPage(bm, h, 6));
+    ASSERT_ERROR(pinPage(bm, h, 7), "no victim while every page is pinned");
+    ASSERT_EQUALS_POOL("[3 1],[5 1],[6 1]", bm, "pool unchanged by the failed pin");
+
+    h->pageNum = 5;
+    TEST_CHECK(unpinPage(bm, h));
+    h->pageNum = 6;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(unpinPage(bm, pinned));
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testLFU (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    int i;
+    testName = "test LFU page replacement";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_LFU, NULL));
+
+    // page 0 is used three times, page 1 once, page 2 twice
+    for (i = 0; i < 3; i++)
+        pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+    pinAndUnpin(bm, h, 2);
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "pool filled in order");
+
+    pinAndUnpin(bm, h, 3);
+    ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "least used page replaced");
+
+    // page 3 has been used once, page 2 twice
+    pinAndUnpin(bm, h, 4);
+    ASSERT_EQUALS_POOL("[0 0],[4 0],[2 0]", bm, "new page is the least used one");
+
+    // pages 4 and 2 are tied after this, the older use goes first
+    pinAndUnpin(bm, h, 4);
+    TEST_CHECK(pinPage(bm, pinned, 0));
+    pinAndUnpin(bm, h, 5);
+    ASSERT_EQUALS_POOL("[0 1],[4 0],[5 0]", bm, "tie broken by recency");
+
+    TEST_CHECK(pinPage(bm, h, 4));
+    TEST_CHECK(pinPage(bm, h, 5));
+    ASSERT_ERROR(pinPage(bm, h, 6), "no victim while every page is pinned");
+
+    h->pageNum = 4;
+    TEST_CHECK(unpinPage(bm, h));
+    h->pageNum = 5;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(unpinPage(bm, pinned));
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testLFUAging (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int decayPeriod = 4;
+    int i;
+    testName = "test LFU aging";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+
+    // without aging, page 0 keeps the frame it earned early on
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 2, RS_LFU, NULL));
+    for (i = 0; i < 8; i++)
+        pinAndUnpin(bm, h, 0);
+    for (i = 0; i < 5; i++)
+        pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+    ASSERT_EQUALS_POOL("[0 0],[2 0]", bm, "old hot page kept without aging");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // halving every four pins lets the recently hot page win
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 2, RS_LFU, &decayPeriod));
+    for (i = 0; i < 8; i++)
+        pinAndUnpin(bm, h, 0);
+    for (i = 0; i < 5; i++)
+        pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+    ASSERT_EQUALS_POOL("[2 0],[1 0]", bm, "old hot page evicted after aging");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testLRUK (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int k = 2;
+    int i;
+    testName = "test LRU-K page replacement";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+
+    // a page pinned twice, far enough apart, outlives newer pages pinned once
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_LRU_K, &k));
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 3);
+    ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "page with K references kept");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // a burst of pins within the correlated period counts as one reference
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_LRU_K, &k));
+    for (i = 0; i < 3; i++)
+        pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 2);
+    pinAndUnpin(bm, h, 3);
+    ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "correlated pins count once");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // an evicted page that comes back keeps its earlier reference
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 4, RS_LRU_K, &k));
+    for (i = 0; i < 5; i++)
+        pinAndUnpin(bm, h, i);
+    ASSERT_EQUALS_POOL("[4 0],[1 0],[2 0],[3 0]", bm, "page 0 evicted first");
+    pinAndUnpin(bm, h, 0);
+    for (i = 5; i < 9; i++)
+        pinAndUnpin(bm, h, i);
+    ASSERT_EQUALS_POOL("[7 0],[0 0],[8 0],[6 0]", bm, "retained history keeps page 0");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testARC (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    int i;
+    testName = "test ARC page replacement";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 4, RS_ARC, NULL));
+
+    // pages 0 and 1 are used twice and move to T2
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    pinAndUnpin(bm, h, 1);
+
+    // a scan only cycles through T1
+    for (i = 10; i < 20; i++)
+        pinAndUnpin(bm, h, i);
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[18 0],[19 0]", bm, "scan does not evict pages used twice");
+
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    ASSERT_EQUALS_INT(12, getNumReadIO(bm) - 1, "pages used twice still hit after the scan");
+
+    // page 17 was evicted from T1 recently; its ghost grows T1's target and it comes back on T2
+    pinAndUnpin(bm, h, 17);
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[17 0],[19 0]", bm, "ghost hit replaces the T1 page");
+
+    TEST_CHECK(pinPage(bm, h, 0));
+    TEST_CHECK(pinPage(bm, h, 1));
+    TEST_CHECK(pinPage(bm, h, 17));
+    TEST_CHECK(pinPage(bm, h, 19));
+    ASSERT_ERROR(pinPage(bm, h, 20), "no victim while every page is pinned");
+    for (i = 0; i < 4; i++)
+    {
+        h->pageNum = (i < 2) ? i : 17 + 2 * (i - 2);
+        TEST_CHECK(unpinPage(bm, h));
+    }
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testBackgroundWriter (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .writerCleanRatio = 1.0 };
+    int i, waited;
+    testName = "test background writer";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 4, RS_LRU, NULL, &options));
+
+    for (i = 0; i < 4; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+
+    // the writer wakes every BM_WRITER_INTERVAL_MS, give it up to a second
+    for (waited = 0; waited < 1000 && getNumWriteIO(bm) < 4; waited++)
+        usleep(1000);
+    ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "writer cleans every unpinned dirty page");
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0]", bm, "pages are clean and still cached");
+
+    // the evictions find clean victims
+    for (i = 4; i < 8; i++)
+        pinAndUnpin(bm, h, i);
+    ASSERT_EQUALS_INT(0, getNumDirtyEvictions(bm), "no pin had to write its victim");
+
+    for (i = 0; i < 4; i++)
+    {
+        char expected[PAGE_SIZE];
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(expected, "Page-%i", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "written page reads back");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testTraceRing (void)
+{
+    TraceEvent *events = malloc(sizeof(TraceEvent) * TRACE_RING_SIZE);
+    int i;
+    testName = "test trace ring";
+
+    traceReset();
+    ASSERT_EQUALS_INT(0, traceSnapshot(events, TRACE_RING_SIZE), "ring starts empty");
+
+    traceRecord(TRACE_PIN_MISS, 1, 7);
+    traceRecord(TRACE_UNPIN, 1, 7);
+    ASSERT_EQUALS_INT(2, traceSnapshot(events, TRACE_RING_SIZE), "both events recorded");
+    ASSERT_EQUALS_INT(TRACE_PIN_MISS, events[0].type, "oldest event first");
+    ASSERT_EQUALS_INT(7, events[0].arg2, "event arguments kept");
+    ASSERT_EQUALS_INT(TRACE_UNPIN, events[1].type, "newest event last");
+    ASSERT_TRUE(events[0].timeNanos <= events[1].timeNanos, "timestamps in order");
+
+    // a full ring keeps the newest events
+    for (i = 0; i < TRACE_RING_SIZE + 10; i++)
+        traceRecord(TRACE_PIN_HIT, 0, i);
+    ASSERT_EQUALS_INT(TRACE_RING_SIZE, traceSnapshot(events, TRACE_RING_SIZE), "ring holds TRACE_RING_SIZE events");
+    ASSERT_EQUALS_INT(10, events[0].arg2, "oldest events overwritten");
+    ASSERT_EQUALS_INT(TRACE_RING_SIZE + 9, events[TRACE_RING_SIZE - 1].arg2, "newest event kept");
+
+    ASSERT_EQUALS_INT(3, traceSnapshot(events, 3), "snapshot limited to the newest events");
+    ASSERT_EQUALS_INT(TRACE_RING_SIZE + 7, events[0].arg2, "limited snapshot starts at the right event");
+
+    traceReset();
+    free(events);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testFrameLatch (void)
+{
+    pthread_t threads[4];
+    uint32_t version;
+    int i;
+    testName = "test frame latch";
+
+    createLatch(&testLatch);
+
+    version = beginOptimisticRead(&testLatch);
+    ASSERT_TRUE(validateOptimisticRead(&testLatch, version), "read without a writer validates");
+
+    lockLatchForWrite(&testLatch);
+    releaseLatchAfterWrite(&testLatch);
+    ASSERT_TRUE(!validateOptimisticRead(&testLatch, version), "read across a writer fails validation");
+    ASSERT_EQUALS_INT(version + 2, beginOptimisticRead(&testLatch), "version bumped on acquire and release");
+
+    // writers exclude each other, spinning or parked
+    latchCounter = 0;
+    for (i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, incrementUnderLatch, NULL);
+    for (i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+    ASSERT_EQUALS_INT(4 * LATCH_TEST_ROUNDS, latchCounter, "no increment lost");
+    ASSERT_EQUALS_INT(0, atomic_load(&testLatch.state), "latch free afterwards");
+
+    destroyLatch(&testLatch);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testConcurrentPins (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    pthread_t threads[8];
+    PinWorker workers[8];
+    int *fixCounts;
+    int i, errors, pinned, reads;
+    testName = "test concurrent pins";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, CONCURRENT_PAGES, RS_LRU, NULL));
+    for (i = 0; i < CONCURRENT_PAGES; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // threads racing for the same missing pages read each of them once
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, CONCURRENT_PAGES, RS_LRU, NULL));
+    reads = getNumReadIO(bm);
+    for (i = 0; i < 8; i++)
+    {
+        workers[i] = (PinWorker) {bm, i, 0, 0};
+        pthread_create(&threads[i], NULL, pinConcurrently, &workers[i]);
+    }
+    for (i = 0, errors = 0; i < 8; i++)
+    {
+        pthread_join(threads[i], NULL);
+        errors += workers[i].errors;
+    }
+    ASSERT_EQUALS_INT(0, errors, "every pin saw its page");
+    ASSERT_EQUALS_INT(reads + CONCURRENT_PAGES, getNumReadIO(bm), "one read per page");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // a small pool evicts under the threads' feet; some pins also write their victims back
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 16, RS_CLOCK, NULL));
+    for (i = 0; i < 8; i++)
+    {
+        workers[i] = (PinWorker) {bm, i, 2000, 0};
+        pthread_create(&threads[i], NULL, pinConcurrently, &workers[i]);
+    }
+    for (i = 0, errors = 0; i < 8; i++)
+    {
+        pthread_join(threads[i], NULL);
+        errors += workers[i].errors;
+    }
+    ASSERT_EQUALS_INT(0, errors, "every pin saw its page while pages were evicted");
+    fixCounts = getFixCounts(bm);
+    for (i = 0, pinned = 0; i < 16; i++)
+        pinned += fixCounts[i];
+    free(fixCounts);
+    ASSERT_EQUALS_INT(0, pinned, "every pin released");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testPinWait (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *held = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .pinWaitMillis = 2000 };
+    pthread_t thread;
+    testName = "test pin wait";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+
+    // without a timeout a pin on an exhausted pool fails at once
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 2, RS_FIFO, NULL));
+    TEST_CHECK(pinPage(bm, held, 0));
+    TEST_CHECK(pinPage(bm, h, 1));
+    ASSERT_ERROR(pinPage(bm, h, 2), "no victim while every page is pinned");
+    ASSERT_EQUALS_INT(0, getNumPinWaits(bm), "no wait without a timeout");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(unpinPage(bm, held));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // with one the pin waits until another thread unpins a page
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 2, RS_LRU, NULL, &options));
+    TEST_CHECK(pinPage(bm, held, 0));
+    TEST_CHECK(pinPage(bm, h, 1));
+    pthread_create(&thread, NULL, unpinLater, bm);
+    TEST_CHECK(pinPage(bm, h, 2));
+    pthread_join(thread, NULL);
+    ASSERT_EQUALS_POOL("[2 1],[1 1]", bm, "page 2 took the frame unpinned meanwhile");
+    ASSERT_EQUALS_INT(1, getNumPinWaits(bm), "stall counted");
+    TEST_CHECK(unpinPage(bm, h));
+    h->pageNum = 1;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // and gives up once the timeout passes
+    options.pinWaitMillis = 20;
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 2, RS_CLOCK, NULL, &options));
+    TEST_CHECK(pinPage(bm, held, 0));
+    TEST_CHECK(pinPage(bm, h, 1));
+    ASSERT_ERROR(pinPage(bm, h, 2), "no frame unpinned before the timeout");
+    ASSERT_EQUALS_INT(1, getNumPinWaits(bm), "timed out stall counted");
+    ASSERT_EQUALS_POOL("[0 1],[1 1]", bm, "pool unchanged by the failed pin");
+    h->pageNum = 1;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(unpinPage(bm, held));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    free(held);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testFrameArena (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .hugePages = true };
+    char *first = NULL;
+    char expected[PAGE_SIZE];
+    int i, numFrames;
+    testName = "test frame arena";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+
+    // free frames are handed out in order, so their pages lie next to each other
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 4, RS_FIFO, NULL));
+    for (i = 0; i < 4; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        if (i == 0)
+            first = h->data;
+        ASSERT_TRUE(h->data == first + i * PAGE_SIZE, "frame pages are contiguous");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    ASSERT_TRUE((uintptr_t) first % BM_FRAME_ALIGNMENT == 0, "arena aligned for direct I/O");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // an arena of a huge page or more is mapped and works like any other
+    numFrames = 2 * BM_HUGE_PAGE_SIZE / PAGE_SIZE;
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, numFrames, RS_CLOCK, NULL, &options));
+    for (i = 0; i < numFrames; i += numFrames / 8)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 4, RS_FIFO, NULL));
+    for (i = 0; i < numFrames; i += numFrames / 8)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(expected, "Page-%i", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "page written from a huge page arena reads back");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testPrefetch (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .readaheadPages = 3 };
+    PageNumber pages[] = {3, 5};
+    PageNumber pastEnd[] = {100};
+    char expected[PAGE_SIZE];
+    int i, reads;
+    testName = "test prefetch and readahead";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 16, RS_FIFO, NULL));
+    for (i = 0; i < 16; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // prefetched pages arrive unpinned and the pins that follow hit them
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_FIFO, NULL));
+    reads = getNumReadIO(bm);
+    TEST_CHECK(prefetchPages(bm, pages, 2));
+    waitForReads(bm, reads + 2);
+    ASSERT_EQUALS_POOL("[3 0],[5 0],[-1 0]", bm, "pages loaded unpinned");
+    TEST_CHECK(pinPage(bm, h, 5));
+    ASSERT_EQUALS_STRING("Page-5", h->data, "prefetched page has its content");
+    ASSERT_EQUALS_INT(reads + 2, getNumReadIO(bm), "pin hit the prefetched page");
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+
+    // a prefetch neither grows the file nor writes back a dirty page to make room
+    TEST_CHECK(prefetchPages(bm, pastEnd, 1));
+    TEST_CHECK(prefetchPages(bm, pages, 1));
+    usleep(50000);
+    ASSERT_EQUALS_POOL("[3 0],[5x0],[-1 0]", bm, "page past the end not loaded");
+    TEST_CHECK(pinPage(bm, h, 7));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(pinPage(bm, h, 3));
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    reads = getNumReadIO(bm);
+    pastEnd[0] = 9;
+    TEST_CHECK(prefetchPages(bm, pastEnd, 1));
+    waitForReads(bm, reads + 1);
+    ASSERT_EQUALS_POOL("[3x0],[5x0],[9 0]", bm, "prefetch passed over the dirty frames");
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "nothing written back");
+    ASSERT_ERROR(prefetchPages(bm, NULL, 1), "pages missing");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // three sequential pins start readahead of the next three pages
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 8, RS_LRU, NULL, &options));
+    reads = getNumReadIO(bm);
+    for (i = 0; i < 3; i++)
+        pinAndUnpin(bm, h, i);
+    waitForReads(bm, reads + 6);
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[5 0],[-1 0],[-1 0]", bm, "next pages read ahead");
+    for (i = 3; i < 6; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(expected, "Page-%i", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "read ahead page has its content");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testAccessRing (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_AccessRing ring;
+    PageNumber pages[] = {2, 3};
+    int i, reads;
+    testName = "test access ring";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 5, RS_LRU, NULL));
+    pinAndUnpin(bm, h, 0);
+    pinAndUnpin(bm, h, 1);
+    reads = getNumReadIO(bm);
+
+    // a scan through a ring of two frames leaves the other pages alone
+    ASSERT_ERROR(initAccessRing(bm, &ring, 5), "ring as large as the pool");
+    TEST_CHECK(initAccessRing(bm, &ring, 2));
+    for (i = 4; i < 10; i++)
+    {
+        TEST_CHECK(pinPageInRing(bm, &ring, h, i));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[8 0],[9 0],[-1 0]", bm, "scan recycled its two frames");
+    ASSERT_EQUALS_INT(reads + 6, getNumReadIO(bm), "every scanned page read once");
+
+    // a page pinned by another caller leaves the ring and stays, the rest are dropped
+    pinAndUnpin(bm, h, 9);
+    TEST_CHECK(shutdownAccessRing(bm, &ring));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[-1 0],[9 0],[-1 0]", bm, "ring pages dropped");
+    ASSERT_ERROR(pinPageInRing(bm, &ring, h, 4), "ring shut down");
+
+    // prefetched pages go into the ring too
+    TEST_CHECK(initAccessRing(bm, &ring, 2));
+    reads = getNumReadIO(bm);
+    TEST_CHECK(prefetchPagesInRing(bm, &ring, pages, 2));
+    waitForReads(bm, reads + 2);
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[9 0],[3 0]", bm, "pages prefetched into free frames");
+    TEST_CHECK(pinPageInRing(bm, &ring, h, 3));
+    TEST_CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(reads + 2, getNumReadIO(bm), "pin hit the prefetched page");
+    TEST_CHECK(shutdownAccessRing(bm, &ring));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[-1 0],[9 0],[-1 0]", bm, "prefetched pages were in the ring");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+pinAndUnpin (BM_BufferPool *bm, BM_PageHandle *h, PageNumber pageNum)
+{
+    TEST_CHECK(pinPage(bm, h, pageNum));
+    TEST_CHECK(unpinPage(bm, h));
+}
+
+// waits up to a second for background reads to bring the read count to reads
+void
+waitForReads (BM_BufferPool *bm, int reads)
+{
+    int waited;
+    for (waited = 0; waited < 1000 && getNumReadIO(bm) < reads; waited++)
+        usleep(1000);
+    ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "background reads done");
+}
+
+// number of I/Os in a latency histogram
+int
+sumLatencies (uint64_t *histogram)
+{
+    int i, total = 0;
+    for (i = 0; i < BM_LATENCY_BUCKETS; i++)
+        total += (int) histogram[i];
+    return total;
+}
+
+// ************************************************************
+void
+testFlushPool (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    PageNumber order[] = {5, 4, 0, 2, 1};
+    char expected[PAGE_SIZE];
+    char page[PAGE_SIZE];
+    int i;
+    testName = "test flush pool";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 6, RS_FIFO, NULL));
+
+    // dirty pages out of order, with a pinned one in the middle of the run
+    TEST_CHECK(pinPage(bm, pinned, 3));
+    sprintf(pinned->data, "Page-3");
+    TEST_CHECK(markDirty(bm, pinned));
+    for (i = 0; i < 5; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, order[i]));
+        sprintf(h->data, "Page-%i", order[i]);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+
+    ASSERT_ERROR(forceFlushPool(bm), "a dirty page is pinned");
+    ASSERT_EQUALS_POOL("[3x1],[5 0],[4 0],[0 0],[2 0],[1 0]", bm, "every other page written");
+    ASSERT_EQUALS_INT(5, getNumWriteIO(bm), "each page written once");
+
+    TEST_CHECK(unpinPage(bm, pinned));
+    TEST_CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_POOL("[3 0],[5 0],[4 0],[0 0],[2 0],[1 0]", bm, "pinned page written after its unpin");
+    ASSERT_EQUALS_INT(6, getNumWriteIO(bm), "only the remaining page written");
+    TEST_CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(6, getNumWriteIO(bm), "nothing left to write");
+
+    // the file holds every page in its place
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    for (i = 0; i < 6; i++)
+    {
+        TEST_CHECK(readBlock(i, &fh, page));
+        sprintf(expected, "Page-%i", i);
+        ASSERT_EQUALS_STRING(expected, page, "flushed page on disk");
+    }
+    TEST_CHECK(closePageFile(&fh));
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testPoolStats (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_Stats stats;
+    PageNumber pages[] = {0};
+    int i;
+    testName = "test pool statistics";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_FIFO, NULL));
+    TEST_CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(0, (int) (stats.hits + stats.misses), "new pool counts nothing");
+
+    for (i = 0; i < 3; i++)
+        pinAndUnpin(bm, h, i);
+    pinAndUnpin(bm, h, 0);
+    TEST_CHECK(pinPage(bm, h, 1));
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(2, (int) stats.hits, "pins of cached pages");
+    ASSERT_EQUALS_INT(3, (int) stats.misses, "pins that read their page");
+    ASSERT_EQUALS_INT(0, (int) stats.evictions, "free frames left");
+    ASSERT_EQUALS_INT(3, sumLatencies(stats.readLatency), "one latency per read");
+
+    // FIFO replaces page 0, then the dirty page 1
+    pinAndUnpin(bm, h, 3);
+    pinAndUnpin(bm, h, 4);
+    TEST_CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(5, (int) stats.misses, "both pins missed");
+    ASSERT_EQUALS_INT(2, (int) stats.evictions, "two pages replaced");
+    ASSERT_EQUALS_INT(1, (int) stats.dirtyEvictions, "one written back by its pin");
+    ASSERT_EQUALS_INT(getNumDirtyEvictions(bm), (int) stats.dirtyEvictions, "same as the getter");
+    ASSERT_EQUALS_INT(5, sumLatencies(stats.readLatency), "one latency per read");
+    ASSERT_EQUALS_INT(1, sumLatencies(stats.writeLatency), "one latency per write");
+
+    // a prefetch reads without a miss, and its pin is a hit
+    TEST_CHECK(prefetchPages(bm, pages, 1));
+    waitForReads(bm, 7);
+    TEST_CHECK(pinPage(bm, h, 0));
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(forceFlushPool(bm));
+    TEST_CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(5, (int) stats.misses, "prefetch is no miss");
+    ASSERT_EQUALS_INT(3, (int) stats.hits, "pin of the prefetched page");
+    ASSERT_EQUALS_INT(6, sumLatencies(stats.readLatency), "prefetch read counted");
+    ASSERT_EQUALS_INT(2, sumLatencies(stats.writeLatency), "flush write counted");
+    ASSERT_EQUALS_INT(0, (int) stats.pinWaits, "no pin waited");
+
+    TEST_CHECK(shutdownBufferPool(bm));
+    ASSERT_ERROR(getPoolStats(bm, &stats), "pool shut down");
+
+    // every pool counts on its own
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_FIFO, NULL));
+    TEST_CHECK(getPoolStats(bm, &stats));
+    ASSERT_EQUALS_INT(0, (int) (stats.hits + stats.misses + stats.evictions), "new pool starts from zero");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testWarmRestart (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .warmRestart = true };
+    int i, reads;
+    testName = "test warm restart";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+
+    // pages 2 to 5 stay, 3 and then 5 pinned last
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 4, RS_LRU, NULL, &options));
+    for (i = 0; i < 6; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    pinAndUnpin(bm, h, 3);
+    pinAndUnpin(bm, h, 5);
+    TEST_CHECK(shutdownBufferPool(bm));
+    ASSERT_TRUE(access(TEST_FILE BM_MANIFEST_SUFFIX, F_OK) == 0, "manifest written on shutdown");
+
+    // the resident pages come back in page order
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 4, RS_LRU, NULL, &options));
+    waitForReads(bm, 1 + 4);
+    ASSERT_EQUALS_POOL("[2 0],[3 0],[4 0],[5 0]", bm, "hot set reloaded");
+    reads = getNumReadIO(bm);
+    for (i = 2; i < 6; i++)
+        pinAndUnpin(bm, h, i);
+    ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "pins of the hot set hit");
+    pinAndUnpin(bm, h, 5);
+    pinAndUnpin(bm, h, 3);
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // a smaller pool takes the hottest pages only
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 2, RS_LRU, NULL, &options));
+    waitForReads(bm, 1 + 2);
+    ASSERT_EQUALS_POOL("[3 0],[5 0]", bm, "two hottest pages reloaded");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // without the option the manifest is left alone
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 2, RS_LRU, NULL));
+    usleep(10000);
+    ASSERT_EQUALS_POOL("[-1 0],[-1 0]", bm, "pool starts empty");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPoolManifest(TEST_FILE));
+    ASSERT_TRUE(access(TEST_FILE BM_MANIFEST_SUFFIX, F_OK) != 0, "manifest removed");
+    TEST_CHECK(destroyPoolManifest(TEST_FILE));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testPageSize (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = {0};
+    SM_FileHandle fh;
+    char *page = malloc(4096);
+    char *read = malloc(4096);
+    char *second;
+    FILE *legacy;
+    int i;
+    testName = "test page size";
+
+    ASSERT_ERROR(createPageFileWithPageSize(TEST_FILE, 3000), "page size must be a power of two");
+    ASSERT_ERROR(createPageFileWithPageSize(TEST_FILE, PAGE_SIZE / 2), "page size below PAGE_SIZE");
+    ASSERT_ERROR(createPageFileWithPageSize(TEST_FILE, SM_MAX_PAGE_SIZE * 2), "page size above SM_MAX_PAGE_SIZE");
+
+    // the page size is kept in the file's header and comes back on open
+    TEST_CHECK(createPageFileWithPageSize(TEST_FILE, 4096));
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    ASSERT_EQUALS_INT(4096, fh.pageSize, "page size read from the header");
+    ASSERT_EQUALS_INT(1, fh.totalNumPages, "header page not counted");
+    for (i = 0; i < 4096; i++)
+        page[i] = (i % 10) + '0';
+    TEST_CHECK(ensureCapacity(3, &fh));
+    ASSERT_EQUALS_INT(3, fh.totalNumPages, "file grown by whole pages");
+    TEST_CHECK(writeBlock(2, &fh, page));
+    TEST_CHECK(readBlock(2, &fh, read));
+    ASSERT_TRUE(memcmp(page, read, 4096) == 0, "whole page read back");
+    TEST_CHECK(closePageFile(&fh));
+
+    // a file from before headers opens with PAGE_SIZE pages starting at its first byte
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    legacy = fopen(TEST_FILE, "w");
+    fwrite(page, 1, 2 * PAGE_SIZE, legacy);
+    fclose(legacy);
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "legacy file has PAGE_SIZE pages");
+    ASSERT_EQUALS_INT(2, fh.totalNumPages, "legacy file has no header page");
+    TEST_CHECK(readBlock(1, &fh, read));
+    ASSERT_TRUE(memcmp(page + PAGE_SIZE, read, PAGE_SIZE) == 0, "legacy page read from its old offset");
+    TEST_CHECK(writeBlock(2, &fh, page));
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    ASSERT_EQUALS_INT(3, fh.totalNumPages, "legacy file grown by a page");
+    TEST_CHECK(readBlock(2, &fh, read));
+    ASSERT_TRUE(memcmp(page, read, PAGE_SIZE) == 0, "page appended to the legacy file read back");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    TEST_CHECK(createPageFileWithPageSize(TEST_FILE, 4096));
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    TEST_CHECK(ensureCapacity(3, &fh));
+    TEST_CHECK(writeBlock(2, &fh, page));
+    TEST_CHECK(closePageFile(&fh));
+
+    // a private pool makes its frames as large as the file's pages
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_LRU, NULL));
+    TEST_CHECK(pinPage(bm, h, 2));
+    ASSERT_TRUE(memcmp(page, h->data, 4096) == 0, "page pinned whole");
+    second = h->data;
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(pinPage(bm, h, 0));
+    ASSERT_EQUALS_INT(4096, (int) (h->data > second ? h->data - second : second - h->data),
+                      "frames one page apart");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // a shared pool only takes files whose pages fit its frames
+    TEST_CHECK(initSharedBufferPool(64 * 1024, RS_LRU, NULL));
+    ASSERT_ERROR(initBufferPool(bm, TEST_FILE, 3, RS_LRU, NULL), "pages larger than the shared frames");
+    TEST_CHECK(shutdownSharedBufferPool());
+    options.pageSize = 4096;
+    TEST_CHECK(initSharedBufferPoolWithOptions(64 * 1024, RS_LRU, NULL, &options));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 3, RS_LRU, NULL));
+    TEST_CHECK(pinPage(bm, h, 2));
+    ASSERT_TRUE(memcmp(page, h->data, 4096) == 0, "page pinned whole in the shared pool");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(shutdownSharedBufferPool());
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(page);
+    free(read);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testMappedFile (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = {0};
+    SM_FileHandle fh, plain;
+    SM_PageHandle page = malloc(PAGE_SIZE);
+    SM_PageHandle read = malloc(PAGE_SIZE);
+    SM_PageHandle mapped, first;
+    BM_AccessRing ring;
+    PageNumber prefetched[] = {19999};
+    int i, reads;
+    testName = "test mapped page file";
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(openPageFileWithMode(TEST_FILE, &fh, SM_ACCESS_MMAP));
+    TEST_CHECK(openPageFile(TEST_FILE, &plain));
+    ASSERT_ERROR(mapBlock(0, &plain, &mapped), "plain handle has no mapping");
+
+    // reads and writes go through the mapping and agree with pread
+    TEST_CHECK(ensureCapacity(4, &fh));
+    for (i = 0; i < PAGE_SIZE; i++)
+        page[i] = (i % 10) + '0';
+    TEST_CHECK(writeBlock(3, &fh, page));
+    TEST_CHECK(ensureCapacity(4, &plain));
+    TEST_CHECK(readBlock(3, &plain, read));
+    ASSERT_TRUE(memcmp(page, read, PAGE_SIZE) == 0, "write through the mapping seen by pread");
+    TEST_CHECK(mapBlock(3, &fh, &mapped));
+    ASSERT_TRUE(memcmp(page, mapped, PAGE_SIZE) == 0, "mapped page holds the write");
+    mapped[0] = 'x';
+    TEST_CHECK(readBlock(3, &plain, read));
+    ASSERT_TRUE(read[0] == 'x', "store into the mapping seen by pread");
+    TEST_CHECK(syncBlocks(3, 1, &fh));
+    ASSERT_ERROR(mapBlock(4, &fh, &mapped), "no mapping past the end of the file");
+
+    // growing the file past the mapping remaps without moving earlier pointers
+    TEST_CHECK(mapBlock(0, &fh, &first));
+    first[0] = 'a';
+    TEST_CHECK(ensureCapacity(20000, &fh));
+    TEST_CHECK(mapBlock(19999, &fh, &mapped));
+    mapped[0] = 'z';
+    TEST_CHECK(ensureCapacity(20000, &plain));
+    TEST_CHECK(readBlock(19999, &plain, read));
+    ASSERT_TRUE(read[0] == 'z', "page past the first mapping");
+    TEST_CHECK(readBlock(0, &fh, read));
+    ASSERT_TRUE(read[0] == 'a' && first[0] == 'a', "pointer into the first mapping still valid");
+    TEST_CHECK(closePageFile(&fh));
+
+    // a pool of mapped files pins pages in place
+    options.mapFiles = true;
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 3, RS_LRU, NULL, &options));
+    TEST_CHECK(pinPage(bm, h, 3));
+    ASSERT_TRUE(h->data[0] == 'x' && memcmp(page + 1, h->data + 1, PAGE_SIZE - 1) == 0, "pinned page read");
+    h->data[1] = 'y';
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(readBlock(3, &plain, read));
+    ASSERT_TRUE(read[1] == 'y', "change reaches the file without a write");
+    TEST_CHECK(forcePage(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    for (i = 0; i < 5; i++)
+        pinAndUnpin(bm, h, i);
+    TEST_CHECK(pinPage(bm, h, 20005));
+    ASSERT_TRUE(h->data[0] == 0, "page past the end of the file is empty");
+    h->data[0] = 'e';
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(forceFlushPool(bm));
+    TEST_CHECK(ensureCapacity(20006, &plain));
+    ASSERT_EQUALS_INT(20006, plain.totalNumPages, "pool grew the file to the page");
+    TEST_CHECK(readBlock(20005, &plain, read));
+    ASSERT_TRUE(read[0] == 'e', "page past the end of the file written");
+    ASSERT_EQUALS_POOL("[20005 0],[3 0],[4 0]", bm, "mapped frames replaced");
+
+    // prefetched pages and pages of a ring point into the mapping too
+    reads = getNumReadIO(bm);
+    TEST_CHECK(prefetchPages(bm, prefetched, 1));
+    waitForReads(bm, reads + 1);
+    TEST_CHECK(pinPage(bm, h, 19999));
+    ASSERT_TRUE(h->data[0] == 'z', "prefetched page read");
+    ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "pin hit the prefetched page");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(initAccessRing(bm, &ring, 1));
+    TEST_CHECK(pinPageInRing(bm, &ring, h, 0));
+    ASSERT_TRUE(h->data[0] == 'a', "ring page read");
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(shutdownAccessRing(bm, &ring));
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(closePageFile(&plain));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(page);
+    free(read);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testDirectIO (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = {0};
+    SM_FileHandle fh, plain;
+    char *unaligned = malloc(4096 + 1);
+    char *page = unaligned + 1;
+    char *read = malloc(4096);
+    SM_PageHandle run[2];
+    SM_AccessMode mode;
+    int i;
+    testName = "test direct I/O";
+
+    // pages smaller than the direct I/O alignment fall back to buffered I/O
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(openPageFileWithMode(TEST_FILE, &fh, SM_ACCESS_DIRECT));
+    ASSERT_EQUALS_INT(SM_ACCESS_PREAD, getAccessMode(&fh), "small pages use buffered I/O");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    // with 4 KiB pages the file system decides, and either way pages round trip
+    TEST_CHECK(createPageFileWithPageSize(TEST_FILE, 4096));
+    TEST_CHECK(openPageFileWithMode(TEST_FILE, &fh, SM_ACCESS_DIRECT));
+    mode = getAccessMode(&fh);
+    ASSERT_TRUE(mode == SM_ACCESS_DIRECT || mode == SM_ACCESS_PREAD, "direct I/O or the buffered fallback");
+    TEST_CHECK(openPageFile(TEST_FILE, &plain));
+    for (i = 0; i < 4096; i++)
+        page[i] = (i % 10) + '0';
+    TEST_CHECK(writeBlock(1, &fh, page));
+    TEST_CHECK(ensureCapacity(2, &plain));
+    TEST_CHECK(readBlock(1, &plain, read));
+    ASSERT_TRUE(memcmp(page, read, 4096) == 0, "unaligned buffer written");
+    memset(page, 0, 4096);
+    TEST_CHECK(readBlock(1, &fh, page));
+    ASSERT_TRUE(memcmp(page, read, 4096) == 0, "unaligned buffer read");
+    run[0] = read;
+    run[1] = page;
+    TEST_CHECK(writeBlocksGather(2, 2, &fh, run));
+    ASSERT_EQUALS_INT(4, fh.totalNumPages, "run of unaligned buffers written");
+    TEST_CHECK(readBlock(3, &fh, read));
+    ASSERT_TRUE(memcmp(page, read, 4096) == 0, "last page of the run read back");
+    TEST_CHECK(readBlock(4, &fh, read));
+    ASSERT_TRUE(read[0] == 0 && read[4095] == 0, "page past the end is empty");
+    TEST_CHECK(closePageFile(&fh));
+
+    // a pool with direct I/O reads and writes through its aligned frames
+    options.directIO = true;
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 3, RS_LRU, NULL, &options));
+    TEST_CHECK(pinPage(bm, h, 1));
+    ASSERT_TRUE(memcmp(page, h->data, 4096) == 0, "page pinned");
+    ASSERT_TRUE(((uintptr_t) h->data % SM_DIRECT_ALIGNMENT) == 0, "frame aligned for direct I/O");
+    h->data[0] = 'd';
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    TEST_CHECK(forceFlushPool(bm));
+    TEST_CHECK(readBlock(1, &plain, read));
+    ASSERT_TRUE(read[0] == 'd', "flushed page read by another handle");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    options.mapFiles = true;
+    ASSERT_ERROR(initBufferPoolWithOptions(bm, TEST_FILE, 3, RS_LRU, NULL, &options), "mapped files cannot use direct I/O");
+
+    TEST_CHECK(closePageFile(&plain));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(unaligned);
+    free(read);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testVectoredIO (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    SM_FileHandle fh;
+    char *pages = malloc(5 * PAGE_SIZE);
+    char *read = malloc(3 * PAGE_SIZE);
+    SM_PageHandle scattered[3];
+    PageNumber run[] = {2, 3, 4, 5, 6, 7};
+    char expected[PAGE_SIZE];
+    int i, reads;
+    testName = "test vectored reads and writes";
+
+    // a run written from one buffer grows the file and reads back in one piece
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    for (i = 0; i < 5 * PAGE_SIZE; i++)
+        pages[i] = (i / PAGE_SIZE) + 'a';
+    TEST_CHECK(writeBlocks(0, 5, &fh, pages));
+    ASSERT_EQUALS_INT(5, fh.totalNumPages, "run of pages appended");
+    TEST_CHECK(readBlocks(1, 3, &fh, read));
+    ASSERT_TRUE(memcmp(pages + PAGE_SIZE, read, 3 * PAGE_SIZE) == 0, "run read back");
+    ASSERT_EQUALS_INT(3, getBlockPos(&fh), "position at the last page of the run");
+
+    // scattered reads may end one page past the end, which reads as empty
+    scattered[0] = read + 2 * PAGE_SIZE;
+    scattered[1] = read;
+    scattered[2] = read + PAGE_SIZE;
+    TEST_CHECK(readBlocksScatter(3, 3, &fh, scattered));
+    ASSERT_TRUE(read[2 * PAGE_SIZE] == 'd' && read[0] == 'e', "pages scattered into their buffers");
+    ASSERT_TRUE(read[PAGE_SIZE] == 0 && read[2 * PAGE_SIZE - 1] == 0, "page past the end is empty");
+    ASSERT_ERROR(readBlocks(4, 3, &fh, read), "run reaching two pages past the end");
+    ASSERT_ERROR(readBlocks(-1, 2, &fh, read), "run starting before the file");
+
+    // growing a file by more pages than one vectored write takes
+    TEST_CHECK(ensureCapacity(3000, &fh));
+    ASSERT_EQUALS_INT(3000, fh.totalNumPages, "file grown");
+    TEST_CHECK(readBlocks(2997, 3, &fh, read));
+    ASSERT_TRUE(read[0] == 0 && read[3 * PAGE_SIZE - 1] == 0, "new pages empty");
+    TEST_CHECK(readBlock(4, &fh, read));
+    ASSERT_TRUE(read[0] == 'e', "old pages kept");
+    TEST_CHECK(closePageFile(&fh));
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 8, RS_FIFO, NULL));
+    for (i = 0; i < 10; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // queued consecutive pages are read together and each one lands in its frame,
+    // while a page the pool holds keeps its unwritten change
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 8, RS_FIFO, NULL));
+    TEST_CHECK(pinPage(bm, h, 4));
+    sprintf(h->data, "Changed-4");
+    TEST_CHECK(markDirty(bm, h));
+    TEST_CHECK(unpinPage(bm, h));
+    reads = getNumReadIO(bm);
+    TEST_CHECK(prefetchPages(bm, run, 6));
+    waitForReads(bm, reads + 5);
+    ASSERT_EQUALS_POOL("[4x0],[2 0],[3 0],[5 0],[6 0],[7 0],[-1 0],[-1 0]", bm, "run loaded unpinned");
+    for (i = 2; i < 8; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        if (i == 4)
+            sprintf(expected, "Changed-%i", i);
+        else
+            sprintf(expected, "Page-%i", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "page of the run has its content");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(reads + 5, getNumReadIO(bm), "pins hit the run");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(pages);
+    free(read);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testAsyncIO (void)
+{
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PoolOptions options = { .writerCleanRatio = 0.5 };
+    SM_IOQueue queue;
+    SM_IOCompletion done[4];
+    SM_FileHandle fh;
+    char *pages = malloc(4 * PAGE_SIZE);
+    char *read = malloc(3 * PAGE_SIZE);
+    PageNumber scattered[] = {1, 2, 5, 9, 10, 11, 14};
+    char expected[PAGE_SIZE];
+    int b, i, n, reads;
+    testName = "test asynchronous I/O";
+
+    // both backends complete the same requests; io_uring may fall back to the threads
+    for (b = 0; b < 2; b++)
+    {
+        TEST_CHECK(createPageFile(TEST_FILE));
+        TEST_CHECK(openPageFile(TEST_FILE, &fh));
+        TEST_CHECK(initIOQueue(&queue, 2, b == 0 ? SM_IO_URING : SM_IO_THREADS));
+        ASSERT_TRUE(b == 0 || queue.backend == SM_IO_THREADS, "worker threads as asked");
+        for (i = 0; i < 4 * PAGE_SIZE; i++)
+            pages[i] = (i / PAGE_SIZE) + 'a';
+        TEST_CHECK(submitWrite(&queue, 0, 4, &fh, pages, pages));
+        TEST_CHECK(submitWrite(&queue, 1, 2, &fh, pages + PAGE_SIZE, NULL));
+        ASSERT_EQUALS_INT(RC_IO_QUEUE_FULL, submitWrite(&queue, 0, 1, &fh, pages, NULL), "queue full");
+        TEST_CHECK(waitIOQueue(&queue, done, 2, 4, &n));
+        ASSERT_EQUALS_INT(2, n, "both writes finished");
+        ASSERT_TRUE(done[0].rc == RC_OK && done[1].rc == RC_OK, "writes succeeded");
+        ASSERT_TRUE(done[0].userData == pages ? done[0].numPages == 4 : done[1].numPages == 4, "completion names its request");
+
+        // the writes grew the file behind the handle's back
+        TEST_CHECK(ensureCapacity(4, &fh));
+        ASSERT_EQUALS_INT(4, fh.totalNumPages, "file grown by the writes");
+        memset(read, 'x', 3 * PAGE_SIZE);
+        TEST_CHECK(submitRead(&queue, 2, 3, &fh, read, NULL));
+        TEST_CHECK(waitIOQueue(&queue, done, 1, 4, &n));
+        ASSERT_TRUE(n == 1 && done[0].rc == RC_OK && done[0].firstPage == 2, "read finished");
+        ASSERT_TRUE(memcmp(pages + 2 * PAGE_SIZE, read, 2 * PAGE_SIZE) == 0, "pages read back");
+        ASSERT_TRUE(read[2 * PAGE_SIZE] == 0 && read[3 * PAGE_SIZE - 1] == 0, "page past the end is empty");
+        ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, submitRead(&queue, 3, 3, &fh, read, NULL), "read past the end");
+        TEST_CHECK(pollIOQueue(&queue, done, 4, &n));
+        ASSERT_EQUALS_INT(0, n, "nothing left to take");
+        TEST_CHECK(waitIOQueue(&queue, done, 1, 4, &n));
+        ASSERT_EQUALS_INT(0, n, "nothing in flight to wait for");
+        TEST_CHECK(shutdownIOQueue(&queue));
+        TEST_CHECK(closePageFile(&fh));
+
+        // requests on a mapped file are done at submission
+        TEST_CHECK(openPageFileWithMode(TEST_FILE, &fh, SM_ACCESS_MMAP));
+        TEST_CHECK(initIOQueue(&queue, 2, SM_IO_THREADS));
+        TEST_CHECK(submitRead(&queue, 1, 2, &fh, read, NULL));
+        TEST_CHECK(pollIOQueue(&queue, done, 4, &n));
+        ASSERT_TRUE(n == 1 && done[0].rc == RC_OK, "mapped read finished at once");
+        ASSERT_TRUE(memcmp(pages + PAGE_SIZE, read, 2 * PAGE_SIZE) == 0, "mapped pages read");
+        TEST_CHECK(shutdownIOQueue(&queue));
+        TEST_CHECK(closePageFile(&fh));
+        TEST_CHECK(destroyPageFile(TEST_FILE));
+    }
+    ASSERT_ERROR(initIOQueue(&queue, 0, SM_IO_THREADS), "queue without depth");
+
+    // a prefetch batch of several runs keeps all of them in flight and loads each page
+    TEST_CHECK(createPageFile(TEST_FILE));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 16, RS_FIFO, NULL));
+    for (i = 0; i < 16; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Page-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(initBufferPool(bm, TEST_FILE, 8, RS_FIFO, NULL));
+    reads = getNumReadIO(bm);
+    TEST_CHECK(prefetchPages(bm, scattered, 7));
+    waitForReads(bm, reads + 7);
+    for (i = 0; i < 7; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, scattered[i]));
+        sprintf(expected, "Page-%i", scattered[i]);
+        ASSERT_EQUALS_STRING(expected, h->data, "prefetched page has its content");
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(reads + 7, getNumReadIO(bm), "pins hit the batch");
+    TEST_CHECK(shutdownBufferPool(bm));
+
+    // the background writer cleans a window of dirty frames with its writes in flight together
+    TEST_CHECK(initBufferPoolWithOptions(bm, TEST_FILE, 8, RS_FIFO, NULL, &options));
+    for (i = 0; i < 8; i++)
+    {
+        TEST_CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "Written-%i", i);
+        TEST_CHECK(markDirty(bm, h));
+        TEST_CHECK(unpinPage(bm, h));
+    }
+    for (i = 0; i < 100 && getNumWriteIO(bm) < 4; i++)
+        usleep(10000);
+    ASSERT_TRUE(getNumWriteIO(bm) >= 4, "window of frames written back");
+    TEST_CHECK(shutdownBufferPool(bm));
+    TEST_CHECK(openPageFile(TEST_FILE, &fh));
+    for (i = 0; i < 8; i++)
+    {
+        TEST_CHECK(readBlock(i, &fh, read));
+        sprintf(expected, "Written-%i", i);
+        ASSERT_EQUALS_STRING(expected, read, "page on disk");
+    }
+    TEST_CHECK(closePageFile(&fh));
+
+    TEST_CHECK(destroyPageFile(TEST_FILE));
+    free(pages);
+    free(read);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+void *
+incrementUnderLatch (void *arg)
+{
+    int i;
+    (void) arg;
+    for (i = 0; i < LATCH_TEST_ROUNDS; i++)
+    {
+        lockLatchForWrite(&testLatch);
+        latchCounter++;
+        releaseLatchAfterWrite(&testLatch);
+    }
+    return NULL;
+}
+
+void *
+pinConcurrently (void *arg)
+{
+    PinWorker *worker = arg;
+    BM_PageHandle h;
+    char expected[PAGE_SIZE];
+    unsigned int seed = worker->seed;
+    int n = (worker->rounds > 0) ? worker->rounds : CONCURRENT_PAGES;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        PageNumber pageNum = (worker->rounds > 0) ? rand_r(&seed) % CONCURRENT_PAGES
+                                                  : (worker->seed + i) % CONCURRENT_PAGES;
+        if (pinPage(worker->bm, &h, pageNum) != RC_OK)
+        {
+            worker->errors++;
+            continue;
+        }
+        sprintf(expected, "Page-%i", pageNum);
+        if (strcmp(expected, h.data) != 0)
+            worker->errors++;
+        if (i % 4 == 0 && markDirty(worker->bm, &h) != RC_OK)
+            worker->errors++;
+        if (unpinPage(worker->bm, &h) != RC_OK)
+            worker->errors++;
+    }
+    return NULL;
+}
+
+// unpins page 0 of the pool after the main thread had time to start waiting
+void *
+unpinLater (void *arg)
+{
+    BM_PageHandle h;
+
+    usleep(50000);
+    h.pageNum = 0;
+    unpinPage((BM_BufferPool *) arg, &h);
+    return NULL;
+}
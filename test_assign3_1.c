@@ -55,6 +55,10 @@ static void testScans (void);
 static void testScansTwo (void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testMultipleOpenTables(void);
+static void testSharedBufferPool(void);
+static void testScanLargeTable(void);
+static void testLargePages(void);
 
 // struct for test records
 typedef struct TestRecord {
@@ -84,6 +88,10 @@ main (void)
     testScans();
     testScansTwo();
     testMultipleScans();
+    testMultipleOpenTables();
+    testSharedBufferPool();
+    testScanLargeTable();
+    testLargePages();
 
     return 0;
 }
@@ -767,6 +775,303 @@ void testScansTwo (void)
     TEST_DONE();
 }
 
+// ************************************************************
+void
+testMultipleOpenTables(void)
+{
+    RM_TableData *left = (RM_TableData *) malloc(sizeof(RM_TableData));
+    RM_TableData *right = (RM_TableData *) malloc(sizeof(RM_TableData));
+    TestRecord leftInserts[] = {
+            {1, "aaaa", 3},
+            {2, "bbbb", 2},
+            {3, "cccc", 1},
+            {4, "dddd", 3},
+            {5, "eeee", 5},
+            {6, "ffff", 1},
+            {7, "gggg", 3},
+            {8, "hhhh", 3},
+            {9, "iiii", 2}
+    };
+    TestRecord rightInserts[] = {
+            {11, "kkkk", 7},
+            {12, "llll", 8},
+            {13, "mmmm", 9},
+            {14, "nnnn", 7},
+            {15, "oooo", 8},
+            {16, "pppp", 9},
+            {17, "qqqq", 7},
+            {18, "rrrr", 8},
+            {19, "ssss", 9}
+    };
+    int numInserts = 9, i;
+    Record *r, *expected;
+    RID leftRids[9], rightRids[9];
+    Schema *schema;
+    testName = "test two tables open at the same time with their own buffer pools";
+    schema = testSchema();
+
+    TEST_CHECK(initRecordManager(NULL));
+    TEST_CHECK(createTable("test_table_left",schema));
+    TEST_CHECK(createTable("test_table_right",schema));
+    TEST_CHECK(openTable(left, "test_table_left"));
+    TEST_CHECK(openTable(right, "test_table_right"));
+
+    // interleave inserts so both pools are in use together
+    for(i = 0; i < numInserts; i++)
+    {
+        r = fromTestRecord(schema, leftInserts[i]);
+        TEST_CHECK(insertRecord(left, r));
+        leftRids[i] = r->id;
+        freeRecord(r);
+
+        r = fromTestRecord(schema, rightInserts[i]);
+        TEST_CHECK(insertRecord(right, r));
+        rightRids[i] = r->id;
+        freeRecord(r);
+    }
+
+    ASSERT_EQUALS_INT(numInserts, getNumTuples(left), "left table tuple count");
+    ASSERT_EQUALS_INT(numInserts, getNumTuples(right), "right table tuple count");
+
+    // closing one table must leave the other one usable
+    TEST_CHECK(closeTable(left));
+
+    TEST_CHECK(createRecord(&r, schema));
+    for(i = 0; i < numInserts; i++)
+    {
+        TEST_CHECK(getRecord(right, rightRids[i], r));
+        expected = fromTestRecord(schema, rightInserts[i]);
+        ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records of right table");
+        freeRecord(expected);
+    }
+
+    TEST_CHECK(openTable(left, "test_table_left"));
+    for(i = 0; i < numInserts; i++)
+    {
+        TEST_CHECK(getRecord(left, leftRids[i], r));
+        expected = fromTestRecord(schema, leftInserts[i]);
+        ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records of left table");
+        freeRecord(expected);
+    }
+    freeRecord(r);
+
+    TEST_CHECK(closeTable(left));
+    TEST_CHECK(closeTable(right));
+    TEST_CHECK(deleteTable("test_table_left"));
+    TEST_CHECK(deleteTable("test_table_right"));
+    TEST_CHECK(shutdownRecordManager());
+
+    freeSchema(schema);
+    free(left);
+    free(right);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testSharedBufferPool(void)
+{
+    RM_TableData *left = (RM_TableData *) malloc(sizeof(RM_TableData));
+    RM_TableData *right = (RM_TableData *) malloc(sizeof(RM_TableData));
+    int numInserts = 40, i;
+    Record *r, *expected;
+    RID leftRids[40], rightRids[40];
+    Schema *schema;
+    testName = "test two tables sharing one small buffer pool";
+    schema = testSchema();
+
+    // room for only a handful of frames, so the tables evict each other's pages
+    TEST_CHECK(initSharedBufferPool(1024, RS_LRU, NULL));
+    TEST_CHECK(initRecordManager(NULL));
+    TEST_CHECK(createTable("test_table_left",schema));
+    TEST_CHECK(createTable("test_table_right",schema));
+    TEST_CHECK(openTable(left, "test_table_left"));
+    TEST_CHECK(openTable(right, "test_table_right"));
+
+    ASSERT_TRUE(shutdownSharedBufferPool() != RC_OK, "shared pool stays up while tables are open");
+
+    for(i = 0; i < numInserts; i++)
+    {
+        r = fromTestRecord(schema, (TestRecord) {i, "left", i % 7});
+        TEST_CHECK(insertRecord(left, r));
+        leftRids[i] = r->id;
+        freeRecord(r);
+
+        r = fromTestRecord(schema, (TestRecord) {-i, "rght", i % 5});
+        TEST_CHECK(insertRecord(right, r));
+        rightRids[i] = r->id;
+        freeRecord(r);
+    }
+
+    ASSERT_EQUALS_INT(numInserts, getNumTuples(left), "left table tuple count");
+    ASSERT_EQUALS_INT(numInserts, getNumTuples(right), "right table tuple count");
+
+    TEST_CHECK(createRecord(&r, schema));
+    for(i = 0; i < numInserts; i++)
+    {
+        TEST_CHECK(getRecord(left, leftRids[i], r));
+        expected = fromTestRecord(schema, (TestRecord) {i, "left", i % 7});
+        ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records of left table");
+        freeRecord(expected);
+
+        TEST_CHECK(getRecord(right, rightRids[i], r));
+        expected = fromTestRecord(schema, (TestRecord) {-i, "rght", i % 5});
+        ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records of right table");
+        freeRecord(expected);
+    }
+    freeRecord(r);
+
+    TEST_CHECK(closeTable(left));
+    TEST_CHECK(closeTable(right));
+    TEST_CHECK(deleteTable("test_table_left"));
+    TEST_CHECK(deleteTable("test_table_right"));
+    TEST_CHECK(shutdownRecordManager());
+    TEST_CHECK(shutdownSharedBufferPool());
+
+    freeSchema(schema);
+    free(left);
+    free(right);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testScanLargeTable(void)
+{
+    RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+    RM_ScanHandle *sc1 = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+    RM_ScanHandle *sc2 = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+    int numInserts = 40, i, scanOne = 0, scanTwo = 0, rc;
+    Record *r, *expected;
+    RID rids[40];
+    Schema *schema;
+    Expr *sel, *left, *right;
+    testName = "test scanning a table larger than its buffer pool";
+    schema = testSchema();
+
+    TEST_CHECK(initRecordManager(NULL));
+    TEST_CHECK(createTable("test_table_scan",schema));
+    TEST_CHECK(openTable(table, "test_table_scan"));
+
+    for(i = 0; i < numInserts; i++)
+    {
+        r = fromTestRecord(schema, (TestRecord) {i, "scan", i % 4});
+        TEST_CHECK(insertRecord(table, r));
+        rids[i] = r->id;
+        freeRecord(r);
+    }
+
+    // two scans read through rings of their own while point lookups go on
+    MAKE_ATTRREF(left, 2);
+    MAKE_CONS(right, stringToValue("i4"));
+    MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+    TEST_CHECK(createRecord(&r, schema));
+    TEST_CHECK(startScan(table, sc1, sel));
+    TEST_CHECK(startScan(table, sc2, sel));
+    while((rc = next(sc1, r)) == RC_OK)
+    {
+        scanOne++;
+        if (scanOne % 2 == 0 && next(sc2, r) == RC_OK)
+            scanTwo++;
+        if (scanOne % 10 == 0)
+        {
+            TEST_CHECK(getRecord(table, rids[3], r));
+            expected = fromTestRecord(schema, (TestRecord) {3, "scan", 3});
+            ASSERT_EQUALS_RECORDS(expected, r, schema, "point lookup during scans");
+            freeRecord(expected);
+        }
+    }
+    ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "first scan ran to the end");
+    while(next(sc2, r) == RC_OK)
+        scanTwo++;
+    ASSERT_EQUALS_INT(numInserts, scanOne, "first scan saw every record");
+    ASSERT_EQUALS_INT(numInserts, scanTwo, "second scan saw every record");
+    TEST_CHECK(closeScan(sc1));
+    TEST_CHECK(closeScan(sc2));
+
+    for(i = 0; i < numInserts; i += 37)
+    {
+        TEST_CHECK(getRecord(table, rids[i], r));
+        expected = fromTestRecord(schema, (TestRecord) {i, "scan", i % 4});
+        ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records after the scans");
+        freeRecord(expected);
+    }
+    freeRecord(r);
+
+    TEST_CHECK(closeTable(table));
+    TEST_CHECK(deleteTable("test_table_scan"));
+    TEST_CHECK(shutdownRecordManager());
+
+    freeExpr(sel);
+    freeSchema(schema);
+    free(sc1);
+    free(sc2);
+    free(table);
+    TEST_DONE();
+}
+
+// ************************************************************
+void
+testLargePages(void)
+{
+    RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+    RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+    int numInserts = 500, i, found = 0, rc;
+    Record *r, *expected;
+    RID rids[500];
+    Schema *schema;
+    Expr *sel, *left, *right;
+    testName = "test a table with 4 KiB pages";
+    schema = testSchema();
+
+    TEST_CHECK(initRecordManager(NULL));
+    ASSERT_TRUE(createTableWithPageSize("test_table_large", schema, 1000) != RC_OK, "page size must be a power of two");
+    TEST_CHECK(createTableWithPageSize("test_table_large", schema, 4096));
+    TEST_CHECK(openTable(table, "test_table_large"));
+
+    for(i = 0; i < numInserts; i++)
+    {
+        r = fromTestRecord(schema, (TestRecord) {i, "page", i % 9});
+        TEST_CHECK(insertRecord(table, r));
+        rids[i] = r->id;
+        freeRecord(r);
+    }
+    ASSERT_TRUE(rids[numInserts - 1].page < 4, "many records share each page");
+    TEST_CHECK(closeTable(table));
+
+    // the page size comes back from the file when the table is reopened
+    TEST_CHECK(openTable(table, "test_table_large"));
+    ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuple count after reopening");
+    MAKE_ATTRREF(left, 2);
+    MAKE_CONS(right, stringToValue("i9"));
+    MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+    TEST_CHECK(createRecord(&r, schema));
+    TEST_CHECK(startScan(table, sc, sel));
+    while((rc = next(sc, r)) == RC_OK)
+        found++;
+    ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ran to the end");
+    ASSERT_EQUALS_INT(numInserts, found, "scan saw every record");
+    TEST_CHECK(closeScan(sc));
+
+    for(i = 0; i < numInserts; i += 49)
+    {
+        TEST_CHECK(getRecord(table, rids[i], r));
+        expected = fromTestRecord(schema, (TestRecord) {i, "page", i % 9});
+        ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records after reopening");
+        freeRecord(expected);
+    }
+    freeRecord(r);
+
+    TEST_CHECK(closeTable(table));
+    TEST_CHECK(deleteTable("test_table_large"));
+    TEST_CHECK(shutdownRecordManager());
+
+    freeExpr(sel);
+    freeSchema(schema);
+    free(sc);
+    free(table);
+    TEST_DONE();
+}
 
 Schema *
 testSchema (void)
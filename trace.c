@@ -0,0 +1,133 @@
+#include "trace.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * A fixed ring of the last TRACE_RING_SIZE events. Writers claim a position
+ * with one atomic increment and never wait for each other or for readers.
+ * Each slot carries a stamp, the position it holds plus one, cleared while the
+ * slot is rewritten, so a reader can tell a complete event from one that was
+ * overwritten under it and skip the latter.
+ */
+typedef struct TraceSlot {
+    _Atomic uint64_t stamp;
+    _Atomic uint64_t timeNanos;
+    _Atomic int type;
+    _Atomic int arg1;
+    _Atomic int arg2;
+} TraceSlot;
+
+static TraceSlot traceRing[TRACE_RING_SIZE];
+static _Atomic uint64_t traceHead;
+
+static const char *traceEventNames[] = {
+    "pin hit", "pin miss", "unpin", "mark dirty", "force page",
+    "evict", "read block", "write block", "background write", "prefetch"
+};
+
+/*
+ * Appends an event to the ring, overwriting the oldest one once it is full.
+ *
+ * @param type Kind of event
+ * @param arg1 First argument, usually the file
+ * @param arg2 Second argument, usually the page number
+ */
+void traceRecord (TraceEventType type, int arg1, int arg2) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    uint64_t pos = atomic_fetch_add_explicit(&traceHead, 1, memory_order_relaxed);
+    TraceSlot *slot = &traceRing[pos & (TRACE_RING_SIZE - 1)];
+
+    atomic_store_explicit(&slot->stamp, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->timeNanos, (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec, memory_order_relaxed);
+    atomic_store_explicit(&slot->type, type, memory_order_relaxed);
+    atomic_store_explicit(&slot->arg1, arg1, memory_order_relaxed);
+    atomic_store_explicit(&slot->arg2, arg2, memory_order_relaxed);
+    atomic_store_explicit(&slot->stamp, pos + 1, memory_order_release);
+}
+
+/*
+ * Copies the most recent events out of the ring, oldest first. Events being
+ * written or overwritten during the copy are left out.
+ *
+ * @param events    Receives the events
+ * @param maxEvents Capacity of events
+ * @return          Number of events copied
+ */
+int traceSnapshot (TraceEvent *events, int maxEvents) {
+    uint64_t head = atomic_load_explicit(&traceHead, memory_order_acquire);
+    uint64_t first = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+    int n = 0;
+
+    if (maxEvents <= 0) {
+        return 0;
+    }
+    if (head - first > (uint64_t) maxEvents) {
+        first = head - maxEvents;
+    }
+
+    for (uint64_t pos = first; pos < head; pos++) {
+        TraceSlot *slot = &traceRing[pos & (TRACE_RING_SIZE - 1)];
+        if (atomic_load_explicit(&slot->stamp, memory_order_acquire) != pos + 1) {
+            continue;
+        }
+
+        TraceEvent *event = &events[n];
+        event->seq = pos;
+        event->timeNanos = atomic_load_explicit(&slot->timeNanos, memory_order_relaxed);
+        event->type = atomic_load_explicit(&slot->type, memory_order_relaxed);
+        event->arg1 = atomic_load_explicit(&slot->arg1, memory_order_relaxed);
+        event->arg2 = atomic_load_explicit(&slot->arg2, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+
+        // Keep the event only if no writer reused the slot while it was read
+        if (atomic_load_explicit(&slot->stamp, memory_order_relaxed) == pos + 1) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * Prints the events in the ring, one per line, oldest first.
+ *
+ * @param out Stream to print to
+ * @return    Number of events printed, or -1 if memory allocation fails
+ */
+int traceDump (FILE *out) {
+    TraceEvent *events = malloc(sizeof(TraceEvent) * TRACE_RING_SIZE);
+    if (events == NULL) {
+        return -1;
+    }
+
+    int n = traceSnapshot(events, TRACE_RING_SIZE);
+    for (int i = 0; i < n; i++) {
+        fprintf(out, "%llu %llu.%09llu %s %d %d\n", (unsigned long long) events[i].seq,
+                (unsigned long long) (events[i].timeNanos / 1000000000u),
+                (unsigned long long) (events[i].timeNanos % 1000000000u),
+                traceEventName(events[i].type), events[i].arg1, events[i].arg2);
+    }
+
+    free(events);
+    return n;
+}
+
+/*
+ * Empties the ring. Not safe while other threads record events.
+ */
+void traceReset (void) {
+    for (int i = 0; i < TRACE_RING_SIZE; i++) {
+        atomic_store_explicit(&traceRing[i].stamp, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&traceHead, 0, memory_order_release);
+}
+
+const char *traceEventName (int type) {
+    if (type < 0 || type >= (int) (sizeof(traceEventNames) / sizeof(traceEventNames[0]))) {
+        return "unknown";
+    }
+    return traceEventNames[type];
+}
@@ -0,0 +1,95 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/************************************************************
+ *                    log levels                            *
+ ************************************************************/
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+// Messages above this level are compiled out. TRACE covers the per page and
+// per record calls, so it is only worth building in while debugging.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) fprintf(stderr, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) fprintf(stderr, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) printf(__VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) printf(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) printf(__VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void) 0)
+#endif
+
+/************************************************************
+ *                    binary trace ring                     *
+ ************************************************************/
+// Number of events the ring keeps, must be a power of two
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 4096
+#endif
+
+typedef enum TraceEventType {
+    TRACE_PIN_HIT = 0,
+    TRACE_PIN_MISS = 1,
+    TRACE_UNPIN = 2,
+    TRACE_MARK_DIRTY = 3,
+    TRACE_FORCE_PAGE = 4,
+    TRACE_EVICT = 5,
+    TRACE_READ_BLOCK = 6,
+    TRACE_WRITE_BLOCK = 7,
+    TRACE_BACKGROUND_WRITE = 8,
+    TRACE_PREFETCH = 9
+} TraceEventType;
+
+typedef struct TraceEvent {
+    uint64_t seq; // position in the stream of events, starting at 0
+    uint64_t timeNanos; // CLOCK_MONOTONIC
+    int type; // a TraceEventType
+    int arg1; // usually the file
+    int arg2; // usually the page number
+} TraceEvent;
+
+// Events are recorded only in builds with TRACE_RING defined
+#ifdef TRACE_RING
+#define TRACE_EVENT(type, arg1, arg2) traceRecord((type), (arg1), (arg2))
+#else
+#define TRACE_EVENT(type, arg1, arg2) ((void) 0)
+#endif
+
+void traceRecord (TraceEventType type, int arg1, int arg2);
+int traceSnapshot (TraceEvent *events, int maxEvents);
+int traceDump (FILE *out);
+void traceReset (void);
+const char *traceEventName (int type);
+
+#endif // TRACE_H